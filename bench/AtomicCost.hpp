@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef ATOMICCOST_HPP__
+#define ATOMICCOST_HPP__
+
+#include <stm/stm.hpp>
+#include <iostream>
+#include "Benchmark.hpp"
+
+namespace bench
+{
+  /**
+   *  Measure what the primitives in atomic_ops.h cost with the backend the
+   *  build picked.  Each "transaction" runs every primitive BATCH times in
+   *  a row and adds the time to that primitive's total: the fences, a CAS
+   *  and a swap on a line only this thread writes, and a CAS loop and fai
+   *  on one line all threads share.  Compare a build's asm backend with
+   *  the __atomic one by rebuilding with -DSTM_ATOMIC_BUILTINS, and vary
+   *  -p for contention, e.g.:
+   *
+   *     Bench -B AtomicCost -p 1 -v
+   *     Bench -B AtomicCost -p 8 -v
+   *
+   *  With -v, sanity_check() prints the backend and ns per operation.
+   */
+  class AtomicCost : public Benchmark
+  {
+      /*** operations per primitive per call */
+      static const int BATCH = 1024;
+
+      enum Op { OP_CFENCE, OP_WBR, OP_MFENCE, OP_CAS_LOCAL, OP_SWAP_LOCAL,
+                OP_CAS_SHARED, OP_FAI_SHARED, OPS };
+
+      static const char* label(int op)
+      {
+          switch (op) {
+            case OP_CFENCE:     return "CFENCE";
+            case OP_WBR:        return "WBR";
+            case OP_MFENCE:     return "mfence";
+            case OP_CAS_LOCAL:  return "cas (private line)";
+            case OP_SWAP_LOCAL: return "swap (private line)";
+            case OP_CAS_SHARED: return "cas loop (shared line)";
+            case OP_FAI_SHARED: return "fai (shared line)";
+            default:            return "unknown";
+          }
+      }
+
+      /*** one line per thread for the uncontended operations */
+      struct Slot
+      {
+          volatile unsigned long word;
+      } __attribute__((aligned(64)));
+
+      Slot slots[MAX_THREADS];
+
+      volatile unsigned long shared __attribute__((aligned(64)));
+
+      /*** total ns spent in each primitive, and calls made */
+      volatile unsigned long long ns[OPS] __attribute__((aligned(64)));
+      volatile unsigned long calls;
+
+      void run(int op, volatile unsigned long* mine)
+      {
+          switch (op) {
+            case OP_CFENCE:
+              for (int i = 0; i < BATCH; i++)
+                  CFENCE;
+              break;
+            case OP_WBR:
+              for (int i = 0; i < BATCH; i++)
+                  WBR;
+              break;
+            case OP_MFENCE:
+#if defined(__i386__) || defined(__x86_64__)
+              for (int i = 0; i < BATCH; i++)
+                  __asm__ __volatile__("mfence" ::: "memory");
+#endif
+              break;
+            case OP_CAS_LOCAL:
+              for (int i = 0; i < BATCH; i++)
+                  cas(mine, *mine, *mine + 1);
+              break;
+            case OP_SWAP_LOCAL:
+              for (int i = 0; i < BATCH; i++)
+                  swap(mine, i);
+              break;
+            case OP_CAS_SHARED:
+              for (int i = 0; i < BATCH; i++) {
+                  unsigned long v;
+                  do {
+                      v = shared;
+                  } while (!bool_cas(&shared, v, v + 1));
+              }
+              break;
+            case OP_FAI_SHARED:
+              for (int i = 0; i < BATCH; i++)
+                  fai(&shared);
+              break;
+          }
+      }
+
+    public:
+      AtomicCost() : shared(0), calls(0)
+      {
+          for (int i = 0; i < MAX_THREADS; i++)
+              slots[i].word = 0;
+          for (int i = 0; i < OPS; i++)
+              ns[i] = 0;
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          volatile unsigned long* mine = &slots[args->id].word;
+          for (int op = 0; op < OPS; op++) {
+              unsigned long long start = getElapsedTime();
+              run(op, mine);
+              __sync_fetch_and_add(&ns[op], getElapsedTime() - start);
+          }
+          fai(&calls);
+      }
+
+      virtual bool sanity_check() const
+      {
+          if ((BMCONFIG.verbosity > 0) && calls) {
+              std::cout << "atomic_ops backend: " << STM_ATOMIC_BACKEND
+                        << std::endl;
+              for (int op = 0; op < OPS; op++)
+                  std::cout << label(op) << ": "
+                            << (double)ns[op] / ((double)calls * BATCH)
+                            << " ns/op" << std::endl;
+          }
+          return true;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // ATOMICCOST_HPP__
@@ -55,6 +55,8 @@
 #include "TypeTest.hpp"
 #include "VerifyNesting.hpp"
 #include "VerifyRetry.hpp"
+#include "VerifySnapshot.hpp"
+#include "VerifyInPlace.hpp"
 #include "DList.hpp"
 #include "WWPathology.hpp"
 #include "RWPathology.hpp"
@@ -62,6 +64,19 @@
 #include "ListOverwriter.hpp"
 #include "PrivTree.hpp"
 #include "Forest.hpp"
+#include "WriteSetScale.hpp"
+#include "VisReadScale.hpp"
+#include "CheckpointRollback.hpp"
+#include "MultiTransfer.hpp"
+#include "PNFSetScale.hpp"
+#include "PNFStress.hpp"
+#include "CMDispatch.hpp"
+#include "RTPeriodic.hpp"
+#include "TimestampScale.hpp"
+#include "AtomicCost.hpp"
+#include "OrecAlias.hpp"
+#include "TimeBaseScale.hpp"
+#include "CMTimeCost.hpp"
 
 using namespace bench;
 
@@ -98,6 +113,28 @@ static void usage()
     cerr << "    TypeTest           Test that word-based STMs handle types correctly" << endl;
     cerr << "    VerifyRetry        Test that retry works" << endl;
     cerr << "    VerifyNesting      Simple test that subsumption nesting works" << endl;
+    cerr << "    VerifySnapshot     Test read-only snapshots against writers (-m)" << endl;
+    cerr << "    VerifyInPlace      Test readers of a large object against in-place writers" << endl;
+    cerr << "    WriteSetScale      Per-open cost vs. write set size (-m)" << endl;
+    cerr << "    VisReadScale       Visible reader scaling vs. threads (-p)" << endl;
+    cerr << "    CheckpointRollback Partial rollback to CHECKPOINT() (-m prefix)" << endl;
+    cerr << "    CheckpointRollbackOff  Same workload, full restarts" << endl;
+    cerr << "    MultiTransfer      4-account transfers, batched acquire" << endl;
+    cerr << "    MultiTransferSeq   Same workload, one-at-a-time acquire" << endl;
+    cerr << "    PNFSetScale        PNF m_set admission, hashed bits (-m objects)" << endl;
+    cerr << "    PNFSetScaleExact   Same, exact ownership words" << endl;
+    cerr << "    PNFStress          PNF admission via pnf_main (-m objects)" << endl;
+    cerr << "    PNFStressUser      Same, user-space m_set priorities" << endl;
+    cerr << "    CMDispatch         Conflict resolution cost, direct CM calls (-C)" << endl;
+    cerr << "    CMDispatchVirtual  Same, virtual CM calls" << endl;
+    cerr << "    RTPeriodic         Periodic RT tasks, deadline misses (-m, -C)" << endl;
+    cerr << "    CMTimeCost         Real-time CM clock work per transaction" << endl;
+    cerr << "    CMTimeCostRealtime Same, with CLOCK_REALTIME timespecs" << endl;
+    cerr << "    TimestampScale     Greedy/Serializer timestamps, per-thread ranges" << endl;
+    cerr << "    TimestampScaleFai  Same, one shared fetch-and-increment each" << endl;
+    cerr << "    AtomicCost         Fence and CAS cost of the atomic_ops backend" << endl;
+    cerr << "    OrecAlias          Orec sharing and false conflicts per table (-m, -O)" << endl;
+    cerr << "    TimeBaseScale      Conflict-free writer commits, LLT/ET time base" << endl;
     cerr << "    FineGrainList      Lock-based sorted linked list" << endl;
     cerr << "    CoarseGrainHash    256-bucket hash table, per-node locks"
          << endl;
@@ -117,6 +154,7 @@ static void usage()
     cerr << endl;
     cerr << "  Validation Strategies:" << endl;
     cerr << "     RSTM:      invis-eager (default), invis-lazy, vis-eager, vis-lazy" << endl;
+    cerr << "                invis-adapt, vis-adapt (eager or lazy, per transaction site)" << endl;
     cerr << "     Redo_Lock: invis-eager (default), invis-lazy, vis-eager, vis-lazy" << endl;
     cerr << "     et:        ee, el, ll";
     cerr << endl << endl;
@@ -140,6 +178,14 @@ static void usage()
          << endl;
     cerr << "    -I: thread0 executes all transactions inevitably" << endl;
     cerr << "    -P: threads execute with priority" << endl;
+    cerr << "    -S:[csv|json] dump per-thread transaction statistics (RSTM)"
+         << endl;
+    cerr << "        (and, with -V *-adapt, the acquire policy of each site)"
+         << endl;
+    cerr << "    -O:bits[:shift[:mask|hash]] orec table of 2^bits orecs over 2^shift-byte"
+         << endl;
+    cerr << "        stripes, hashed (default) or masked (LLT, ET, Fair, Flow, Strict, SGLA)"
+         << endl;
     cerr << endl;
 }
 
@@ -148,7 +194,7 @@ int main(int argc, char** argv)
     int opt;
 
     // parse the command-line options
-    while ((opt = getopt(argc, argv, "B:C:d:m:p:hqvZxV:R:T:WX:IcP")) != -1) {
+    while ((opt = getopt(argc, argv, "B:C:d:m:p:hqvZxV:R:T:WX:IcPS:O:")) != -1) {
         switch(opt) {
           case 'B':
             BMCONFIG.bm_name = string(optarg);
@@ -203,12 +249,34 @@ int main(int argc, char** argv)
           case 'P':
             BMCONFIG.priority = true;
             break;
+          case 'S':
+            BMCONFIG.stats_format = string(optarg);
+            break;
+          case 'O': {
+              // bits[:shift[:mask|hash]]
+              char* rest;
+              BMCONFIG.orec_bits = strtol(optarg, &rest, 10);
+              if (*rest == ':')
+                  BMCONFIG.orec_shift = strtol(rest + 1, &rest, 10);
+              if (*rest == ':')
+                  BMCONFIG.orec_hash = (string(rest + 1) != "mask");
+              break;
+          }
         }
     }
 
     // make sure that the parameters all make sense
     BMCONFIG.verifyParameters();
 
+#if defined(STM_OREC_TABLE)
+    if (BMCONFIG.orec_bits &&
+        !stm::OrecWBTxThread::configure_orecs(
+            BMCONFIG.orec_bits, BMCONFIG.orec_shift,
+            BMCONFIG.orec_hash ? stm::OrecWBTxThread::OREC_MAP_HASH
+                               : stm::OrecWBTxThread::OREC_MAP_MASK))
+        argError("cannot allocate the orec table; use a smaller -O bits");
+#endif
+
     // initialize stm so that we have transactional mm, then verify the
     // benchmark parameter and construct the benchmark object
     stm::init(BMCONFIG.cm_type, BMCONFIG.stm_validation,
@@ -245,6 +313,10 @@ int main(int argc, char** argv)
         B = new VerifyRetry(BMCONFIG.datasetsize);
     else if (BMCONFIG.bm_name == "VerifyNesting")
         B = new VerifyNesting(BMCONFIG.datasetsize);
+    else if (BMCONFIG.bm_name == "VerifySnapshot")
+        B = new VerifySnapshot(BMCONFIG.datasetsize);
+    else if (BMCONFIG.bm_name == "VerifyInPlace")
+        B = new VerifyInPlace();
     else if (BMCONFIG.bm_name == "RBTree")
         B = new IntSetBench(new RBTree(), BMCONFIG.datasetsize);
     else if (BMCONFIG.bm_name == "RBTreeLarge")
@@ -301,6 +373,46 @@ int main(int argc, char** argv)
     }
     else if (BMCONFIG.bm_name == "ListOverwriter")
         B = new ListOverwriter(BMCONFIG.datasetsize);
+    else if (BMCONFIG.bm_name == "WriteSetScale")
+        B = new WriteSetScale(BMCONFIG.datasetsize);
+    else if (BMCONFIG.bm_name == "VisReadScale")
+        B = new VisReadScale(BMCONFIG.datasetsize);
+    else if (BMCONFIG.bm_name == "CheckpointRollback")
+        B = new CheckpointRollback(BMCONFIG.datasetsize, true);
+    else if (BMCONFIG.bm_name == "CheckpointRollbackOff")
+        B = new CheckpointRollback(BMCONFIG.datasetsize, false);
+    else if (BMCONFIG.bm_name == "MultiTransfer")
+        B = new MultiTransfer(BMCONFIG.datasetsize, true);
+    else if (BMCONFIG.bm_name == "MultiTransferSeq")
+        B = new MultiTransfer(BMCONFIG.datasetsize, false);
+    else if (BMCONFIG.bm_name == "PNFSetScale")
+        B = new PNFSetScale(BMCONFIG.datasetsize, false);
+    else if (BMCONFIG.bm_name == "PNFSetScaleExact")
+        B = new PNFSetScale(BMCONFIG.datasetsize, true);
+    else if (BMCONFIG.bm_name == "PNFStress")
+        B = new PNFStress(BMCONFIG.datasetsize, false);
+    else if (BMCONFIG.bm_name == "PNFStressUser")
+        B = new PNFStress(BMCONFIG.datasetsize, true);
+    else if (BMCONFIG.bm_name == "CMDispatch")
+        B = new CMDispatch(true);
+    else if (BMCONFIG.bm_name == "CMDispatchVirtual")
+        B = new CMDispatch(false);
+    else if (BMCONFIG.bm_name == "RTPeriodic")
+        B = new RTPeriodic(BMCONFIG.datasetsize);
+    else if (BMCONFIG.bm_name == "CMTimeCost")
+        B = new CMTimeCost(false);
+    else if (BMCONFIG.bm_name == "CMTimeCostRealtime")
+        B = new CMTimeCost(true);
+    else if (BMCONFIG.bm_name == "TimestampScale")
+        B = new TimestampScale(true);
+    else if (BMCONFIG.bm_name == "TimestampScaleFai")
+        B = new TimestampScale(false);
+    else if (BMCONFIG.bm_name == "AtomicCost")
+        B = new AtomicCost();
+    else if (BMCONFIG.bm_name == "OrecAlias")
+        B = new OrecAlias(BMCONFIG.datasetsize);
+    else if (BMCONFIG.bm_name == "TimeBaseScale")
+        B = new TimeBaseScale();
     else
         argError("Unrecognized benchmark name " + BMCONFIG.bm_name);
 
@@ -372,6 +372,18 @@ void Benchmark::measure_speed()
 #endif
              << endl;
     }
+
+    // per-thread transaction statistics, if asked for
+    if (BMCONFIG.stats_format != "") {
+#if defined(STM_LIB_RSTM)
+        stm::dumpStats(cout, BMCONFIG.stats_format == "json");
+        if (BMCONFIG.stm_validation == "invis-adapt" ||
+            BMCONFIG.stm_validation == "vis-adapt")
+            stm::dumpSites(cout, BMCONFIG.stats_format == "json");
+#else
+        cout << "Transaction statistics are only kept by RSTM" << endl;
+#endif
+    }
 }
 
 // make sure all the parameters make sense
@@ -387,14 +399,20 @@ void BenchmarkConfig::verifyParameters()
         argError("read-only rate is higher than 96%");
     if ((stm_validation != "vis-eager") && (stm_validation != "vis-lazy") &&
         (stm_validation != "invis-eager") && (stm_validation != "invis-lazy") &&
+        (stm_validation != "vis-adapt") && (stm_validation != "invis-adapt") &&
         (stm_validation != "ee") && (stm_validation != "el") &&
         (stm_validation != "ll"))
         argError("Invalid validation strategy");
-    if ((stm_validation == "vis-eager" || stm_validation == "vis-lazy") &&
-        (threads > 31))
-        argError("only up to 31 visible readers are currently supported");
+    if ((stm_validation == "vis-eager" || stm_validation == "vis-lazy" ||
+         stm_validation == "vis-adapt") &&
+        (threads >= MAX_THREADS))
+        argError("only up to MAX_THREADS - 1 visible readers are supported");
     if (unit_testing != 'l' && unit_testing != 'h' && unit_testing != ' ')
         argError("Invalid unit testing parameter: " + unit_testing);
+    if (stats_format != "" && stats_format != "csv" && stats_format != "json")
+        argError("Invalid statistics format: " + stats_format);
+    if (orec_bits < 0 || orec_bits > 30 || orec_shift < 0 || orec_shift > 12)
+        argError("-O wants 1-30 orec bits and a 0-12 stripe shift");
 }
 
 // print parameters if verbosity level permits
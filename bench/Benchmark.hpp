@@ -67,13 +67,20 @@ struct BenchmarkConfig
     char unit_testing;
     bool inev;
     bool priority;
+    std::string stats_format;           // "csv", "json", or "" for none
+    // orec table for the orec-based word STMs: log2 orecs (0 for the
+    // library default), log2 bytes per stripe, and hashed or masked index
+    int orec_bits;
+    int orec_shift;
+    bool orec_hash;
     BenchmarkConfig()
         : duration(5), datasetsize(256), threads(2), verbosity(1),
           verify(true), cm_type("Polka"), bm_name("RBTree"),
           stm_validation("invis-eager"), use_static_cm(true),
           lookupPct(34), insertPct(67),
           doWarmup(false), execute(0), unit_testing(' '), inev(false),
-          priority(false)
+          priority(false), stats_format(""),
+          orec_bits(0), orec_shift(3), orec_hash(true)
     { }
 
     void verifyParameters();
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CMDISPATCH_HPP__
+#define CMDISPATCH_HPP__
+
+#include <stm/stm.hpp>
+#include <iostream>
+#include "Benchmark.hpp"
+
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+#include <stm/cm/CMPolicies.hpp>
+#endif
+
+namespace bench
+{
+  /**
+   *  Measure the cost of one conflict resolution for the CM picked with -C
+   *  (or the static CM), apart from everything else a transaction does.
+   *  Each thread has a pair of CM policies, and each "transaction" resolves
+   *  BATCH RAW, WAR and WAW conflicts between them, so the time per
+   *  resolution is the run time divided by BATCH times the transaction
+   *  count.  CMDispatch goes through SwitchCMPolicy, which calls the
+   *  real-time CMs directly; CMDispatchVirtual goes through
+   *  PureDynamicCMPolicy, which makes a virtual call every time, e.g.:
+   *
+   *     for cm in ECM RCM LCM FIFO PNF FBLT; do
+   *       Bench -B CMDispatch        -C $cm -p 1
+   *       Bench -B CMDispatchVirtual -C $cm -p 1
+   *     done
+   *
+   *  The two CMs have set deadlines and start times, with the enemy
+   *  started first but due later, so LCM and FBLT take their alpha test.
+   *  With -v the run also prints the size of the real-time CM objects,
+   *  to compare layouts along with the time per resolution.
+   */
+  class CMDispatch : public Benchmark
+  {
+      /*** conflicts resolved per transaction */
+      static const int BATCH = 64;
+
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+      /*** a conflicting pair of CMs behind one policy type */
+      template <class Policy>
+      struct Pair
+      {
+          Policy me;
+          Policy enemy;
+
+          Pair()
+              : me(BMCONFIG.use_static_cm, BMCONFIG.cm_type),
+                enemy(BMCONFIG.use_static_cm, BMCONFIG.cm_type)
+          {
+              if (!me.getCM() || !enemy.getCM())
+                  return;
+              setup(me.getCM(), 1);
+              setup(enemy.getCM(), 2);
+              // the enemy started earlier
+              enemy.getCM()->stamp = me.getCM()->stamp - 1000;
+          }
+
+          static void setup(stm::ContentionManager* cm, int deadline)
+          {
+              cm->stamp = stm::CMClock::now();
+              struct timespec d = { deadline, 0 };
+              cm->setTimeParam(d);
+              cm->setLength(1000);
+              cm->setPsy(0.5);
+              cm->m_set = false;
+              cm->cur_state = stm::released;
+          }
+
+          /*** resolve BATCH conflicts; return how many went our way */
+          unsigned long resolve()
+          {
+              if (!me.getCM() || !enemy.getCM())
+                  return 0;
+              stm::ContentionManager* e = enemy.getCM();
+              unsigned long wins = 0;
+              for (int i = 0; i < BATCH; i += 3) {
+                  wins += (me.onRAW(e) == stm::AbortOther);
+                  wins += (me.onWAR(e) == stm::AbortOther);
+                  wins += (me.onWAW(e) == stm::AbortOther);
+              }
+              return wins;
+          }
+      };
+
+      Pair<stm::SwitchCMPolicy>*      direct[MAX_THREADS];
+      Pair<stm::PureDynamicCMPolicy>* indirect[MAX_THREADS];
+#endif
+
+      bool devirtualized;
+
+      /*** resolutions made, and how many aborted the enemy */
+      volatile unsigned long resolutions;
+      volatile unsigned long wins;
+
+    public:
+      CMDispatch(bool _devirtualized)
+          : devirtualized(_devirtualized), resolutions(0), wins(0)
+      {
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+          for (int i = 0; i < MAX_THREADS; i++) {
+              direct[i] = NULL;
+              indirect[i] = NULL;
+          }
+#endif
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+          int id = args->id % MAX_THREADS;
+          unsigned long w;
+          if (devirtualized) {
+              if (!direct[id])
+                  direct[id] = new Pair<stm::SwitchCMPolicy>();
+              w = direct[id]->resolve();
+          }
+          else {
+              if (!indirect[id])
+                  indirect[id] = new Pair<stm::PureDynamicCMPolicy>();
+              w = indirect[id]->resolve();
+          }
+          faa(&resolutions, 3 * ((BATCH + 2) / 3));
+          faa(&wins, w);
+#endif
+      }
+
+      virtual bool sanity_check() const
+      {
+          if (BMCONFIG.verbosity > 0)
+          {
+              std::cout << "CM resolutions: " << resolutions
+                        << ", enemy aborted: " << wins << std::endl;
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+              std::cout << "CM bytes: ContentionManager "
+                        << sizeof(stm::ContentionManager)
+                        << ", PNF " << sizeof(stm::PNF)
+                        << ", FBLT " << sizeof(stm::FBLT)
+                        << ", LCM " << sizeof(stm::LCM) << std::endl;
+#endif
+          }
+          return true;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // CMDISPATCH_HPP__
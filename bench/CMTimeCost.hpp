@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef CMTIMECOST_HPP__
+#define CMTIMECOST_HPP__
+
+#include <stm/stm.hpp>
+#include <time.h>
+#include <iostream>
+#include "Benchmark.hpp"
+
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+#include <stm/cm/CMClock.hpp>
+#endif
+
+namespace bench
+{
+  /**
+   *  Measure the clock work a real-time CM does per transaction, without
+   *  the transaction.  Each "transaction" repeats BATCH times what LCM and
+   *  FBLT do for one transaction that conflicts once and aborts once: take
+   *  a start time, compare start times and deadlines with an enemy, work
+   *  out the fraction of the enemy's length that has passed, and add the
+   *  time since the start to the abort total.  CMTimeCost does it with
+   *  CMClock ticks and 64-bit keys, as the CMs now do; CMTimeCostRealtime
+   *  does it the old way, with clock_gettime(CLOCK_REALTIME) and
+   *  field-by-field timespec compares, e.g.:
+   *
+   *     Bench -B CMTimeCost -p 1 -v
+   *     Bench -B CMTimeCostRealtime -p 1 -v
+   *
+   *  With -v, sanity_check() says which source CMClock chose.
+   */
+  class CMTimeCost : public Benchmark
+  {
+      /*** simulated transactions per call */
+      static const int BATCH = 64;
+
+      bool realtime;
+
+      /*** conflicts won, summed so the work can't be optimized away */
+      volatile unsigned long wins;
+      volatile unsigned long long abort_ns;
+
+      static bool before(const struct timespec& a, const struct timespec& b)
+      {
+          return a.tv_sec < b.tv_sec ||
+              (a.tv_sec == b.tv_sec && a.tv_nsec <= b.tv_nsec);
+      }
+
+      static long long diff_ns(const struct timespec& a,
+                               const struct timespec& b)
+      {
+          return (long long)(b.tv_sec - a.tv_sec) * 1000000000LL +
+              (b.tv_nsec - a.tv_nsec);
+      }
+
+      void runRealtime()
+      {
+          struct timespec enemy_stamp, enemy_deadline = { 2, 0 };
+          struct timespec deadline = { 1, 0 };
+          clock_gettime(CLOCK_REALTIME, &enemy_stamp);
+          unsigned long w = 0;
+          unsigned long long total = 0;
+          for (int i = 0; i < BATCH; i++) {
+              struct timespec stamp, now, abort;
+              clock_gettime(CLOCK_REALTIME, &stamp);
+              if (before(deadline, enemy_deadline) && !before(stamp, enemy_stamp)) {
+                  clock_gettime(CLOCK_REALTIME, &now);
+                  long double passed =
+                      ((long double)diff_ns(enemy_stamp, now) / 1000) / 1000;
+                  w += (passed <= 0.5);
+              }
+              clock_gettime(CLOCK_REALTIME, &abort);
+              total += diff_ns(stamp, abort);
+          }
+          faa(&wins, w);
+          __sync_fetch_and_add(&abort_ns, total);
+      }
+
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+      void runTicks()
+      {
+          struct timespec enemy_deadline = { 2, 0 }, deadline = { 1, 0 };
+          stm::cm_ticks_t enemy_stamp = stm::CMClock::now();
+          unsigned long long enemy_key = stm::timespec_key(enemy_deadline);
+          unsigned long long key = stm::timespec_key(deadline);
+          unsigned long w = 0;
+          unsigned long long total = 0;
+          for (int i = 0; i < BATCH; i++) {
+              stm::cm_ticks_t stamp = stm::CMClock::now();
+              if (key <= enemy_key && stamp > enemy_stamp) {
+                  long double passed = ((long double)stm::CMClock::to_ns(
+                      stm::CMClock::now() - enemy_stamp) / 1000) / 1000;
+                  w += (passed <= 0.5);
+              }
+              total += stm::CMClock::to_ns(stm::CMClock::now() - stamp);
+          }
+          faa(&wins, w);
+          __sync_fetch_and_add(&abort_ns, total);
+      }
+#endif
+
+    public:
+      CMTimeCost(bool _realtime)
+          : realtime(_realtime), wins(0), abort_ns(0)
+      {
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+          stm::CMClock::init();
+#endif
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+          if (!realtime) {
+              runTicks();
+              return;
+          }
+#endif
+          runRealtime();
+      }
+
+      virtual bool sanity_check() const
+      {
+          if (BMCONFIG.verbosity > 0) {
+#if defined(STM_LIB_RSTM) || defined(STM_LIB_REDO_LOCK)
+              if (!realtime)
+                  std::cout << "CMClock source: "
+                            << (stm::CMClock::usesTSC() ? "TSC" : "CLOCK_MONOTONIC")
+                            << std::endl;
+#endif
+              std::cout << "conflicts won: " << wins
+                        << ", abort time (ns): " << abort_ns << std::endl;
+          }
+          return true;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // CMTIMECOST_HPP__
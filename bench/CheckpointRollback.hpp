@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef CHECKPOINTROLLBACK_HPP__
+#define CHECKPOINTROLLBACK_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include "Benchmark.hpp"
+
+// only RSTM can roll back to a checkpoint; elsewhere run the same workload
+// with full restarts
+#ifndef CHECKPOINT
+#define CHECKPOINT()
+#endif
+
+namespace bench
+{
+  /**
+   *  Measure what partial rollback saves over restarting the whole
+   *  transaction.  Each thread owns m (the -m parameter) private cells plus a
+   *  few more, and there are a handful of hot shared cells.  Readers (-R
+   *  percent of the transactions) read their m private cells, take a
+   *  checkpoint, read one hot cell, and then read TAIL more private cells;
+   *  each of those opens validates, so a hot cell that changed in between is
+   *  caught while the transaction is still running.  Everyone else
+   *  increments a hot cell.
+   *
+   *  With checkpoints, a conflict on the hot cell only repeats the work done
+   *  after the checkpoint; without them, the m prefix reads are repeated too.
+   *  Compare the two as m grows, e.g.:
+   *
+   *     for m in 16 64 256 1024; do
+   *       Bench -B CheckpointRollback    -R 80 -m $m -p 8
+   *       Bench -B CheckpointRollbackOff -R 80 -m $m -p 8
+   *     done
+   */
+  class CheckpointRollback : public Benchmark
+  {
+      class Cell : public stm::Object
+      {
+          GENERATE_FIELD(int, value);
+        public:
+          Cell() : m_value(INITIAL) { }
+      };
+
+      /*** starting value of each private cell */
+      static const int INITIAL = 1;
+
+      /*** number of hot shared cells */
+      static const int HOT = 4;
+
+      /*** private reads after the checkpoint */
+      static const int TAIL = 4;
+
+      int PREFIX;
+      int PER_THREAD;
+      bool use_checkpoints;
+      std::vector<stm::sh_ptr<Cell> > priv;
+      std::vector<stm::sh_ptr<Cell> > hot;
+
+    public:
+      CheckpointRollback(int elements, bool checkpoints)
+          : PREFIX(elements), PER_THREAD(elements + TAIL),
+            use_checkpoints(checkpoints)
+      {
+          for (int i = 0; i < PER_THREAD * BMCONFIG.threads; i++)
+              priv.push_back(stm::sh_ptr<Cell>(new Cell()));
+          for (int i = 0; i < HOT; i++)
+              hot.push_back(stm::sh_ptr<Cell>(new Cell()));
+#if defined(STM_LIB_RSTM)
+          STM_CHECKPOINT = checkpoints;
+#endif
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          int h = val % HOT;
+          if (action < BMCONFIG.lookupPct) {
+              int base = args->id * PER_THREAD;
+              // a partial rollback resumes after CHECKPOINT() with the value
+              // prefix had there, so it must not live in a register
+              volatile int prefix = 0;
+              int sum = 0;
+              BEGIN_TRANSACTION {
+                  prefix = 0;
+                  for (int i = 0; i < PREFIX; i++) {
+                      stm::rd_ptr<Cell> r(priv[base + i]);
+                      prefix += r->get_value(r);
+                  }
+                  if (use_checkpoints)
+                      CHECKPOINT();
+                  stm::rd_ptr<Cell> c(hot[h]);
+                  sum = prefix + c->get_value(c);
+                  for (int i = PREFIX; i < PER_THREAD; i++) {
+                      stm::rd_ptr<Cell> r(priv[base + i]);
+                      sum += r->get_value(r);
+                  }
+              } END_TRANSACTION;
+          }
+          else {
+              BEGIN_TRANSACTION {
+                  stm::wr_ptr<Cell> c(hot[h]);
+                  c->set_value(c->get_value(c) + 1, c);
+              } END_TRANSACTION;
+          }
+      }
+
+      // only the hot cells are ever written
+      virtual bool sanity_check() const
+      {
+          long sum = 0;
+          BEGIN_TRANSACTION {
+              sum = 0;
+              for (unsigned i = 0; i < priv.size(); i++) {
+                  stm::rd_ptr<Cell> r(priv[i]);
+                  sum += r->get_value(r);
+              }
+          } END_TRANSACTION;
+          return sum == (long)priv.size() * INITIAL;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // CHECKPOINTROLLBACK_HPP__
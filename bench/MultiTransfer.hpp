@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef MULTITRANSFER_HPP__
+#define MULTITRANSFER_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include "Benchmark.hpp"
+
+namespace bench
+{
+  /**
+   *  Multi-object transfers.  There are m (the -m parameter) accounts, and
+   *  every transaction picks PICKS of them at random and moves one unit from
+   *  the first to each of the others, so the write set is known before the
+   *  transaction opens anything.  With batching on, RSTM acquires the whole
+   *  write set up front with stm::open_write_batch() (prefetched, in address
+   *  order, validated once); with it off, each account is acquired as it is
+   *  opened.  The total over all accounts never changes.
+   *
+   *  Compare the two with a small -m to see contention, e.g.:
+   *
+   *     Bench -B MultiTransfer    -m 64 -p 8
+   *     Bench -B MultiTransferSeq -m 64 -p 8
+   */
+  class MultiTransfer : public Benchmark
+  {
+      class Account : public stm::Object
+      {
+          GENERATE_FIELD(int, balance);
+        public:
+          Account() : m_balance(INITIAL) { }
+      };
+
+      /*** starting balance of each account */
+      static const int INITIAL = 1000;
+
+      /*** number of accounts each transaction writes */
+      static const int PICKS = 4;
+
+      int ACCOUNTS;
+      bool batched;
+      std::vector<stm::sh_ptr<Account> > accounts;
+
+    public:
+      MultiTransfer(int elements, bool batch)
+          : ACCOUNTS(elements), batched(batch)
+      {
+          for (int i = 0; i < ACCOUNTS; i++)
+              accounts.push_back(stm::sh_ptr<Account>(new Account()));
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          // duplicates are fine: a transfer to yourself nets out to zero
+          stm::sh_ptr<Account> picks[PICKS];
+          for (int i = 0; i < PICKS; i++)
+              picks[i] = accounts[rand_r(seed) % ACCOUNTS];
+
+          BEGIN_TRANSACTION {
+#if defined(STM_LIB_RSTM)
+              if (batched)
+                  stm::open_write_batch(picks, PICKS);
+#endif
+              for (int i = 1; i < PICKS; i++) {
+                  stm::wr_ptr<Account> from(picks[0]);
+                  from->set_balance(from->get_balance(from) - 1, from);
+                  stm::wr_ptr<Account> to(picks[i]);
+                  to->set_balance(to->get_balance(to) + 1, to);
+              }
+          } END_TRANSACTION;
+      }
+
+      // transfers never change the total
+      virtual bool sanity_check() const
+      {
+          long sum = 0;
+          BEGIN_TRANSACTION {
+              sum = 0;
+              for (int i = 0; i < ACCOUNTS; i++) {
+                  stm::rd_ptr<Account> r(accounts[i]);
+                  sum += r->get_balance(r);
+              }
+          } END_TRANSACTION;
+          return sum == (long)ACCOUNTS * INITIAL;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // MULTITRANSFER_HPP__
@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef ORECALIAS_HPP__
+#define ORECALIAS_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include <map>
+#include <iostream>
+#include "Benchmark.hpp"
+
+namespace bench
+{
+  /**
+   *  Measure false conflicts from the orec table of the orec-based word
+   *  STMs (LLT, ET, Fair, Flow, Strict, SGLA).  There are m (the -m
+   *  parameter) separately allocated counters, and every transaction
+   *  increments PICKS distinct ones at random.  With m large, two
+   *  transactions rarely pick the same counter, so nearly every abort the
+   *  library reports at shutdown comes from two counters sharing an orec.
+   *  With -v, sanity_check() also prints how many counters share their
+   *  orec with another under the current table.
+   *
+   *  Sweep the table size, stripe and index with -O, here and on the
+   *  RBTree and HashTable benchmarks for throughput, e.g.:
+   *
+   *     for o in 10 14 18 22 14:6 18:6 14:3:mask 18:3:mask; do
+   *       Bench -B OrecAlias  -m 65536 -p 4 -O $o -v
+   *       Bench -B RBTree     -m 65536 -p 4 -O $o
+   *       Bench -B HashTable  -m 65536 -p 4 -O $o
+   *     done
+   */
+  class OrecAlias : public Benchmark
+  {
+      class Cell : public stm::Object
+      {
+          GENERATE_FIELD(int, value);
+        public:
+          Cell() : m_value(0) { }
+          const void* where() const { return &m_value; }
+      };
+
+      /*** number of counters each transaction increments */
+      static const int PICKS = 4;
+
+      int CELLS;
+      std::vector<stm::sh_ptr<Cell> > cells;
+      std::vector<const void*> addrs;
+
+      volatile unsigned long increments;
+
+    public:
+      OrecAlias(int elements) : CELLS(elements), increments(0)
+      {
+          for (int i = 0; i < CELLS; i++) {
+              Cell* c = new Cell();
+              addrs.push_back(c->where());
+              cells.push_back(stm::sh_ptr<Cell>(c));
+          }
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          int picks[PICKS];
+          for (int i = 0; i < PICKS; i++) {
+              bool again;
+              do {
+                  picks[i] = rand_r(seed) % CELLS;
+                  again = false;
+                  for (int j = 0; j < i; j++)
+                      again |= (picks[j] == picks[i]);
+              } while (again && CELLS >= PICKS);
+          }
+
+          BEGIN_TRANSACTION {
+              for (int i = 0; i < PICKS; i++) {
+                  stm::wr_ptr<Cell> c(cells[picks[i]]);
+                  c->set_value(c->get_value(c) + 1, c);
+              }
+          } END_TRANSACTION;
+          faa(&increments, PICKS);
+      }
+
+      // every increment landed exactly once
+      virtual bool sanity_check() const
+      {
+          long sum = 0;
+          BEGIN_TRANSACTION {
+              sum = 0;
+              for (int i = 0; i < CELLS; i++) {
+                  stm::rd_ptr<Cell> r(cells[i]);
+                  sum += r->get_value(r);
+              }
+          } END_TRANSACTION;
+#if defined(STM_OREC_TABLE)
+          if (BMCONFIG.verbosity > 0) {
+              typedef stm::OrecWBTxThread T;
+              std::map<unsigned long, int> users;
+              for (int i = 0; i < CELLS; i++)
+                  users[T::orec_index(addrs[i])]++;
+              int shared = 0;
+              for (int i = 0; i < CELLS; i++)
+                  shared += (users[T::orec_index(addrs[i])] > 1);
+              std::cout << "orecs: " << T::orec_count()
+                        << ", stripe: " << (1 << T::orec_shift()) << " bytes, "
+                        << (T::orec_hashed() ? "hashed" : "masked")
+                        << "; counters sharing an orec: " << shared << " of "
+                        << CELLS << std::endl;
+          }
+#endif
+          return sum == (long)increments;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // ORECALIAS_HPP__
@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PNFSETSCALE_HPP__
+#define PNFSETSCALE_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include <iostream>
+#include "Benchmark.hpp"
+
+#if defined(STM_LIB_RSTM)
+#include <stm/cm/PNFObjectSet.hpp>
+#endif
+
+namespace bench
+{
+  /**
+   *  Measure PNF's m_set admission on its own, without the real-time
+   *  scheduling around it.  There are m (the -m parameter) counters, and
+   *  every transaction picks PICKS of them at random, builds their PNF
+   *  object set, and waits until it can join a conflict set of width m
+   *  (as a PNF transaction waits in the n_set) before incrementing them and
+   *  leaving.  The old 64-bit bitmap could only tell apart 64 objects;
+   *  sweep m to see the cost of admission and, in hashed mode, how often a
+   *  transaction has to wait for a conflict on a shared bit rather than a
+   *  shared object, e.g.:
+   *
+   *     for m in 16 256 4096 65536; do
+   *       Bench -B PNFSetScale      -m $m -p 4
+   *       Bench -B PNFSetScaleExact -m $m -p 4
+   *     done
+   *
+   *  The hashed variant uses STM_PNF_SET_BITS bits, regardless of m.
+   */
+  class PNFSetScale : public Benchmark
+  {
+      class Cell : public stm::Object
+      {
+          GENERATE_FIELD(int, value);
+        public:
+          Cell() : m_value(0) { }
+      };
+
+      /*** number of counters each transaction increments */
+      static const int PICKS = 4;
+
+      int CELLS;
+      std::vector<stm::sh_ptr<Cell> > cells;
+
+#if defined(STM_LIB_RSTM)
+      stm::PNFConflictSet held;
+#endif
+      volatile unsigned long lock;
+
+      /*** increments made, and times a transaction had to wait to join */
+      volatile unsigned long increments;
+      volatile unsigned long waits;
+
+    public:
+      PNFSetScale(int elements, bool exact)
+          : CELLS(elements), lock(0), increments(0), waits(0)
+      {
+          for (int i = 0; i < CELLS; i++)
+              cells.push_back(stm::sh_ptr<Cell>(new Cell()));
+#if defined(STM_LIB_RSTM)
+          if (exact)
+              held.configure(2 * CELLS, true);
+#endif
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          std::vector<double> picks;
+          for (int i = 0; i < PICKS; i++)
+              picks.push_back(rand_r(seed) % CELLS);
+
+#if defined(STM_LIB_RSTM)
+          stm::PNFObjectSet mine;
+          held.build(mine, picks);
+          while (true) {
+              while (!bool_cas(&lock, 0, 1))
+                  spin64();
+              bool joined = !held.overlaps(mine);
+              if (joined)
+                  held.join(mine);
+              lock = 0;
+              if (joined)
+                  break;
+              fai(&waits);
+              spin64();
+          }
+#endif
+
+          // duplicate picks increment the same counter twice
+          BEGIN_TRANSACTION {
+              for (int i = 0; i < PICKS; i++) {
+                  stm::wr_ptr<Cell> c(cells[(int)picks[i]]);
+                  c->set_value(c->get_value(c) + 1, c);
+              }
+          } END_TRANSACTION;
+          faa(&increments, PICKS);
+
+#if defined(STM_LIB_RSTM)
+          while (!bool_cas(&lock, 0, 1))
+              spin64();
+          held.leave(mine);
+          lock = 0;
+#endif
+      }
+
+      // every increment landed exactly once
+      virtual bool sanity_check() const
+      {
+          long sum = 0;
+          BEGIN_TRANSACTION {
+              sum = 0;
+              for (int i = 0; i < CELLS; i++) {
+                  stm::rd_ptr<Cell> r(cells[i]);
+                  sum += r->get_value(r);
+              }
+          } END_TRANSACTION;
+          if (BMCONFIG.verbosity > 0)
+              std::cout << "PNF admission waits: " << waits << std::endl;
+          return sum == (long)increments;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // PNFSETSCALE_HPP__
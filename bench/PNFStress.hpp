@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PNFSTRESS_HPP__
+#define PNFSTRESS_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include <iostream>
+#include "Benchmark.hpp"
+
+#if defined(STM_LIB_RSTM)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <stm/cm/PNF.hpp>
+#endif
+
+namespace bench
+{
+  /**
+   *  Drive PNF through the pnf_main service, to measure what admission
+   *  costs a transaction and what the service costs the machine.  There
+   *  are m (the -m parameter) counters; every transaction picks PICKS of
+   *  them at random, asks pnf_main to admit it (timed: this is the
+   *  admission latency), increments them, and tells pnf_main it has
+   *  committed.  Each bench thread has its own PNF contention manager,
+   *  with its thread id as time_param so the n_set has a fixed order.
+   *
+   *  With -v, sanity_check() prints the mean and worst admission latency,
+   *  and the service's request, park and n_set scan counts and its CPU
+   *  time.  A busy-polling service burns a whole core for the run; a
+   *  parked one should use a small fraction of it.  Vary -m to change how
+   *  often transactions wait in the n_set, e.g.:
+   *
+   *     Bench -B PNFStress -m 8 -p 8 -d 5
+   *     Bench -B PNFStress -m 4096 -p 8 -d 5
+   *
+   *  PNFStress moves transactions in and out of the m_set with
+   *  SCHED_FIFO priorities (CM_PRIO_SCHED); PNFStressUser does it with
+   *  the user-space gate (CM_PRIO_USER).  With -v both print how many
+   *  priority changes went to the kernel and how often transactions
+   *  parked on, or were woken from, the gate, to go with the throughput.
+   *  Without the privilege to use SCHED_FIFO the priority calls fail,
+   *  but they are still made and counted.
+   */
+  class PNFStress : public Benchmark
+  {
+      class Cell : public stm::Object
+      {
+          GENERATE_FIELD(int, value);
+        public:
+          Cell() : m_value(0) { }
+      };
+
+      /*** number of counters each transaction increments */
+      static const int PICKS = 4;
+
+      int CELLS;
+      bool user_prio;
+      std::vector<stm::sh_ptr<Cell> > cells;
+
+      volatile unsigned long increments;
+
+#if defined(STM_LIB_RSTM)
+      stm::PNF* pnf[MAX_THREADS];
+
+      /*** admission latency in ns: total, worst, and number of samples */
+      volatile unsigned long long lat_total;
+      volatile unsigned long long lat_max;
+      volatile unsigned long      lat_count;
+
+      static unsigned long long ns(const struct timespec& ts)
+      {
+          return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+      }
+
+      stm::PNF* manager(int id)
+      {
+          if (!pnf[id]) {
+              stm::PNF* p = new stm::PNF();
+              p->setCurThr(syscall(SYS_gettid));
+              struct timespec key = { id, 0 };
+              p->setTimeParam(key);
+              pnf[id] = p;
+          }
+          return pnf[id];
+      }
+#endif
+
+    public:
+      PNFStress(int elements, bool _user_prio)
+          : CELLS(elements), user_prio(_user_prio), increments(0)
+      {
+          for (int i = 0; i < CELLS; i++)
+              cells.push_back(stm::sh_ptr<Cell>(new Cell()));
+#if defined(STM_LIB_RSTM)
+          for (int i = 0; i < MAX_THREADS; i++)
+              pnf[i] = NULL;
+          lat_total = lat_max = 0;
+          lat_count = 0;
+          stm::pnf_set_configure(2 * CELLS, true);
+          stm::cm_prio_configure(user_prio ? stm::CM_PRIO_USER
+                                           : stm::CM_PRIO_SCHED);
+          stm::pnf_main_start();
+#endif
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          std::vector<double> picks;
+          for (int i = 0; i < PICKS; i++)
+              picks.push_back(rand_r(seed) % CELLS);
+
+#if defined(STM_LIB_RSTM)
+          stm::PNF* cm = manager(args->id % MAX_THREADS);
+          cm->setAccObj(picks);
+          struct timespec t0, t1;
+          clock_gettime(CLOCK_MONOTONIC, &t0);
+          cm->onBeginTransaction();
+          clock_gettime(CLOCK_MONOTONIC, &t1);
+          unsigned long long d = ns(t1) - ns(t0);
+          __sync_fetch_and_add(&lat_total, d);
+          fai(&lat_count);
+          unsigned long long m = lat_max;
+          while (d > m && !__sync_bool_compare_and_swap(&lat_max, m, d))
+              m = lat_max;
+#endif
+
+          // duplicate picks increment the same counter twice
+          BEGIN_TRANSACTION {
+              for (int i = 0; i < PICKS; i++) {
+                  stm::wr_ptr<Cell> c(cells[(int)picks[i]]);
+                  c->set_value(c->get_value(c) + 1, c);
+              }
+          } END_TRANSACTION;
+          faa(&increments, PICKS);
+
+#if defined(STM_LIB_RSTM)
+          cm->onTransactionCommitted();
+#endif
+      }
+
+      // every increment landed exactly once
+      virtual bool sanity_check() const
+      {
+          long sum = 0;
+          BEGIN_TRANSACTION {
+              sum = 0;
+              for (int i = 0; i < CELLS; i++) {
+                  stm::rd_ptr<Cell> r(cells[i]);
+                  sum += r->get_value(r);
+              }
+          } END_TRANSACTION;
+#if defined(STM_LIB_RSTM)
+          // the workers are done; stop the service so it reports its CPU time
+          stm::pnf_main_stop();
+          if (BMCONFIG.verbosity > 0) {
+              std::cout << "PNF admissions: " << lat_count
+                        << ", mean latency (ns): "
+                        << (lat_count ? lat_total / lat_count : 0)
+                        << ", max latency (ns): " << lat_max << std::endl;
+              std::cout << "pnf_main requests: " << stm::pnf_stats.events
+                        << ", parks: " << stm::pnf_stats.parks
+                        << ", n_set scans: " << stm::pnf_stats.scans
+                        << ", cpu (ns): " << stm::pnf_stats.cpu_ns
+                        << std::endl;
+              std::cout << (user_prio ? "user" : "sched")
+                        << " priorities: kernel priority calls: "
+                        << stm::cm_prio_gate.stats.sched_calls
+                        << ", gate parks: " << stm::cm_prio_gate.stats.parks
+                        << ", gate wakes: " << stm::cm_prio_gate.stats.wakes
+                        << std::endl;
+          }
+#endif
+          return sum == (long)increments;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+
+      virtual ~PNFStress()
+      {
+#if defined(STM_LIB_RSTM)
+          stm::pnf_main_stop();
+          for (int i = 0; i < MAX_THREADS; i++)
+              delete pnf[i];
+#endif
+      }
+  };
+
+} // namespace bench
+
+#endif // PNFSTRESS_HPP__
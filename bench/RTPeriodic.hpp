@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef RTPERIODIC_HPP__
+#define RTPERIODIC_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include <iostream>
+#include <sched.h>
+#include "Benchmark.hpp"
+
+#if defined(STM_LIB_RSTM)
+#include <stm/cm/CMClock.hpp>
+#include <stm/cm/RTTask.hpp>
+#endif
+
+namespace bench
+{
+  /**
+   *  A synthetic set of periodic real-time tasks, to see how often the
+   *  real-time CMs let transactions miss their deadlines.  Each bench
+   *  thread is a task whose period (and relative deadline) is PERIOD_US
+   *  times 1 + id % 4, so the task set has four rates.  Each job is one
+   *  transaction: it waits for its release, then increments PICKS of the
+   *  m (the -m parameter) counters and holds them for LENGTH_US.  The job
+   *  misses if it commits after release + period.  Releases are fixed, so
+   *  a late job leaves less time for the next one.
+   *
+   *  Each task passes its RTTask, with the job's deadline in due, to
+   *  BEGIN_RT_TRANSACTION, so a CM picked with -C sees real deadlines;
+   *  compare a CM with its adaptive variant, e.g.:
+   *
+   *     Bench -B RTPeriodic -C FBLT -m 16 -p 8 -d 5 -v
+   *     Bench -B RTPeriodic -C AdaptiveFBLT -m 16 -p 8 -d 5 -v
+   *
+   *  With -v, sanity_check() prints the jobs run and the deadline-miss
+   *  ratio.
+   */
+  class RTPeriodic : public Benchmark
+  {
+      class Cell : public stm::Object
+      {
+          GENERATE_FIELD(int, value);
+        public:
+          Cell() : m_value(0) { }
+      };
+
+      /*** counters each job increments */
+      static const int PICKS = 4;
+
+      /*** period of the fastest tasks, and the length of every job */
+      static const unsigned long PERIOD_US = 500;
+      static const unsigned long LENGTH_US = 50;
+
+      int CELLS;
+      std::vector<stm::sh_ptr<Cell> > cells;
+
+      volatile unsigned long increments;
+      volatile unsigned long jobs;
+      volatile unsigned long misses;
+
+#if defined(STM_LIB_RSTM)
+      struct Task
+      {
+          stm::RTTask      rt;
+          stm::cm_ticks_t  release;   // of the next job
+          stm::cm_ticks_t  period;
+      };
+
+      Task* tasks[MAX_THREADS];
+
+      Task* task(int id)
+      {
+          if (!tasks[id]) {
+              Task* t = new Task();
+              unsigned long us = PERIOD_US * (1 + id % 4);
+              t->period = (stm::cm_ticks_t)stm::CMClock::from_ns(us * 1000.0);
+              t->release = stm::CMClock::now();
+              struct timespec p = { 0, (long)us * 1000 };
+              t->rt.setTimeParam(p);
+              t->rt.length = LENGTH_US;
+              t->rt.psy = 0.5;
+              t->rt.eta = 3;
+              t->rt.th = id;
+              t->rt.touch();
+              tasks[id] = t;
+          }
+          return tasks[id];
+      }
+#endif
+
+    public:
+      RTPeriodic(int elements)
+          : CELLS(elements), increments(0), jobs(0), misses(0)
+      {
+          for (int i = 0; i < CELLS; i++)
+              cells.push_back(stm::sh_ptr<Cell>(new Cell()));
+#if defined(STM_LIB_RSTM)
+          for (int i = 0; i < MAX_THREADS; i++)
+              tasks[i] = NULL;
+#endif
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          int picks[PICKS];
+          for (int i = 0; i < PICKS; i++)
+              picks[i] = rand_r(seed) % CELLS;
+
+#if defined(STM_LIB_RSTM)
+          Task* t = task(args->id % MAX_THREADS);
+          while (stm::CMClock::now() < t->release)
+              sched_yield();
+          t->rt.due = t->release + t->period;
+          stm::cm_ticks_t length =
+              (stm::cm_ticks_t)stm::CMClock::from_ns(LENGTH_US * 1000.0);
+
+          BEGIN_RT_TRANSACTION(&t->rt) {
+              stm::cm_ticks_t start = stm::CMClock::now();
+              for (int i = 0; i < PICKS; i++) {
+                  stm::wr_ptr<Cell> c(cells[picks[i]]);
+                  c->set_value(c->get_value(c) + 1, c);
+              }
+              while (stm::CMClock::now() - start < length)
+                  spin64();
+          } END_TRANSACTION;
+
+          fai(&jobs);
+          if (stm::CMClock::now() > t->rt.due)
+              fai(&misses);
+          t->release += t->period;
+#else
+          BEGIN_TRANSACTION {
+              for (int i = 0; i < PICKS; i++) {
+                  stm::wr_ptr<Cell> c(cells[picks[i]]);
+                  c->set_value(c->get_value(c) + 1, c);
+              }
+          } END_TRANSACTION;
+          fai(&jobs);
+#endif
+          faa(&increments, PICKS);
+      }
+
+      // every increment landed exactly once
+      virtual bool sanity_check() const
+      {
+          long sum = 0;
+          BEGIN_TRANSACTION {
+              sum = 0;
+              for (int i = 0; i < CELLS; i++) {
+                  stm::rd_ptr<Cell> r(cells[i]);
+                  sum += r->get_value(r);
+              }
+          } END_TRANSACTION;
+          if (BMCONFIG.verbosity > 0)
+              std::cout << "RT jobs: " << jobs << ", deadline misses: "
+                        << misses << ", miss ratio: "
+                        << (jobs ? (double)misses / jobs : 0) << std::endl;
+          return sum == (long)increments;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+
+      virtual ~RTPeriodic()
+      {
+#if defined(STM_LIB_RSTM)
+          for (int i = 0; i < MAX_THREADS; i++)
+              delete tasks[i];
+#endif
+      }
+  };
+
+} // namespace bench
+
+#endif // RTPERIODIC_HPP__
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef TIMEBASESCALE_HPP__
+#define TIMEBASESCALE_HPP__
+
+#include <stm/stm.hpp>
+#include <iostream>
+#include "Benchmark.hpp"
+
+namespace bench
+{
+  /**
+   *  Measure the time base of LLT and ET (STM_TIME_*, see
+   *  stm/support/TimeBase.hpp) on its own.  Every thread increments a
+   *  counter nobody else touches, so transactions never conflict and
+   *  every one is a writer commit: what stops this from scaling is the
+   *  time base.  With -v, sanity_check() prints which one was built.
+   *
+   *  For the scaling report, build the library once per time base
+   *  (stmconfig, or -DSTM_TIME_GV4 etc. in CXXFLAGS; TSC and vector need
+   *  a 64-bit build) and sweep the thread count up to MAX_THREADS here
+   *  and on Counter, HashTable and RBTree:
+   *
+   *     for p in 1 2 4 8 16 32 64 128 255; do
+   *       Bench -B TimeBaseScale -p $p -d 5 -v
+   *       Bench -B Counter       -p $p -d 5
+   *       Bench -B HashTable     -p $p -d 5 -m 256 -R 33
+   *       Bench -B RBTree        -p $p -d 5 -m 65536 -R 33
+   *     done
+   *
+   *  and compare throughput and the aborts each thread reports at
+   *  shutdown.  GV5 and TSC trade the counter's cache misses for
+   *  validation at every writer commit; vector for a read of every
+   *  thread's clock at begin.
+   */
+  class TimeBaseScale : public Benchmark
+  {
+      class Cell : public stm::Object
+      {
+          GENERATE_FIELD(long, value);
+          char pad[64];      // keep cells on separate lines and orecs
+        public:
+          Cell() : m_value(0) { }
+      };
+
+      stm::sh_ptr<Cell> cells[MAX_THREADS];
+
+      /*** commits, per thread */
+      struct Count
+      {
+          long n;
+          char pad[64 - sizeof(long)];
+      };
+
+      Count done[MAX_THREADS];
+
+    public:
+      TimeBaseScale()
+      {
+          for (int i = 0; i < MAX_THREADS; i++) {
+              cells[i] = stm::sh_ptr<Cell>(new Cell());
+              done[i].n = 0;
+          }
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          BEGIN_TRANSACTION {
+              stm::wr_ptr<Cell> c(cells[args->id]);
+              c->set_value(c->get_value(c) + 1, c);
+          } END_TRANSACTION;
+          done[args->id].n++;
+      }
+
+      // every thread's counter holds its own commits
+      virtual bool sanity_check() const
+      {
+#if defined(STM_TIME_BASE_NAME)
+          if (BMCONFIG.verbosity > 0)
+              std::cout << "time base: " << STM_TIME_BASE_NAME << std::endl;
+#endif
+          bool ok = true;
+          BEGIN_TRANSACTION {
+              ok = true;
+              for (int i = 0; i < MAX_THREADS; i++) {
+                  stm::rd_ptr<Cell> r(cells[i]);
+                  ok &= (r->get_value(r) == done[i].n);
+              }
+          } END_TRANSACTION;
+          return ok;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // TIMEBASESCALE_HPP__
@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef TIMESTAMPSCALE_HPP__
+#define TIMESTAMPSCALE_HPP__
+
+#include <stm/stm.hpp>
+#include <iostream>
+#include "Benchmark.hpp"
+
+#if defined(STM_LIB_RSTM)
+#include <stm/cm/TimestampAllocator.hpp>
+#endif
+
+namespace bench
+{
+  /**
+   *  Measure the priority timestamps of Greedy, Serializer and Reincarnate
+   *  on their own.  Each "transaction" takes BATCH timestamps the way one
+   *  of those CMs takes one per transaction: TimestampScale from per-thread
+   *  ranges of STM_CM_TS_BATCH, TimestampScaleFai with one shared
+   *  fetch-and-increment each, as the CMs used to.  sanity_check() fails
+   *  if a thread's timestamps ever stop increasing.
+   *
+   *  To see what the allocator is worth in real transactions, sweep the
+   *  thread count of the Counter and RBTree benchmarks under each CM, up
+   *  to MAX_THREADS, and compare with a build using -DSTM_CM_TS_BATCH=1:
+   *
+   *     for cm in Greedy Serializer Reincarnate; do
+   *       for p in 1 2 4 8 16 32 64 128 255; do
+   *         Bench -B Counter -C $cm -p $p -d 5
+   *         Bench -B RBTree  -C $cm -p $p -d 5
+   *       done
+   *     done
+   */
+  class TimestampScale : public Benchmark
+  {
+      /*** timestamps taken per call */
+      static const int BATCH = 64;
+
+#if defined(STM_LIB_RSTM)
+      stm::TimestampSource source;
+
+      /*** each thread's range, and the last timestamp it took */
+      struct Slot
+      {
+          stm::TimestampRange range;
+          unsigned long       last;
+          bool                started;
+      } __attribute__((aligned(64)));
+
+      Slot slots[MAX_THREADS];
+#endif
+
+      /*** timestamps no larger than their thread's previous one */
+      volatile unsigned long reversals;
+
+    public:
+      TimestampScale(bool ranges)
+#if defined(STM_LIB_RSTM)
+          : source(ranges ? STM_CM_TS_BATCH : 1), reversals(0)
+#else
+          : reversals(0)
+#endif
+      {
+#if defined(STM_LIB_RSTM)
+          for (int i = 0; i < MAX_THREADS; i++)
+              slots[i].started = false;
+#endif
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+#if defined(STM_LIB_RSTM)
+          Slot& s = slots[args->id];
+          unsigned long r = 0;
+          for (int i = 0; i < BATCH; i++) {
+              unsigned long ts = s.range.take(source);
+              if (s.started && ts <= s.last)
+                  r++;
+              s.last = ts;
+              s.started = true;
+          }
+          if (r)
+              faa(&reversals, r);
+#endif
+      }
+
+      virtual bool sanity_check() const
+      {
+#if defined(STM_LIB_RSTM)
+          if (BMCONFIG.verbosity > 0)
+              std::cout << "batch: " << source.batchSize()
+                        << ", timestamps reserved: " << source.frontier()
+                        << std::endl;
+#endif
+          return reversals == 0;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // TIMESTAMPSCALE_HPP__
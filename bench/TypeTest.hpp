@@ -51,6 +51,8 @@ namespace bench
       {
           GENERATE_FIELD(char, cfield);
           GENERATE_FIELD(unsigned char, ucfield);
+          GENERATE_FIELD(short, sfield);
+          GENERATE_FIELD(unsigned short, usfield);
           GENERATE_FIELD(int, ifield);
           GENERATE_FIELD(unsigned int, uifield);
           GENERATE_FIELD(long, lfield);
@@ -66,6 +68,8 @@ namespace bench
           TypeTestObject()
               : m_cfield('a'),
                 m_ucfield(255),
+                m_sfield(-32000),
+                m_usfield(65000),
                 m_ifield(-2000000000L),
                 m_uifield(4000000000UL),
                 m_lfield(-2000000000L),
@@ -131,6 +135,19 @@ namespace bench
                    << (int)c << "," << (int)uc << ") to ("
                    << (int)c2 << "," << (int)uc2 << ")" << endl;
 
+              // test short and ushort
+              short s = wtto->get_sfield(wtto);
+              unsigned short us = wtto->get_usfield(wtto);
+              short s2 = s + 1;
+              unsigned short us2 = us + 1;
+              wtto->set_sfield(s2, wtto);
+              wtto->set_usfield(us2, wtto);
+              s2 = wtto->get_sfield(wtto);
+              us2 = wtto->get_usfield(wtto);
+              cout << "(s,us) from ("
+                   << s << "," << us << ") to ("
+                   << s2 << "," << us2 << ")" << endl;
+
               // test int, unsigned int, long, unsigned long
               int i = wtto->get_ifield(wtto);
               unsigned int ui = wtto->get_uifield(wtto);
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VERIFYINPLACE_HPP__
+#define VERIFYINPLACE_HPP__
+
+#include <stm/stm.hpp>
+#include "Benchmark.hpp"
+
+namespace bench
+{
+  /**
+   *  Test that readers of a large object never commit fields that an
+   *  in-place writer (STM_INPLACE_LARGE_OBJECTS) has only half written.
+   *  The object is WORDS ints that always hold the same value.  Even
+   *  threads add one to every word; odd threads open the object and then
+   *  read every word, half of them in snapshot mode, so the reader usually
+   *  opens the object before a writer acquires it.  A committed read whose
+   *  words differ means a reader kept a torn value.  Without the in-place
+   *  option the object is cloned and the test still has to pass, e.g.:
+   *
+   *     Bench -B VerifyInPlace -p 4
+   */
+  class VerifyInPlace : public Benchmark
+  {
+      /*** enough words to reach the default STM_INPLACE_THRESHOLD */
+      static const int WORDS = 256;
+
+      class Block : public stm::Object
+      {
+          GENERATE_ARRAY(int, word, WORDS);
+        public:
+          Block()
+          {
+              for (int i = 0; i < WORDS; i++)
+                  m_word[i] = 0;
+          }
+      };
+
+      stm::sh_ptr<Block> block;
+
+      /*** set by any reader that commits words that differ */
+      volatile bool torn;
+
+      // read every word; true if they all match.  operator-> reopens the
+      // object, so take the pointer once: then only the getters' checks
+      // stand between us and a writer that acquires the block mid-scan
+      static bool uniform(const stm::rd_ptr<Block>& r)
+      {
+          const Block* b = &*r;
+          int first = b->get_word(0, r);
+          for (int i = 1; i < WORDS; i++)
+              if (b->get_word(i, r) != first)
+                  return false;
+          return true;
+      }
+
+    public:
+      VerifyInPlace() : block(new Block()), torn(false) { }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          bool ok = true;
+          if ((args->id % 2) && (val % 2)) {
+              BEGIN_READONLY_TRANSACTION {
+                  stm::rd_ptr<Block> r(block);
+                  ok = uniform(r);
+              } END_TRANSACTION;
+          }
+          else if (args->id % 2) {
+              BEGIN_TRANSACTION {
+                  stm::rd_ptr<Block> r(block);
+                  ok = uniform(r);
+              } END_TRANSACTION;
+          }
+          else {
+              BEGIN_TRANSACTION {
+                  stm::wr_ptr<Block> w(block);
+                  for (int i = 0; i < WORDS; i++)
+                      w->set_word(i, w->get_word(i, w) + 1, w);
+              } END_TRANSACTION;
+          }
+          if (!ok)
+              torn = true;
+      }
+
+      // no reader committed a torn block, and the block is still uniform
+      virtual bool sanity_check() const
+      {
+          bool ok = false;
+          BEGIN_TRANSACTION {
+              stm::rd_ptr<Block> r(block);
+              ok = uniform(r);
+          } END_TRANSACTION;
+          return !torn && ok;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // VERIFYINPLACE_HPP__
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VERIFYSNAPSHOT_HPP__
+#define VERIFYSNAPSHOT_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include "Benchmark.hpp"
+
+namespace bench
+{
+  /**
+   *  Test that read-only transactions see a consistent snapshot.  Even
+   *  threads move one unit between two of m (the -m parameter) accounts,
+   *  several transactions per call, so each writer commits and immediately
+   *  begins again on the same Descriptor.  Odd threads sum every account in
+   *  a BEGIN_READONLY_TRANSACTION; a committed sum other than the starting
+   *  total means a reader saw a version from the wrong side of some commit.
+   *  A small -m makes that likely if anything is wrong, e.g.:
+   *
+   *     Bench -B VerifySnapshot -m 4 -p 4
+   */
+  class VerifySnapshot : public Benchmark
+  {
+      class Account : public stm::Object
+      {
+          GENERATE_FIELD(int, balance);
+        public:
+          Account() : m_balance(INITIAL) { }
+      };
+
+      /*** starting balance of each account */
+      static const int INITIAL = 1000;
+
+      /*** back-to-back transfers per writer call */
+      static const int BURST = 8;
+
+      int ACCOUNTS;
+      std::vector<stm::sh_ptr<Account> > accounts;
+
+      /*** set by any reader that commits an inconsistent sum */
+      volatile bool torn;
+
+      long sum() const
+      {
+          long total = 0;
+          BEGIN_READONLY_TRANSACTION {
+              total = 0;
+              for (int i = 0; i < ACCOUNTS; i++) {
+                  stm::rd_ptr<Account> r(accounts[i]);
+                  total += r->get_balance(r);
+              }
+          } END_TRANSACTION;
+          return total;
+      }
+
+    public:
+      VerifySnapshot(int elements)
+          : ACCOUNTS(elements < 2 ? 2 : elements), torn(false)
+      {
+          for (int i = 0; i < ACCOUNTS; i++)
+              accounts.push_back(stm::sh_ptr<Account>(new Account()));
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          if (args->id % 2) {
+              if (sum() != (long)ACCOUNTS * INITIAL)
+                  torn = true;
+              return;
+          }
+
+          for (int n = 0; n < BURST; n++) {
+              stm::sh_ptr<Account> from = accounts[rand_r(seed) % ACCOUNTS];
+              stm::sh_ptr<Account> to = accounts[rand_r(seed) % ACCOUNTS];
+              BEGIN_TRANSACTION {
+                  stm::wr_ptr<Account> f(from);
+                  f->set_balance(f->get_balance(f) - 1, f);
+                  stm::wr_ptr<Account> t(to);
+                  t->set_balance(t->get_balance(t) + 1, t);
+              } END_TRANSACTION;
+          }
+      }
+
+      // no reader saw a torn sum, and the total is still intact
+      virtual bool sanity_check() const
+      {
+          return !torn && sum() == (long)ACCOUNTS * INITIAL;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // VERIFYSNAPSHOT_HPP__
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VISREADSCALE_HPP__
+#define VISREADSCALE_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include "Benchmark.hpp"
+
+namespace bench
+{
+  /**
+   *  Measure how visible reading scales with the thread count.  There are m
+   *  (the -m parameter) shared cells.  Read-only transactions (-R percent of
+   *  them) read a window of up to 16 consecutive cells, so every open
+   *  installs the reader in a shared reader set.  The rest move one unit
+   *  from one cell to the next, which forces the writer to find and abort
+   *  the visible readers of both cells.  The total over all cells never
+   *  changes.
+   *
+   *  Visible reading used to stop at 31 threads; sweep -p from 1 up to
+   *  MAX_THREADS - 1 to see how it scales, e.g.:
+   *
+   *     for p in 1 2 4 8 16 32 64 128 255; do
+   *       Bench -B VisReadScale -V vis-lazy -R 90 -m 256 -p $p
+   *     done
+   */
+  class VisReadScale : public Benchmark
+  {
+      class Cell : public stm::Object
+      {
+          GENERATE_FIELD(int, value);
+        public:
+          Cell() : m_value(INITIAL) { }
+      };
+
+      /*** starting value of each cell */
+      static const int INITIAL = 100;
+
+      /*** max number of cells a read-only transaction opens */
+      static const int WINDOW = 16;
+
+      int CELLS;
+      std::vector<stm::sh_ptr<Cell> > cells;
+
+    public:
+      VisReadScale(int elements) : CELLS(elements)
+      {
+          for (int i = 0; i < CELLS; i++)
+              cells.push_back(stm::sh_ptr<Cell>(new Cell()));
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            action)
+      {
+          int start = val % CELLS;
+          if (action < BMCONFIG.lookupPct) {
+              int reads = WINDOW;
+              if (CELLS < reads)
+                  reads = CELLS;
+              int sum = 0;
+              BEGIN_TRANSACTION {
+                  sum = 0;
+                  for (int i = 0; i < reads; i++) {
+                      stm::rd_ptr<Cell> r(cells[(start + i) % CELLS]);
+                      sum += r->get_value(r);
+                  }
+              } END_TRANSACTION;
+          }
+          else {
+              int next = (start + 1) % CELLS;
+              BEGIN_TRANSACTION {
+                  stm::wr_ptr<Cell> from(cells[start]);
+                  from->set_value(from->get_value(from) - 1, from);
+                  stm::wr_ptr<Cell> to(cells[next]);
+                  to->set_value(to->get_value(to) + 1, to);
+              } END_TRANSACTION;
+          }
+      }
+
+      // transfers never change the total
+      virtual bool sanity_check() const
+      {
+          long sum = 0;
+          BEGIN_TRANSACTION {
+              sum = 0;
+              for (int i = 0; i < CELLS; i++) {
+                  stm::rd_ptr<Cell> r(cells[i]);
+                  sum += r->get_value(r);
+              }
+          } END_TRANSACTION;
+          return sum == (long)CELLS * INITIAL;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // VISREADSCALE_HPP__
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef WRITESETSCALE_HPP__
+#define WRITESETSCALE_HPP__
+
+#include <stm/stm.hpp>
+#include <vector>
+#include "Benchmark.hpp"
+
+namespace bench
+{
+  /**
+   *  Measure how the cost of opening an object grows with write set size.
+   *  Every thread owns a private array of m (the -m parameter) cells, so
+   *  there are no conflicts.  Each transaction opens all m cells RW, then
+   *  re-opens each one RO and RW again, which exercises the lazy write set
+   *  lookup on every open.
+   *
+   *  Each transaction performs 3m opens, so (txns/sec * 3m) is the open
+   *  rate.  With invis-lazy it should stay roughly flat as m grows; with a
+   *  linear lookup it falls off as 1/m.  Try, e.g.:
+   *
+   *     Bench -B WriteSetScale -V invis-lazy -p 1 -m 16
+   *     Bench -B WriteSetScale -V invis-lazy -p 1 -m 1024
+   */
+  class WriteSetScale : public Benchmark
+  {
+      class Cell : public stm::Object
+      {
+          GENERATE_FIELD(int, value);
+        public:
+          Cell() : m_value(0) { }
+      };
+
+      int CELLS;
+      std::vector<std::vector<stm::sh_ptr<Cell> > > cells;
+
+    public:
+      WriteSetScale(int elements) : CELLS(elements), cells(BMCONFIG.threads)
+      {
+          for (int t = 0; t < BMCONFIG.threads; t++)
+              for (int i = 0; i < CELLS; i++)
+                  cells[t].push_back(stm::sh_ptr<Cell>(new Cell()));
+      }
+
+      virtual void random_transaction(thread_args_t* args,
+                                      unsigned int*  seed,
+                                      unsigned int   val,
+                                      int            chance)
+      {
+          std::vector<stm::sh_ptr<Cell> >& mine = cells[args->id];
+          BEGIN_TRANSACTION {
+              for (int i = 0; i < CELLS; i++) {
+                  stm::wr_ptr<Cell> w(mine[i]);
+                  w->set_value(w->get_value(w) + 1, w);
+              }
+              for (int i = 0; i < CELLS; i++) {
+                  stm::rd_ptr<Cell> r(mine[i]);
+                  stm::wr_ptr<Cell> w(mine[i]);
+                  w->set_value(r->get_value(r), w);
+              }
+          } END_TRANSACTION;
+      }
+
+      // every cell in a thread's array must hold the same count
+      virtual bool sanity_check() const
+      {
+          bool ok = true;
+          BEGIN_TRANSACTION {
+              ok = true;
+              for (unsigned t = 0; t < cells.size(); t++) {
+                  stm::rd_ptr<Cell> first(cells[t][0]);
+                  int v = first->get_value(first);
+                  for (int i = 1; i < CELLS; i++) {
+                      stm::rd_ptr<Cell> r(cells[t][i]);
+                      ok = ok && (r->get_value(r) == v);
+                  }
+              }
+          } END_TRANSACTION;
+          return ok;
+      }
+
+      virtual bool verify(VerifyLevel_t v) { return true; }
+  };
+
+} // namespace bench
+
+#endif // WRITESETSCALE_HPP__
@@ -12,4 +12,5 @@
 #define STM_ROLLBACK_SETJMP
 //#define STM_CHECKPOINT
 #define STM_USE_HASHTABLE_WRITESET
+#define STM_CLONE_ALL_OBJECTS
 #define STM_API_ASSERTS_OFF
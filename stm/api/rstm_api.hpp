@@ -99,13 +99,25 @@
 #define BEGIN_TRANSACTION                                               \
     {                                                                   \
         rstm::Descriptor& tx = *rstm::currentDescriptor;                \
+        static stm::TxSite _rstm_site = STM_TX_SITE;                    \
         while (true) {                                                  \
             jmp_buf _jmpbuf;                                            \
             setjmp(_jmpbuf);                                            \
-            tx.begin_transaction(&_jmpbuf);                             \
+            tx.begin_transaction(&_jmpbuf, &_rstm_site);                \
             {
 
-#define BEGIN_READONLY_TRANSACTION BEGIN_TRANSACTION
+//   BEGIN_READONLY_TRANSACTION is for transactions that never write.  It runs
+//   them without a read set, checking a global commit count instead of
+//   validating (see Descriptor::snapshotMode).  If the transaction writes or
+//   calls retry() after all, it restarts as an ordinary transaction.
+#define BEGIN_READONLY_TRANSACTION                                      \
+    {                                                                   \
+        rstm::Descriptor& tx = *rstm::currentDescriptor;                \
+        while (true) {                                                  \
+            jmp_buf _jmpbuf;                                            \
+            setjmp(_jmpbuf);                                            \
+            tx.begin_readonly_transaction(&_jmpbuf);                    \
+            {
 
 #define END_TRANSACTION                                                 \
             }                                                           \
@@ -137,9 +149,39 @@
 	    else {tx.begin_transaction(&_jmpbuf);}              \
             {
 
+// BEGIN_RT_TRANSACTION(TT) runs a transaction of the real-time task TT (an
+// stm::RTTask*), or of the task registered with stm::init() if TT is NULL.
+// It replaces BEGIN_TRANSACTION_M and BEGIN_TRANSACTION_LCM: the task's
+// parameters reach the CM by pointer, once per change, not on every begin.
+#define BEGIN_RT_TRANSACTION(TT)                                        \
+    {                                                                   \
+        rstm::Descriptor& tx = *rstm::currentDescriptor;                \
+        while (true) {                                                  \
+            jmp_buf _jmpbuf;                                            \
+            setjmp(_jmpbuf);                                            \
+            tx.begin_rt_transaction(&_jmpbuf, TT);                      \
+            {
+
 
 /************************* SH-END *************************************/
 
+//-----------------------------------------------------------------------------
+// CHECKPOINT
+//-----------------------------------------------------------------------------
+//   Mark a point inside the current transaction to resume from when a read
+//   performed after it turns out to be invalid, instead of restarting the
+//   whole transaction.  The stack frame that executes CHECKPOINT() must still
+//   be live when the transaction validates, so use it in the transaction's
+//   own block, and as with setjmp(), locals that are modified after the
+//   checkpoint should be volatile.  Writes through wr_ptr setters made after
+//   a checkpoint are undone; writes through raw pointers are not.
+//
+//   At most STM_MAX_CHECKPOINTS checkpoints are live at once; beyond that, and
+//   when the STM_CHECKPOINT runtime switch is off, CHECKPOINT() does nothing.
+//-----------------------------------------------------------------------------
+#define CHECKPOINT()                                                    \
+    if (jmp_buf* _rstm_cp = tx.checkpoint()) setjmp(*_rstm_cp)
+
 #elif defined(STM_ROLLBACK_THROW)
 //-----------------------------------------------------------------------------
 // STM_ROLLBACK_THROW
@@ -163,12 +205,19 @@
 #define BEGIN_TRANSACTION                                       \
     {                                                           \
         rstm::Descriptor& tx = *rstm::currentDescriptor;        \
+        static stm::TxSite _rstm_site = STM_TX_SITE;            \
         while (true) {                                          \
             try {                                               \
-                tx.begin_transaction();                         \
+                tx.begin_transaction(&_rstm_site);              \
                 {
 
-#define BEGIN_READONLY_TRANSACTION BEGIN_TRANSACTION
+#define BEGIN_READONLY_TRANSACTION                              \
+    {                                                           \
+        rstm::Descriptor& tx = *rstm::currentDescriptor;        \
+        while (true) {                                          \
+            try {                                               \
+                tx.begin_readonly_transaction();                \
+                {
 
 #define END_TRANSACTION                                         \
                 }                                               \
@@ -204,8 +253,21 @@
 		else{tx.begin_transaction();}			\
                 {
 
+// Transaction of a real-time task; see the setjmp version
+#define BEGIN_RT_TRANSACTION(TT)                                \
+    {                                                           \
+        rstm::Descriptor& tx = *rstm::currentDescriptor;        \
+        while (true) {                                          \
+            try {                                               \
+                tx.begin_rt_transaction(TT);                    \
+                {
+
 /************************** SH-END **********************************/
 
+//   Partial rollback needs to jump back into the middle of a transaction,
+//   which we can't do by throwing, so CHECKPOINT() is a no-op here.
+#define CHECKPOINT()
+
 #else
 #error "Invalid STM_ROLLBACK option, please reconfigure and rebuild"
 #endif // STM_ROLLBACK_*
@@ -237,6 +299,7 @@ public:                                                                 \
  t RSTM_CONCAT(get_, n)(const stm::rd_ptr<RSTM_UNIQUE>& rdp) const {    \
    t ret = RSTM_CONCAT(m_, n);                                          \
    rdp.getDescriptor().check_privatizer_clock();                        \
+   rdp.verifyInPlace();                                                 \
    return ret;                                                          \
  }                                                                      \
                                                                         \
@@ -252,10 +315,11 @@ public:                                                                 \
    return RSTM_CONCAT(m_, n);                                           \
  }                                                                      \
                                                                         \
- /* writes through write pointers do not require instrumentation */     \
+ /* writes through write pointers are logged for rollback if needed */  \
  template <class RSTM_UNIQUE>                                           \
  void RSTM_CONCAT(set_, n)(t RSTM_CONCAT(tmp_, n),                      \
-                           const stm::wr_ptr<RSTM_UNIQUE>&) {           \
+                           const stm::wr_ptr<RSTM_UNIQUE>& wrp) {       \
+   wrp.logWrite(&RSTM_CONCAT(m_, n), sizeof(t));                        \
    RSTM_CONCAT(m_, n) = RSTM_CONCAT(tmp_, n);                           \
  }                                                                      \
                                                                         \
@@ -284,6 +348,7 @@ public:                                                                 \
  t RSTM_CONCAT(get_, n)(int i, const stm::rd_ptr<RSTM_UNIQUE>& rdp) const { \
    t ret = RSTM_CONCAT(m_, n)[i];                                       \
    rdp.getDescriptor().check_privatizer_clock();                        \
+   rdp.verifyInPlace();                                                 \
    return ret;                                                          \
  }                                                                      \
                                                                         \
@@ -299,10 +364,11 @@ public:                                                                 \
    return RSTM_CONCAT(m_, n)[i];                                        \
  }                                                                      \
                                                                         \
- /* writes through write pointers do not require instrumentation */     \
+ /* writes through write pointers are logged for rollback if needed */  \
  template <class RSTM_UNIQUE>                                           \
  void RSTM_CONCAT(set_, n)(int i, t RSTM_CONCAT(tmp_, n),               \
-                           const stm::wr_ptr<RSTM_UNIQUE>&) {           \
+                           const stm::wr_ptr<RSTM_UNIQUE>& wrp) {       \
+   wrp.logWrite(&RSTM_CONCAT(m_, n)[i], sizeof(t));                     \
    RSTM_CONCAT(m_, n)[i] = RSTM_CONCAT(tmp_, n);                        \
  }                                                                      \
                                                                         \
@@ -332,6 +398,7 @@ public:                                                                 \
                         const stm::rd_ptr<RSTM_UNIQUE>& rdp) const {    \
    t ret = RSTM_CONCAT(m_, n)[x][y];                                    \
    rdp.getDescriptor().check_privatizer_clock();                        \
+   rdp.verifyInPlace();                                                 \
    return ret;                                                          \
  }                                                                      \
                                                                         \
@@ -347,10 +414,11 @@ public:                                                                 \
    return RSTM_CONCAT(m_, n)[x][y];                                     \
  }                                                                      \
                                                                         \
- /* writes through write pointers do not require instrumentation */     \
+ /* writes through write pointers are logged for rollback if needed */  \
  template <class RSTM_UNIQUE>                                           \
  void RSTM_CONCAT(set_, n)(int x, int y, t RSTM_CONCAT(tmp_, n),        \
-                           const stm::wr_ptr<RSTM_UNIQUE>&) {           \
+                           const stm::wr_ptr<RSTM_UNIQUE>& wrp) {       \
+   wrp.logWrite(&RSTM_CONCAT(m_, n)[x][y], sizeof(t));                  \
    RSTM_CONCAT(m_, n)[x][y] = RSTM_CONCAT(tmp_, n);                     \
  }                                                                      \
                                                                         \
@@ -377,6 +445,7 @@ template <class> class wr_ptr;
 template <class> class un_ptr;
 
 template <class T> void tx_delete(sh_ptr<T>&);
+template <class T> void open_write_batch(const sh_ptr<T>*, int);
 
 //=============================================================================
 // Smart Pointers
@@ -542,6 +611,14 @@ class sh_ptr {
    * NB: Implemented later because it depends on the <code>rd_ptr<code> code.
    */
   friend void tx_delete<T>(sh_ptr<T>& shared);
+
+  /**
+   * Open a set of shared objects for writing all at once, in address order.
+   * Use this when the write set is known up front, then open each one with
+   * a <code>wr_ptr</code> as usual; those opens find the object already
+   * acquired.
+   */
+  friend void open_write_batch<T>(const sh_ptr<T>* objs, int n);
 }; // template class stm::sh_ptr
 
 template <class T>
@@ -554,9 +631,16 @@ class rd_ptr : public sh_ptr<T>,
  protected:
   mutable T* m_obj;
 
+  /**
+   * The version we opened.  This is m_obj unless the object is written in
+   * place, in which case it is the in-place version that was in the header.
+   */
+  mutable rstm::Object* m_ver;
+
  private:
   void open() const {
-    m_obj = static_cast<T*>(DP::getDescriptor().openReadOnly(m_sh));
+    m_ver = DP::getDescriptor().openReadOnly(m_sh);
+    m_obj = static_cast<T*>(rstm::get_data(m_ver));
   }
 
  public:
@@ -570,7 +654,7 @@ class rd_ptr : public sh_ptr<T>,
    * to declare a <code>rd_ptr</code> once, outside of a loop, than to
    * continuously call this constructor inside a loop.
    */
-  rd_ptr() : sh_ptr<T>(), DP(), m_obj(NULL) {
+  rd_ptr() : sh_ptr<T>(), DP(), m_obj(NULL), m_ver(NULL) {
     API_ASSERT(DP::getDescriptor().inTransaction());
 
   }
@@ -582,7 +666,9 @@ class rd_ptr : public sh_ptr<T>,
    * already available <code>rd_ptr</code> available for the assignment version
    * (<code>operator=(sh_ptr<T>&)</code>).
    */
-  explicit rd_ptr(const sh_ptr<T>& open) : sh_ptr<T>(open), DP(), m_obj(NULL) {
+  explicit rd_ptr(const sh_ptr<T>& open)
+    : sh_ptr<T>(open), DP(), m_obj(NULL), m_ver(NULL)
+  {
     API_ASSERT(DP::getDescriptor().inTransaction());
     this->open();
   }
@@ -603,7 +689,7 @@ class rd_ptr : public sh_ptr<T>,
    * access is what makes this class "read only".
    */
   const T* operator->() const {
-    if (DP::getDescriptor().isAliased(m_sh, m_obj))
+    if (DP::getDescriptor().isAliased(m_sh, m_ver))
       open();
 
     return m_obj;
@@ -615,12 +701,26 @@ class rd_ptr : public sh_ptr<T>,
    * returned reference and try to use it directly.</strong>
    */
   const T& operator*() const {
-    if (DP::getDescriptor().isAliased(m_sh, m_obj))
+    if (DP::getDescriptor().isAliased(m_sh, m_ver))
       open();
 
     return *m_obj;
   }
 
+  /**
+   * Called by the GENERATE_* getters after they read a field.  A large object
+   * is written in place, so another writer may have acquired it since we
+   * opened it, in which case the value we just read can't be trusted.  That
+   * holds even if no one had written it in place when we opened it, so the
+   * check depends on the type's size, not on the version we opened.
+   */
+  void verifyInPlace() const {
+#if defined(STM_INPLACE_LARGE_OBJECTS)
+    if (sizeof(T) >= STM_INPLACE_THRESHOLD)
+      DP::getDescriptor().verifyInPlaceRead(m_sh, m_ver);
+#endif
+  }
+
   /**
    * Used for early release, which removes the pointed to object from the
    * transaction's read set. This requires careful use, and seems incompatible
@@ -648,18 +748,29 @@ void tx_delete(sh_ptr<T>& shared) {
   tx_delete(rd);
 }
 
+template <class T>
+void open_write_batch(const sh_ptr<T>* objs, int n) {
+  rstm::Descriptor& tx = rstm::Descriptor::MyDescriptor();
+  for (int i = 0; i < n; i++)
+    tx.addToWriteBatch(objs[i].m_sh);
+  tx.openWriteBatch(sizeof(T));
+}
+
 
 template <class T>
 class wr_ptr : public rd_ptr<T> {
   using sh_ptr<T>::m_sh;
   using rd_ptr<T>::m_obj;
+  using rd_ptr<T>::m_ver;
 
   void open() const {
-    m_obj = static_cast<T*>(rd_ptr<T>::getDescriptor().openReadWrite(m_sh, sizeof(T)));
+    m_ver = rd_ptr<T>::getDescriptor().openReadWrite(m_sh, sizeof(T));
+    m_obj = static_cast<T*>(rstm::get_data(m_ver));
   }
 
   void upgrade() const {
-    m_obj = static_cast<T*>(rd_ptr<T>::getDescriptor().upgradeToReadWrite(m_sh,sizeof(T)));
+    m_ver = rd_ptr<T>::getDescriptor().upgradeToReadWrite(m_sh,sizeof(T));
+    m_obj = static_cast<T*>(rstm::get_data(m_ver));
   }
 
  public:
@@ -697,6 +808,7 @@ class wr_ptr : public rd_ptr<T> {
   {
     this->upgrade();
     upgrade.m_obj = m_obj;        // Fix-up the aliasing problem
+    upgrade.m_ver = m_ver;
   }
 
 
@@ -717,6 +829,7 @@ class wr_ptr : public rd_ptr<T> {
 
     // Fix-up aliasing problem
     upgrade.m_obj = m_obj;
+    upgrade.m_ver = m_ver;
 
     return *this;
   }
@@ -738,6 +851,23 @@ class wr_ptr : public rd_ptr<T> {
   T& operator*() const {
     return *m_obj;
   }
+
+  /**
+   * Called by the GENERATE_* setters before they write a field.  If the
+   * object is written in place, or a checkpoint could resume the transaction
+   * with this clone still installed, save the old value for rollback.
+   */
+  void logWrite(void* addr, unsigned long len) const {
+    rstm::Descriptor& desc = rd_ptr<T>::getDescriptor();
+#if defined(STM_INPLACE_LARGE_OBJECTS)
+    if (m_ver != m_obj) {
+      desc.logWrite(addr, len);
+      return;
+    }
+#endif
+    if (desc.hasCheckpoint())
+      desc.logWrite(addr, len);
+  }
 }; // template class stm::wr_ptr
 
 
@@ -862,6 +992,11 @@ inline void init(std::string a, std::string b, bool c,void* t_args) {
   rstm::thr_init(a, b, c, t_args);
 }
 
+// Bind the thread to its real-time task; see BEGIN_RT_TRANSACTION
+inline void init(std::string a, std::string b, bool c, RTTask* task) {
+  rstm::thr_init(a, b, c, task);
+}
+
 inline void shutdown_nodeb(unsigned long i)
 // This version of shutdown does not print any thing
 { rstm::thr_shutdown_nodeb(i); }
@@ -869,6 +1004,28 @@ inline void shutdown_nodeb(unsigned long i)
 /*************************** SH-END *****************************************/
 
 inline void shutdown(unsigned long i) { rstm::thr_shutdown(i); }
+
+/**
+ *  Statistics summed over every thread that has called init(): commits,
+ *  aborts broken down by cause, CM decisions, validation, cloning and
+ *  backoff.  dumpStats() also prints each thread's row, as CSV or JSON.
+ */
+inline stm::TxStats getStats() { return stm::TxStats::aggregate(); }
+inline void dumpStats(std::ostream& os, bool json) {
+  if (json)
+    stm::TxStats::dumpJSON(os);
+  else
+    stm::TxStats::dumpCSV(os);
+}
+
+/**
+ *  With the invis-adapt and vis-adapt validation strategies: how often each
+ *  BEGIN_TRANSACTION site ran with eager and with lazy acquire, and how it
+ *  fared under each.
+ */
+inline void dumpSites(std::ostream& os, bool json) {
+  stm::AcquireAdvisor::dump(os, json);
+}
 using rstm::not_in_transaction;
 
 
@@ -0,0 +1,52 @@
+#ifndef __ADAPTIVEFBLT_H__
+#define __ADAPTIVEFBLT_H__
+
+#include "FBLT.hpp"
+#include "RetryCost.hpp"
+
+namespace stm
+{
+  /**
+   *  FBLT that sets eta and psy for each new transaction from its task's
+   *  retry-cost estimate and the time left before the transaction's
+   *  deadline (RTTask::due), instead of using the task's values as they
+   *  are: see retryAdvice().  A transaction that can't afford its usual
+   *  aborts joins the m_set sooner, and one whose expected retries eat
+   *  into its slack protects enemies that started earlier less.  Without a
+   *  deadline it behaves exactly like FBLT.
+   *
+   *  The task's eta is the one the new transaction starts with (the
+   *  RTTask or task_in_param resets it); its psy is the one last loaded.
+   */
+  class AdaptiveFBLT: public FBLT
+  {
+      double base_psy;    // psy as loaded from the task
+      double set_psy;     // psy as we last set it
+
+      void adapt()
+      {
+          if (psy != set_psy)
+              base_psy = psy;     // reloaded since we last set it
+          int new_eta;
+          double new_psy;
+          retryAdvice(getRetryCost(), CMClock::now(), due, length,
+                      eta, base_psy, new_eta, new_psy);
+          eta = new_eta;
+          psy = set_psy = new_psy;
+      }
+
+    public:
+      AdaptiveFBLT() : base_psy(0), set_psy(-1) { psy = 0; length = 0; }
+
+      AdaptiveFBLT(void* t_args) : FBLT(t_args), base_psy(psy), set_psy(-1) { }
+
+      void onBeginTransaction()
+      {
+          if ((tx_aborts == 0) && !m_set)
+              adapt();    // first attempt of a new transaction
+          FBLT::onBeginTransaction();
+      }
+  };
+} // namespace stm
+
+#endif // __ADAPTIVEFBLT_H__
@@ -0,0 +1,42 @@
+#ifndef __ADAPTIVELCM_H__
+#define __ADAPTIVELCM_H__
+
+#include "LCM.hpp"
+#include "RetryCost.hpp"
+
+namespace stm
+{
+  /**
+   *  LCM that sets psy for each new transaction from its task's retry-cost
+   *  estimate and the time left before the transaction's deadline
+   *  (RTTask::due), as AdaptiveFBLT does; LCM has no eta.  Without a
+   *  deadline it behaves exactly like LCM.
+   */
+  class AdaptiveLCM: public LCM
+  {
+      double base_psy;    // psy as loaded from the task
+      double set_psy;     // psy as we last set it
+
+    public:
+      AdaptiveLCM() : base_psy(0), set_psy(-1) { psy = 0; length = 0; }
+
+      AdaptiveLCM(void* t_args) : LCM(t_args), base_psy(psy), set_psy(-1) { }
+
+      void onBeginTransaction()
+      {
+          if (tx_aborts == 0) {
+              // first attempt of a new transaction
+              if (psy != set_psy)
+                  base_psy = psy;
+              int unused_eta;
+              double new_psy;
+              retryAdvice(getRetryCost(), CMClock::now(), due, length,
+                          -1, base_psy, unused_eta, new_psy);
+              psy = set_psy = new_psy;
+          }
+          LCM::onBeginTransaction();
+      }
+  };
+} // namespace stm
+
+#endif // __ADAPTIVELCM_H__
@@ -0,0 +1,106 @@
+#ifndef __ALPHACACHE_H__
+#define __ALPHACACHE_H__
+
+#include <cmath>
+#include <climits>
+#include "CMClock.hpp"
+
+namespace stm
+{
+  /**
+   *  LCM and FBLT let the lower-priority transaction of a conflict finish
+   *  if it has run for more than the fraction alpha of its length, where
+   *  for a transaction f of length Lf (us) and an interfering one s:
+   *
+   *     alpha = log(psy_s) / (log(psy_s) - Ls / Lf)
+   *
+   *  Instead of a log and two divisions per conflict, AlphaCache keeps,
+   *  per enemy, the two alpha * length products for the pair, already in
+   *  CMClock ticks: enemy_ticks for when the enemy is the one that may
+   *  finish, self_ticks for when we are.  Then "passed <= alpha" is one
+   *  integer compare of the time since the start against the threshold.
+   *
+   *  length and psy may change between transactions, so an entry also
+   *  records the values it was built from, and is rebuilt if they differ.
+   *  The cache is direct-mapped on the enemy's address; a collision only
+   *  costs a rebuild.
+   */
+  class AlphaCache
+  {
+    public:
+      struct Thresholds
+      {
+          long long enemy_ticks;  // enemy may finish if it ran <= this
+          long long self_ticks;   // we may finish if we ran > this
+      };
+
+    private:
+      enum { SIZE = 8 };
+
+      struct Entry
+      {
+          const void*   enemy;
+          unsigned long my_len, en_len;
+          double        my_psy, en_psy;
+          Thresholds    t;
+      };
+
+      Entry entries[SIZE];
+
+      /*** alpha * length us, in ticks, saturated; NaN gives /nan_as/ */
+      static long long toTicks(long double alpha, unsigned long length,
+                               long long nan_as)
+      {
+          if (alpha != alpha)
+              return nan_as;
+          long double ticks =
+              (long double)CMClock::from_ns(alpha * length * 1000);
+          if (ticks >= (long double)LLONG_MAX)
+              return LLONG_MAX;
+          if (ticks <= (long double)LLONG_MIN)
+              return LLONG_MIN;
+          return (long long)floorl(ticks);
+      }
+
+      static long double alpha(unsigned long f_len, unsigned long s_len,
+                               double s_psy)
+      {
+          double c = (double)s_len / f_len;
+          return (double)log(s_psy) / (log(s_psy) - c);
+      }
+
+    public:
+      AlphaCache()
+      {
+          for (int i = 0; i < SIZE; i++)
+              entries[i].enemy = 0;
+      }
+
+      const Thresholds& lookup(const void* enemy,
+                               unsigned long my_len, double my_psy,
+                               unsigned long en_len, double en_psy)
+      {
+          Entry& e = entries[((unsigned long)enemy >> 6) % SIZE];
+          if (e.enemy == enemy && e.my_len == my_len && e.en_len == en_len &&
+              e.my_psy == my_psy && e.en_psy == en_psy)
+              return e.t;
+
+          e.enemy = enemy;
+          e.my_len = my_len;
+          e.en_len = en_len;
+          e.my_psy = my_psy;
+          e.en_psy = en_psy;
+          // enemy started first: its alpha uses our psy and lengths
+          // (enemy as first); NaN never lets it finish
+          e.t.enemy_ticks =
+              toTicks(alpha(en_len, my_len, my_psy), en_len, LLONG_MIN);
+          // we started first: our alpha uses the enemy's psy; NaN never
+          // lets us finish
+          e.t.self_ticks =
+              toTicks(alpha(my_len, en_len, en_psy), my_len, LLONG_MAX);
+          return e.t;
+      }
+  };
+} // namespace stm
+
+#endif // __ALPHACACHE_H__
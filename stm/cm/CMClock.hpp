@@ -0,0 +1,94 @@
+#ifndef __CMCLOCK_H__
+#define __CMCLOCK_H__
+
+#include <time.h>
+#include "../support/atomic_ops.h"
+#include "../support/hrtime.h"
+
+namespace stm
+{
+  /**
+   *  A CM timestamp: a 64-bit tick count from CMClock.  Ticks from
+   *  different threads compare directly, and CMClock::to_ns() turns a
+   *  difference of two into nanoseconds.
+   */
+  typedef unsigned long long cm_ticks_t;
+
+  /*** a timestamp later than any CMClock::now() */
+  const cm_ticks_t CM_TICKS_MAX = ~0ULL;
+
+  /**
+   *  The clock the real-time CMs use for transaction start times, abort
+   *  durations and the LCM/FBLT "passed" fraction, in place of
+   *  clock_gettime(CLOCK_REALTIME) and field-by-field timespec compares.
+   *
+   *  On x86 with an invariant TSC (constant_tsc and nonstop_tsc in
+   *  /proc/cpuinfo) a tick is one TSC cycle, read with rdtsc and
+   *  calibrated against CLOCK_MONOTONIC once, at the first init().
+   *  Anywhere else, or with STM_CM_CLOCK_MONOTONIC defined, a tick is a
+   *  CLOCK_MONOTONIC nanosecond.  Either way the clock never steps
+   *  backwards when the wall clock is set.
+   *
+   *  Every ContentionManager calls init() when it is constructed, so the
+   *  source is fixed before any CM reads the clock.
+   */
+  class CMClock
+  {
+      enum { UNSET = 0, CALIBRATING = 1, TSC = 2, MONOTONIC = 3 };
+
+      static volatile unsigned long state;
+      static double ns_per_tick;
+
+      /*** pick the source and, for the TSC, measure its rate */
+      static void calibrate();
+
+    public:
+      static void init()
+      {
+          if (state < TSC)
+              calibrate();
+      }
+
+      static cm_ticks_t monotonic_ns()
+      {
+          struct timespec ts;
+          clock_gettime(CLOCK_MONOTONIC, &ts);
+          return (cm_ticks_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+      }
+
+      static cm_ticks_t now()
+      {
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(STM_CM_CLOCK_MONOTONIC)
+          if (state == TSC)
+              return gethrcycle_x86();
+#endif
+          return monotonic_ns();
+      }
+
+      /*** convert a tick count (normally a difference) to nanoseconds */
+      static unsigned long long to_ns(cm_ticks_t ticks)
+      {
+          if (state == TSC)
+              return (unsigned long long)(ticks * ns_per_tick);
+          return ticks;
+      }
+
+      /*** convert nanoseconds to (fractional) ticks */
+      static long double from_ns(long double ns)
+      {
+          if (state == TSC)
+              return ns / ns_per_tick;
+          return ns;
+      }
+
+      static bool usesTSC() { return state == TSC; }
+  };
+
+  /*** a timespec (a deadline or a period) as one comparable number */
+  inline unsigned long long timespec_key(const struct timespec& ts)
+  {
+      return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+} // namespace stm
+
+#endif // __CMCLOCK_H__
@@ -0,0 +1,99 @@
+#ifndef __CMEVENTRING_H__
+#define __CMEVENTRING_H__
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include "CMClock.hpp"
+
+/**
+ *  Records per contention manager event ring.  Must be a power of two.
+ */
+#ifndef STM_CM_EVENT_RING
+#define STM_CM_EVENT_RING 1024
+#endif
+
+namespace stm
+{
+  /*** what a CMEvent records */
+  enum CMEventKind { CM_EV_BEGIN, CM_EV_COMMIT, CM_EV_ABORT, CM_EV_MSET };
+
+  /**
+   *  One debug record: when (CMClock ticks), what, and two numbers whose
+   *  meaning depends on the CM (FBLT, for example, logs m_set and eta).
+   */
+  struct CMEvent
+  {
+      cm_ticks_t when;
+      int        kind;
+      int        th;
+      long long  a;
+      long long  b;
+  };
+
+  /**
+   *  Fixed-size binary log of CM events, written only by the CM's own
+   *  thread.  Recording is a few stores and never allocates, where the
+   *  stringstream log it replaces formatted and copied a string per
+   *  event.  When the ring is full the oldest records are overwritten.
+   *
+   *  format() may run on any thread: it copies each record and then
+   *  rechecks the head, dropping records the writer lapped meanwhile.
+   */
+  class CMEventRing
+  {
+      static const unsigned long SIZE = STM_CM_EVENT_RING;
+
+      CMEvent buf[SIZE];
+      volatile unsigned long head;  // records ever written
+
+      static const char* label(int kind)
+      {
+          switch (kind) {
+            case CM_EV_BEGIN:  return "startBeginTx";
+            case CM_EV_COMMIT: return "committingTx";
+            case CM_EV_ABORT:  return "AbortTx";
+            case CM_EV_MSET:   return "joinMset";
+            default:           return "unknown";
+          }
+      }
+
+    public:
+      CMEventRing() : head(0) { }
+
+      void record(int kind, int th, long long a, long long b)
+      {
+          unsigned long h = head;
+          CMEvent& e = buf[h & (SIZE - 1)];
+          e.when = CMClock::now();
+          e.kind = kind;
+          e.th = th;
+          e.a = a;
+          e.b = b;
+          // publish the record before the new head
+          __asm__ __volatile__("" ::: "memory");
+          head = h + 1;
+      }
+
+      void clear() { head = 0; }
+
+      /*** append one tab-separated line per surviving record, oldest first */
+      void format(std::vector<std::string>& out) const
+      {
+          unsigned long end = head;
+          unsigned long begin = (end > SIZE) ? end - SIZE : 0;
+          for (unsigned long i = begin; i < end; i++) {
+              CMEvent e = buf[i & (SIZE - 1)];
+              __asm__ __volatile__("" ::: "memory");
+              if (head - i > SIZE)
+                  continue;  // overwritten while we copied it
+              std::ostringstream line;
+              line << CMClock::to_ns(e.when) << "\t" << e.th << "\t" << e.a
+                   << "\t" << e.b << "\t" << label(e.kind) << std::endl;
+              out.push_back(line.str());
+          }
+      }
+  };
+} // namespace stm
+
+#endif // __CMEVENTRING_H__
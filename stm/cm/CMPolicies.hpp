@@ -36,6 +36,14 @@
 #define __CMPOLICIES_H__
 
 #include "ContentionManager.hpp"
+/************************** SH-START *********************************/
+#include "ECM.hpp"
+#include "RCM.hpp"
+#include "LCM.hpp"
+#include "FIFO.hpp"
+#include "PNF.hpp"
+#include "FBLT.hpp"
+/************************** SH-END ************************************/
 
 namespace stm
 {
@@ -191,6 +199,9 @@ namespace stm
       ///  Set up the PureStatic policy by constructing staticCM
       PureStaticCMPolicy(bool b, std::string s) : staticCM() { }
 
+      ///  Real-time arguments are for dynamic CMs; ignore them
+      PureStaticCMPolicy(bool b, std::string s, void* t_args) : staticCM() { }
+
       /**
        *  return a contention manager (used by a CM to get another
        *  descriptor's CM)
@@ -260,6 +271,12 @@ namespace stm
           dynamicCM = Factory(cm_name);
       }
 
+      ///  Pass real-time arguments to the real-time CMs
+      PureDynamicCMPolicy(bool b, std::string cm_name, void* t_args)
+      {
+          dynamicCM = Factory(cm_name, t_args);
+      }
+
       /**
        *  return a contention manager (used by a CM to get another descriptor's
        *  CM)
@@ -306,5 +323,149 @@ namespace stm
           return dynamicCM->onWAW(enemy);
       }
   };
+
+  /**
+   *  Contention managers that SwitchCMPolicy can call without the vtable.
+   *  CM_STATIC is STM_DEFAULT_CM; CM_OTHER is any other dynamic CM.
+   */
+  enum CMKind { CM_STATIC, CM_ECM, CM_RCM, CM_LCM, CM_FIFO, CM_PNF, CM_FBLT,
+                CM_OTHER };
+
+  ///  Map a Factory() name onto its CMKind
+  inline CMKind cmKind(const std::string& cm_name)
+  {
+      if (cm_name == "ECM")  return CM_ECM;
+      if (cm_name == "RCM")  return CM_RCM;
+      if (cm_name == "LCM")  return CM_LCM;
+      if (cm_name == "FIFO") return CM_FIFO;
+      if (cm_name == "PNF")  return CM_PNF;
+      if (cm_name == "FBLT") return CM_FBLT;
+      return CM_OTHER;
+  }
+
+  /**
+   *  Call /call/ on the CM of the given kind.  The qualified calls on the
+   *  real-time CMs are not virtual, so the compiler can inline each of them
+   *  into the descriptor; only CM_OTHER goes through the vtable.
+   */
+#define STM_CM_DISPATCH(call)                                            \
+  switch (kind) {                                                        \
+    case CM_STATIC: return staticCM.call;                                \
+    case CM_ECM:    return static_cast<ECM*>(dynamicCM)->ECM::call;      \
+    case CM_RCM:    return static_cast<RCM*>(dynamicCM)->RCM::call;      \
+    case CM_LCM:    return static_cast<LCM*>(dynamicCM)->LCM::call;      \
+    case CM_FIFO:   return static_cast<FIFO*>(dynamicCM)->FIFO::call;    \
+    case CM_PNF:    return static_cast<PNF*>(dynamicCM)->PNF::call;      \
+    case CM_FBLT:   return static_cast<FBLT*>(dynamicCM)->FBLT::call;    \
+    default:        return dynamicCM->call;                              \
+  }
+
+  /**
+   *  Policy like HybridCMPolicy, but when the run-time CM is one of the
+   *  real-time CMs, it decides which one once, at construction, and then
+   *  every event is a switch on that choice followed by a direct call.
+   *  Each case is a separate, fully inlined copy of the CM's code, so the
+   *  descriptor is in effect pre-instantiated for every real-time CM and
+   *  picks one at run time.  All descriptors of a run use the same CM, so
+   *  the switch always goes the same way and predicts well.
+   */
+  class SwitchCMPolicy
+  {
+      ///  Which CM this descriptor uses
+      const CMKind kind;
+
+      ///  Static CM, used if kind is CM_STATIC
+      STM_DEFAULT_CM staticCM;
+
+      ///  Dynamic CM, used for every other kind
+      ContentionManager* dynamicCM;
+
+    public:
+
+      ///  Set up the policy: if the bool flag is false, get a CM from the factory
+      SwitchCMPolicy(bool static_cm, std::string dynamic_cm)
+          : kind(static_cm ? CM_STATIC : cmKind(dynamic_cm)), staticCM(),
+            dynamicCM(static_cm ? NULL : Factory(dynamic_cm))
+      { }
+
+      ///  Pass real-time arguments to the real-time (dynamic) CMs
+      SwitchCMPolicy(bool static_cm, std::string dynamic_cm, void* t_args)
+          : kind(static_cm ? CM_STATIC : cmKind(dynamic_cm)), staticCM(),
+            dynamicCM(static_cm ? NULL : Factory(dynamic_cm, t_args))
+      { }
+
+      /**
+       *  return a contention manager (used by a CM to get another
+       *  descriptor's CM)
+       */
+      ContentionManager* getCM()
+      {
+          if (kind == CM_STATIC) return &staticCM;
+          else                   return dynamicCM;
+      }
+
+      ///  Which CM this descriptor dispatches to
+      CMKind getKind() const { return kind; }
+
+      ///  Wrapper around onBeginTransaction
+      void onBeginTx() { STM_CM_DISPATCH(onBeginTransaction()); }
+
+      ///  Wrapper for onTryCommitTransaction
+      void onTryCommitTx() { STM_CM_DISPATCH(onTryCommitTransaction()); }
+
+      ///  Wrapper for onTransactionCommitted
+      void onTxCommitted() { STM_CM_DISPATCH(onTransactionCommitted()); }
+
+      ///  Wrapper for onTransactionAborted
+      void onTxAborted() { STM_CM_DISPATCH(onTransactionAborted()); }
+
+      ///  Wrapper for onContention
+      void onContention() { STM_CM_DISPATCH(onContention()); }
+
+      ///  Wrapper for onOpenRead
+      void onOpenRead() { STM_CM_DISPATCH(onOpenRead()); }
+
+      ///  Wrapper for onOpenWrite
+      void onOpenWrite() { STM_CM_DISPATCH(onOpenWrite()); }
+
+      ///  Wrapper for onReOpen
+      void onReOpen() { STM_CM_DISPATCH(onReOpen()); }
+
+      ///  Wrapper for onRAW
+      ConflictResolutions onRAW(ContentionManager* enemy)
+      {
+          STM_CM_DISPATCH(onRAW(enemy));
+      }
+      ///  Wrapper for onWAR
+      ConflictResolutions onWAR(ContentionManager* enemy)
+      {
+          STM_CM_DISPATCH(onWAR(enemy));
+      }
+      ///  Wrapper for onWAW
+      ConflictResolutions onWAW(ContentionManager* enemy)
+      {
+          STM_CM_DISPATCH(onWAW(enemy));
+      }
+  };
+
+#undef STM_CM_DISPATCH
+
+  /**
+   *  The CM policy the RSTM and redo_lock descriptors use, chosen per
+   *  build.  SwitchCMPolicy is the default.  STM_CM_PURE_STATIC compiles
+   *  STM_DEFAULT_CM in and ignores the run-time choice, which is the
+   *  cheapest dispatch when every run uses the same CM (configure
+   *  STM_DEFAULT_CM as, e.g., PNF).  STM_CM_PURE_DYNAMIC and STM_CM_HYBRID
+   *  give the vtable-based policies.
+   */
+#if defined(STM_CM_PURE_STATIC)
+  typedef PureStaticCMPolicy DescriptorCMPolicy;
+#elif defined(STM_CM_PURE_DYNAMIC)
+  typedef PureDynamicCMPolicy DescriptorCMPolicy;
+#elif defined(STM_CM_HYBRID)
+  typedef HybridCMPolicy DescriptorCMPolicy;
+#else
+  typedef SwitchCMPolicy DescriptorCMPolicy;
+#endif
 } // namespace stm
 #endif // __CMPOLICIES_H__
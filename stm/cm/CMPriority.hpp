@@ -0,0 +1,121 @@
+#ifndef __CMPRIORITY_H__
+#define __CMPRIORITY_H__
+
+#include <sched.h>
+#include <climits>
+#include "../support/Futex.hpp"
+
+namespace stm
+{
+  /**
+   *  How PNF and FBLT give m_set transactions precedence.
+   *
+   *  CM_PRIO_SCHED is the original scheme: a transaction joining the
+   *  m_set is raised to PNF_M_PRIO under SCHED_FIFO (or through chronos,
+   *  for FBLT), and a PNF transaction that must wait drops to PNF_N_PRIO.
+   *  That is a system call per transition, and it needs the privilege to
+   *  use SCHED_FIFO.
+   *
+   *  CM_PRIO_USER leaves the scheduler alone.  m_set membership is counted
+   *  in CMPriorityGate, and a transaction that would have run at the low
+   *  priority instead yields: it parks on the gate until an m_set
+   *  transaction leaves, then carries on as before.  Joining and leaving
+   *  the m_set is one atomic add each, and no call reaches the kernel
+   *  unless somebody actually has to wait.
+   *
+   *  Defining STM_CM_USER_PRIO makes CM_PRIO_USER the default.
+   */
+  enum CMPrioMode { CM_PRIO_SCHED, CM_PRIO_USER };
+
+  /**
+   *  Counters for both modes.  sched_calls is priority changes that went
+   *  to the kernel (sched_setscheduler or chronos), parks is times a
+   *  transaction slept on the gate, and wakes is futex wakes issued by
+   *  transactions leaving the m_set.
+   */
+  struct CMPrioStats
+  {
+      volatile unsigned long long sched_calls;
+      volatile unsigned long long parks;
+      volatile unsigned long long wakes;
+  };
+
+  /**
+   *  The m_set as seen by CM_PRIO_USER: a count of its members and a
+   *  generation word that changes whenever it shrinks.  A transaction
+   *  reads generation() before it looks for conflicts, and if it has to
+   *  wait, passes that value to await(), so a member leaving in between
+   *  is never missed.
+   */
+  class CMPriorityGate
+  {
+      volatile int members;
+      volatile int gen;      // futex word
+      volatile int waiters;
+
+    public:
+      CMPrioStats stats;
+
+      CMPriorityGate() : members(0), gen(0), waiters(0)
+      {
+          stats.sched_calls = stats.parks = stats.wakes = 0;
+      }
+
+      int generation() const { return gen; }
+
+      bool busy() const { return members > 0; }
+
+      void enter() { __sync_fetch_and_add(&members, 1); }
+
+      /**
+       *  A member left.  The pnf_main service passes announce=false and
+       *  calls changed() once it has re-admitted from the n_set, so the
+       *  transactions it woke find their new state.
+       */
+      void leave(bool announce = true)
+      {
+          __sync_fetch_and_sub(&members, 1);
+          if (announce)
+              changed();
+      }
+
+      void changed()
+      {
+          __sync_fetch_and_add(&gen, 1);
+          if (waiters) {
+              __sync_fetch_and_add(&stats.wakes, 1);
+              futex_wake(&gen, INT_MAX);
+          }
+      }
+
+      /*** yield until the m_set shrinks after generation /g/, or empties */
+      void await(int g, int spins = 256)
+      {
+          for (int i = 0; i < spins; i++)
+              if (gen != g || members == 0)
+                  return;
+          __sync_fetch_and_add(&waiters, 1);
+          __sync_fetch_and_add(&stats.parks, 1);
+          while (gen == g && members != 0)
+              futex_wait(&gen, g);
+          __sync_fetch_and_sub(&waiters, 1);
+      }
+
+      void reset()
+      {
+          members = 0;
+          stats.sched_calls = stats.parks = stats.wakes = 0;
+      }
+  };
+
+  /*** set thread /tid/ (0 for the caller) to SCHED_FIFO /prio/, counting the call */
+  inline void cm_sched_prio(CMPriorityGate& gate, int tid,
+                            struct sched_param* param, int prio)
+  {
+      __sync_fetch_and_add(&gate.stats.sched_calls, 1);
+      param->sched_priority = prio;
+      sched_setscheduler(tid, SCHED_FIFO, param);
+  }
+} // namespace stm
+
+#endif // __CMPRIORITY_H__
@@ -33,6 +33,8 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include <iostream>
+#include <cstdio>
+#include <cstring>
 
 #include "ContentionManager.hpp"
 #include "Polka.hpp"
@@ -62,14 +64,22 @@
 #include "FIFO.hpp"
 #include "PNF.hpp"
 #include "FBLT.hpp"
+#include "AdaptiveLCM.hpp"
+#include "AdaptiveFBLT.hpp"
 
 stm::ContentionManager* no_cm=NULL;	//Used to return NULL pointer if CM does not exist. This replaces the default CM (Polka)
-volatile unsigned long long stm::new_tx_released=0;	//Holds address of a released transaction to be used in pnf_helper
-volatile unsigned int stm::new_tx_checking=0;	//If 1, then pnf_main should check Txs in n_set
-volatile unsigned long long stm::new_tx_committed=0;	//Holds address of a committed transaction to be used in pnf_helper
+stm::PNFEventQueue stm::pnf_events;	//Requests from released and committed Txs, served by pnf_main
+volatile int stm::pnf_service_parked=0;	//1 while pnf_main sleeps waiting for requests. Futex word
+stm::PNFServiceStats stm::pnf_stats;	//What pnf_main has done, and its CPU time
 
-volatile unsigned long long stm::m_set_bits=0;	//Holds bit representation of all objects held in m_set in PNF
-										//Due to current implementation, m_set_bits cannot exceed 64 objects
+#ifdef STM_CM_USER_PRIO
+stm::CMPrioMode stm::cm_prio_mode=stm::CM_PRIO_USER;	//How PNF and FBLT raise m_set Txs
+#else
+stm::CMPrioMode stm::cm_prio_mode=stm::CM_PRIO_SCHED;	//How PNF and FBLT raise m_set Txs
+#endif
+stm::CMPriorityGate stm::cm_prio_gate;	//m_set membership in CM_PRIO_USER mode, and priority counters
+
+stm::PNFConflictSet stm::m_set_objs;	//Objects held by Txs in m_set in PNF
 pthread_t stm::pnf_main_th=0;				//pnf_main service thread
 pthread_attr_t stm::pnf_th_attr;		//Attributes for pnf_main service thread
 struct sched_param stm::pnf_main_param;	//scheduling parameters for pnf_main service
@@ -133,6 +143,10 @@ stm::ContentionManager* stm::Factory(std::string cm_type)
 	return new RCM();
     else if (cm_type=="FBLT")
         return new FBLT();
+    else if (cm_type=="AdaptiveLCM")
+        return new AdaptiveLCM();
+    else if (cm_type=="AdaptiveFBLT")
+        return new AdaptiveFBLT();
 /*************************** SH-END ***********************************************/
     else {
         std::cerr << "*** Warning: unknown contention manager "
@@ -152,6 +166,8 @@ stm::ContentionManager* stm::Factory(std::string cm_type, void* t_args)
 //        return new RCM(t_args);
     if (cm_type == "LCM")
         return new LCM(t_args);
+    else if (cm_type == "AdaptiveLCM")
+        return new AdaptiveLCM(t_args);
     else {
         std::cerr << "*** Warning: unknown contention manager "
                   << cm_type << std::endl;
@@ -162,11 +178,64 @@ stm::ContentionManager* stm::Factory(std::string cm_type, void* t_args)
 /********************************* SH-END **********************************************/
 
 // provide backing for static variables in different CMs
-volatile unsigned long stm::Greedy::timeCounter = 0;
-volatile unsigned long stm::Serializer::timeCounter = 0;
-volatile unsigned long stm::Reincarnate::timeCounter = 0;
+volatile unsigned long stm::CMClock::state = 0;
+double stm::CMClock::ns_per_tick = 1;
+stm::TimestampSource stm::Greedy::timestamps;
+stm::TimestampSource stm::Serializer::timestamps;
+stm::TimestampSource stm::Reincarnate::timestamps;
 
 /********************* SH-START *****************************/
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__linux__) && !defined(STM_CM_CLOCK_MONOTONIC)
+// true if /proc/cpuinfo says the TSC runs at a constant rate in every
+// C-state, so cycle counts from different cores and times compare
+static bool invariantTSC()
+{
+    FILE* fp = fopen("/proc/cpuinfo", "r");
+    if (fp == NULL)
+        return false;
+    char line[4096];
+    bool constant = false, nonstop = false;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, "flags", 5) != 0)
+            continue;
+        constant = strstr(line, " constant_tsc") != NULL;
+        nonstop = strstr(line, " nonstop_tsc") != NULL;
+        break;
+    }
+    fclose(fp);
+    return constant && nonstop;
+}
+#endif
+
+void stm::CMClock::calibrate()
+{
+    if (!bool_cas(&state, UNSET, CALIBRATING)) {
+        // someone else is choosing the source; wait for the result
+        while (state == CALIBRATING)
+            spin64();
+        return;
+    }
+    unsigned long result = MONOTONIC;
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__linux__) && !defined(STM_CM_CLOCK_MONOTONIC)
+    if (invariantTSC()) {
+        // count cycles across 10ms of CLOCK_MONOTONIC
+        cm_ticks_t ns0 = monotonic_ns();
+        unsigned long long c0 = gethrcycle_x86();
+        cm_ticks_t ns1;
+        do {
+            ns1 = monotonic_ns();
+        } while (ns1 - ns0 < 10000000ULL);
+        unsigned long long c1 = gethrcycle_x86();
+        if (c1 > c0) {
+            ns_per_tick = (double)(ns1 - ns0) / (double)(c1 - c0);
+            result = TSC;
+        }
+    }
+#endif
+    WBR;
+    state = result;
+}
+
 bool stm::compTimeSpec(struct timespec* f_ts,struct timespec* s_ts){
 	/*
 	 * "true" if f_ts timespec is smaller than s_ts. "false" otherwise
@@ -209,100 +278,188 @@ void stm::addTxNset(void* cm_th){
 	n_set.push_back(cm_th);
 }
 
+void stm::pnf_set_configure(unsigned long width, bool exact){
+	/*
+	 * Size m_set_objs and choose hashed bits or exact ownership words. No PNF Tx may be running
+	 */
+	m_set_objs.configure(width, exact);
+}
+
+void stm::cm_prio_configure(CMPrioMode mode){
+	/*
+	 * Choose between SCHED_FIFO priorities and the user-space gate, and reset the counters.
+	 * No PNF or FBLT Tx may be running
+	 */
+	cm_prio_mode=mode;
+	cm_prio_gate.reset();
+}
+
 void stm::pnf_main_start(){
 	/*
 	 * Starts pnf_main service. This function must be called before initiating PNF CM for any task
 	 */
 	cm_stop=1;
+	pnf_service_parked=0;
+	pnf_stats.events=pnf_stats.parks=pnf_stats.scans=pnf_stats.cpu_ns=0;
 	pnf_main_param.sched_priority = CM_MAIN_SERVICE;
+	pthread_attr_init(&pnf_th_attr);
 	pthread_attr_setscope(&pnf_th_attr, PTHREAD_SCOPE_SYSTEM);
+	pthread_attr_setinheritsched(&pnf_th_attr, PTHREAD_EXPLICIT_SCHED);
 	pthread_attr_setschedpolicy(&pnf_th_attr, SCHED_FIFO);
 	pthread_attr_setschedparam(&pnf_th_attr, &pnf_main_param);
-	pthread_create(&pnf_main_th,&pnf_th_attr,&pnf_main,NULL);
+	if(pthread_create(&pnf_main_th,&pnf_th_attr,&pnf_main,NULL)){
+		//Not allowed to run SCHED_FIFO. Run the service with default scheduling instead
+		pthread_attr_setinheritsched(&pnf_th_attr, PTHREAD_INHERIT_SCHED);
+		if(pthread_create(&pnf_main_th,&pnf_th_attr,&pnf_main,NULL)){
+			pnf_main_th=0;	//No service. PNF Txs admit themselves
+		}
+	}
+	pthread_attr_destroy(&pnf_th_attr);
 }
 
 void stm::pnf_main_stop(){
 	/*
-	 * Stops pnf_main service
+	 * Stops pnf_main service, waking it if it is parked, and waits for it to exit
 	 */
+	pthread_t th=pnf_main_th;
 	cm_stop=0;
+	if(!th){
+		return;
+	}
+	__sync_lock_test_and_set(&pnf_service_parked, 0);
+	futex_wake(&pnf_service_parked, 1);
+	pthread_join(th, NULL);
+}
+
+void stm::pnf_post_wait(ContentionManager* cm, PNFEvent::Kind kind){
+	/*
+	 * Post a request for cm to pnf_main and wait until it is served. Wake pnf_main only if
+	 * it is parked, so a busy service costs posters one CAS
+	 */
+	cm->go_on.arm();
+	cm->pnf_ev.kind=kind;
+	cm->pnf_ev.cm=cm;
+	pnf_events.push(&cm->pnf_ev);
+	if(pnf_service_parked && __sync_bool_compare_and_swap(&pnf_service_parked, 1, 0)){
+		futex_wake(&pnf_service_parked, 1);
+	}
+	cm->go_on.wait();
+}
+
+static void pnf_admit(stm::ContentionManager* cm){
+	/*
+	 * Move cm into m_set: it is now an executing, non-preemptive Tx
+	 */
+	cm->m_set=true;
+	cm->cur_state=stm::executing;
+	stm::m_set_objs.join(cm->curr_objs);	//Modify m_set_objs to include the new accessed objects
+	if(stm::cm_prio_mode==stm::CM_PRIO_SCHED){
+		stm::cm_sched_prio(stm::cm_prio_gate, cm->th, &(cm->param), PNF_M_PRIO);	//Increase priority to highest value as Tx is a non-preemptive Tx
+	}
+	else{
+		stm::cm_prio_gate.enter();
+	}
 }
 
 void* stm::pnf_main(void* arg){
 	/*
 	 * Main (centralized) service of PNF. It continues execution until all tasks finish. It is invoked
 	 * by Txs to execute some tasks.
+	 *
+	 * Txs post requests on pnf_events and wait on their go_on flag. The service serves every posted
+	 * request in order, then, if any Tx left m_set, rechecks the n_set in priority order. Retrying Txs
+	 * wait in n_wait, a heap ordered by time_param. With no requests, the service parks on a futex
+	 * instead of spinning, and the next poster wakes it.
 	 */
-	unsigned int next_tx;	//Tx index in n_set
+	PNFWaitHeap n_wait;	//Retrying Txs, earliest time_param first
+	std::vector<PNFHeapNode*> still_waiting;
 
 	while(cm_stop){
-		if(new_tx_released){
-			//A new Tx is released. Check there is no conflict with current executing Txs
-			if(m_set_bits & ((ContentionManager*)new_tx_released)->curr_objs_bits){
-				//AND is not 0. There is a conflict. m_set is already false
-				addTxNset((void*)new_tx_released);	//Put the new Tx in n_set
-				((ContentionManager*)new_tx_released)->cur_state=retrying;	//Identify the new Tx as retrying
-				((ContentionManager*)new_tx_released)->param.sched_priority=PNF_N_PRIO;
-				sched_setscheduler(((ContentionManager*)new_tx_released)->th, SCHED_FIFO, &(((ContentionManager*)new_tx_released)->param));
+		PNFEvent* ev=pnf_events.takeAll();
+		if(!ev){
+			//Nothing to do. Announce we are parking, then look once more so no request is missed
+			pnf_service_parked=1;
+			__sync_synchronize();
+			if(pnf_events.empty() && cm_stop){
+				pnf_stats.parks++;
+				while(pnf_service_parked && cm_stop){
+					futex_wait(&pnf_service_parked, 1);
+				}
+			}
+			pnf_service_parked=0;
+			continue;
+		}
+
+		bool check_n_set=false;	//true if a Tx left m_set, so Txs in n_set should be checked
+		while(ev){
+			PNFEvent* next=ev->next;	//ev may be reused as soon as its Tx is told to go on
+			ContentionManager* cm=ev->cm;
+			if(ev->kind==PNFEvent::RELEASED){
+				//A new Tx is released. Check there is no conflict with current executing Txs
+				if(m_set_objs.overlaps(cm->curr_objs)){
+					//There is a conflict. m_set is already false
+					cm->cur_state=retrying;	//Identify the new Tx as retrying
+					if(cm_prio_mode==CM_PRIO_SCHED){
+						cm_sched_prio(cm_prio_gate, cm->th, &(cm->param), PNF_N_PRIO);
+					}	//In CM_PRIO_USER mode the Tx yields to m_set itself
+					n_wait.insert(&cm->pnf_node, cm, cm->getTimeParam());	//Put the new Tx in n_set
+				}
+				else{
+					pnf_admit(cm);
+				}
 			}
 			else{
-				//AND is 0. There is no conflict.
-				((ContentionManager*)new_tx_released)->m_set=true;
-				((ContentionManager*)new_tx_released)->cur_state=executing;
-				//Modify m_set_bits to include the new accessed objects' bits
-				m_set_bits |= (((ContentionManager*)new_tx_released)->curr_objs_bits);
-				((ContentionManager*)new_tx_released)->param.sched_priority=PNF_M_PRIO;
-				sched_setscheduler(((ContentionManager*)new_tx_released)->th, SCHED_FIFO, &(((ContentionManager*)new_tx_released)->param));	//Increase priority to highest value as Tx is a non-preemptive Tx
+				//A Tx has committed
+				if(cm->cur_state==retrying){
+					/*
+					 * Current Tx has committed while retrying (it happens because no other
+					 * transaction conflicts with it). Current Tx is in n_set. Remove it from there
+					 */
+					n_wait.remove(&cm->pnf_node);
+				}
+				else{
+					//Tx was executing and has committed. Remove accessed objects from m_set_objs
+					m_set_objs.leave(cm->curr_objs);
+					if(cm_prio_mode==CM_PRIO_USER){
+						cm_prio_gate.leave(false);	//Announced after the n_set is rechecked
+					}
+					check_n_set=true;
+				}
+				//Restore default values for m_set and cur_state. Otherwise, the next Tx
+				//will go on with the last values for these variables
+				cm->m_set=false;
+				cm->cur_state=released;
 			}
-			((ContentionManager*)new_tx_released)->go_on=false;	//Tell released Tx to continue execution
-			new_tx_released=0;	//reset to be used by another Tx
+			pnf_stats.events++;
+			cm->go_on.signal();	//Tell Tx to continue execution
+			ev=next;
 		}
-		if(new_tx_checking){
-			//Check Txs in n_set. Checking is done after a Tx commits
-			next_tx=0;	//Index of first Tx in n_set
-			while(next_tx<n_set.size()){
-				//Check if there is conflict with m_set_bits
-				if(m_set_bits & ((ContentionManager*)(n_set[next_tx]))->curr_objs_bits){
-					//AND is not 0. There is a conflict
-					next_tx++;	//Move to next Tx in n_set
+
+		if(check_n_set && !n_wait.empty()){
+			//Check Txs in n_set in priority order. Admit those that no longer conflict
+			pnf_stats.scans++;
+			while(PNFHeapNode* n=n_wait.pop()){
+				if(m_set_objs.overlaps(n->cm->curr_objs)){
+					still_waiting.push_back(n);
 				}
 				else{
-					//AND is 0. There is no conflict. next_tx does not need to be modified here because
-					//current Tx will be removed from n_set
-					((ContentionManager*)(n_set[next_tx]))->m_set=true;
-					((ContentionManager*)(n_set[next_tx]))->cur_state=executing;
-					m_set_bits |= (((ContentionManager*)(n_set[next_tx]))->curr_objs_bits);	//Modify m_set_bits to include the new accessed objects' bits
-					n_set.erase(n_set.begin()+next_tx);	//Remove checking Tx from n_set
-					((ContentionManager*)(n_set[next_tx]))->param.sched_priority=PNF_M_PRIO;
-					sched_setscheduler(((ContentionManager*)(n_set[next_tx]))->th, SCHED_FIFO, &(((ContentionManager*)(n_set[next_tx]))->param));	//Increase priority to highest value as Tx is a non-preemptive Tx
+					pnf_admit(n->cm);
 				}
 			}
-			new_tx_checking=0;	//reset to be used after another Tx commits
-		}
-		if(new_tx_committed){
-			//A Tx has committed
-			if(((ContentionManager*)new_tx_committed)->cur_state==retrying){
-				/*
-				 * Current Tx has committed while retrying (it happens because no other
-				 * transaction conflicts with it). Current Tx is in n_set. Remove it from there
-				 */
-                n_set.erase(n_set.begin()+nSetPos((void*)new_tx_committed));
-            }
-			else{
-				//Tx was executing and has committed
-                //Remove accessed objects from m_set_bits
-				m_set_bits &= (~(((ContentionManager*)new_tx_committed)->curr_objs_bits));
-				new_tx_checking=1;	//To start checking Txs in n_set
+			for(unsigned int i=0;i<still_waiting.size();i++){
+				n_wait.reinsert(still_waiting[i]);
 			}
-            //Restore default values for m_set and cur_state. Otherwise, the next Tx
-            //will go on with the last values for these variables
-			((ContentionManager*)new_tx_committed)->m_set=false;
-			((ContentionManager*)new_tx_committed)->cur_state=released;
-//			sched_setscheduler(((ContentionManager*)new_tx_committed)->th, SCHED_FIFO, &(((ContentionManager*)new_tx_committed)->orig_param));	//Restore priority of current Tx to its original real-time priority
-			((ContentionManager*)new_tx_committed)->go_on=false;
-			new_tx_committed=0;	//reset to be used by another Tx
+			still_waiting.clear();
+		}
+		if(check_n_set && cm_prio_mode==CM_PRIO_USER){
+			//m_set has shrunk and the n_set is rechecked. Wake Txs yielding to m_set
+			cm_prio_gate.changed();
 		}
 	}
+
+	struct timespec cpu;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+	pnf_stats.cpu_ns=(unsigned long long)cpu.tv_sec*1000000000ULL+cpu.tv_nsec;
 	pnf_main_th=0;	//reset to be used next time
 	return NULL;
 }
@@ -38,6 +38,14 @@
 #include <string>
 #include "../support/atomic_ops.h"
 #include "../support/hrtime.h"
+#include "../support/Futex.hpp"
+#include "CMClock.hpp"
+#include "CMEventRing.hpp"
+#include "PNFObjectSet.hpp"
+#include "PNFService.hpp"
+#include "CMPriority.hpp"
+#include "RTTask.hpp"
+#include "RetryCost.hpp"
 /*********************************** SH-START ******************************************/
 #include <chronos/chronos.h>
 #include <chronos/chronos_utils.h>
@@ -56,11 +64,14 @@ namespace stm
 {
   enum ConflictResolutions { AbortSelf, AbortOther, Wait };
   enum tx_state {released,retrying,executing};	//Different states for transaction
-  extern volatile unsigned long long new_tx_released;	//Holds address of a released transaction to be used in pnf_helper
-  extern volatile unsigned int new_tx_checking;	//If 1, then pnf_main should check Txs in n_set
-  extern volatile unsigned long long new_tx_committed;	//Holds address of a committed transaction to be used in pnf_helper
-  extern volatile unsigned long long m_set_bits;	//Holds bit representation of all objects held in m_set in PNF
-  										//Due to current implementation, m_set_bits cannot exceed 64 objects
+  extern PNFEventQueue pnf_events;	//Requests from released and committed Txs, served by pnf_main
+  extern volatile int pnf_service_parked;	//1 while pnf_main sleeps waiting for requests. Futex word
+  extern PNFServiceStats pnf_stats;	//What pnf_main has done, and its CPU time
+  extern PNFConflictSet m_set_objs;	//Objects held by Txs in m_set in PNF
+  extern void pnf_set_configure(unsigned long width, bool exact);	//Size m_set_objs, and pick hashed or exact mode. Call before starting PNF Txs
+  extern CMPrioMode cm_prio_mode;	//How PNF and FBLT raise m_set Txs: SCHED_FIFO, or the user-space gate
+  extern CMPriorityGate cm_prio_gate;	//m_set membership and yielding Txs in CM_PRIO_USER mode, and the counters of both modes
+  extern void cm_prio_configure(CMPrioMode mode);	//Pick the mode and reset the counters. Call before starting PNF or FBLT Txs
   extern pthread_t pnf_main_th;				//pnf_main service thread
   extern pthread_attr_t pnf_th_attr;			//Attributes for pnf_main service thread
   extern struct sched_param pnf_main_param;	//scheduling parameters for pnf_main service
@@ -71,23 +82,39 @@ namespace stm
   extern void pnf_main_start();	//Starts pnf_main service. This function must be called before initiating PNF CM for any task
   extern void pnf_main_stop();	//Stops pnf_main service
   extern void* pnf_main(void* arg);	//Main (centralized) service of PNF. It continues execution until all tasks finish. It is invoked by Txs to execute some tasks
+  extern void pnf_post_wait(ContentionManager* cm, PNFEvent::Kind kind);	//Post a request for cm to pnf_main and wait until it is served
 
   class ContentionManager
   {
+      /*
+       * Layout: the fields an enemy reads when it resolves a conflict with
+       * us come first, right after the vtable pointer, and fill one cache
+       * line.  The pnf_main handshake and the owner's own bookkeeping each
+       * start a new line, so neither the service nor our own writes keep
+       * pulling the conflict fields out of an enemy's cache.
+       */
     protected:
       int priority;
     public:
-      	struct timespec time_param;			//input parameter for ECM which should be cast to deadline
-                                       		//In case of RCM, it holds the period
+		cm_ticks_t stamp;			//records the beginning of the transaction. CMClock ticks
+		unsigned long long time_key;		//time_param as one number, so CMs compare it in one step
 		unsigned long length;				//specific for LCM
 		double psy;							//specific for LCM
-		struct timespec stamp, tra_abort;		//stamp records the beginning of the transaction, while tra_abort records when the transaction is aborted
+		bool m_set;				//if "true", tx is an executing tx. Otherwise, tx is a retrying one.
+		tx_state cur_state;			//Holds state of current transaction
+
+		FutexFlag go_on __attribute__((aligned(64)));	//Pending while pnf_main has not yet served current Tx's request. It is used to
+						//synchronize execution between pnf_main and current Tx
+		PNFEvent pnf_ev;		//Current Tx's request to pnf_main
+		PNFHeapNode pnf_node;	//Current Tx's place in the n_set while it is retrying
+
+		cm_ticks_t tra_abort __attribute__((aligned(64)));	//records when the transaction is aborted. CMClock ticks
+		struct timespec time_param;			//input parameter for ECM which should be cast to deadline
+										//In case of RCM, it holds the period. Set it with setTimeParam()
 		unsigned long long total_abort_duration;	//Holds the total abort time of all instances of the thread during the whole run time of experimennt
 		vector<double> acc_obj;                         //list of accessed objects by current tx
 		int th;				//ptr to current thread
-		vector<string> rec;	//Holds intermediate records for logging
-		stringstream rec_in;
-		struct timespec rec_time;
+		CMEventRing* events;	//Debug records, allocated on first use. See logEvent()
 		struct sched_param param;
 		struct sched_param param_tmp;
 		int policy;
@@ -102,32 +129,93 @@ namespace stm
 							//Used in FBLT
 		bool new_tx;	//if true, it is first time to begin transaction. Otherwise, tx has already begun and it is just
 						//an abort and retry
-		unsigned long long curr_objs_bits;	//Indices of accessed objects by current Tx. If bit at position X=1, then
-											//current Tx accesses object number X. It should be identified at Tx_begin.
-											//As curr_objs is represented with unsigned long long, than maximum
-											//number of accessed objects cannot exceed 64
-		unsigned long long cur_m_set_bits;	//current version of m_set_bits. It is used with lock-free conflict checking in some CMs like PNF
-		unsigned long long new_m_set_bits;	//New m_set_bits from the perspective of cur_m_set_bits and current Tx
-		bool go_on;	//If true, pnf_main tells current Tx to complete execution. It is used to
-					//synchronize execution between pnf_main and current Tx
-		tx_state cur_state;			//Holds state of current transaction
+		PNFObjectSet curr_objs;	//Objects accessed by current Tx, in the form m_set_objs uses. It should be
+								//identified at Tx_begin from acc_obj
 		struct sched_param orig_param;	//records original sched_param for current thread when a Tx starts
-		bool m_set;				//if "true", tx is an executing tx. Otherwise, tx is a retrying one.
+		const RTTask* task;	//Task whose parameters were last loaded by beginTask()
+		unsigned long task_version;	//task->version when they were loaded
+		cm_ticks_t due;		//Deadline of current Tx (CMClock ticks), from its RTTask. 0 if none
+		RetryCostTable retry_cost;	//Retry cost of recent committed Txs, per task. See noteCommit()
+		unsigned long tx_aborts;	//Aborts of current Tx so far
+		unsigned long long tx_abort_mark;	//total_abort_duration when current Tx began
+
+		void logEvent(int kind, long long a, long long b){
+		//Record a debug event. Compiled in only with STM_CM_EVENT_LOG
+#ifdef STM_CM_EVENT_LOG
+			if(!events)
+				events=new CMEventRing();
+			events->record(kind, th, a, b);
+#endif
+		}
 
 		vector<string> getRec(){
+		//Formats the debug records as lines of "ns\tth\ta\tb\tevent"
+            vector<string> rec;
+            if(events)
+                events->format(rec);
             return rec;
         }
         
         void newInst(){
             //Declares a new instance of the current thread
             //Define things that need to be renewed in the new instance
-            rec=vector<string> ();
+            if(events)
+                events->clear();
+        }
+
+        void beginTask(const RTTask* t){
+            //First begin of a new Tx of task t. Reload t's parameters only if t is not the task
+            //loaded last time or has changed since. Retries of the Tx don't come here
+            new_tx=false;
+            if((t!=task) || (t->version!=task_version)){
+                task_run_prio=t->run_prio;
+                task_end_prio=t->end_prio;
+                task_util=t->util;
+                task_deadline=t->deadline;
+                task_period=t->period;
+                task_unlocked=t->unlocked;
+                task_locked=t->locked;
+                setTimeParam(t->time_param);
+                setAccObj(t->objects);
+                setCurThr(t->th);
+                if(t->length){
+                    setLength(t->length);
+                    setPsy(t->psy);
+                }
+                task=t;
+                task_version=t->version;
+            }
+            eta=t->eta;	//Abort budget and deadline are per Tx
+            due=t->due;
+        }
+
+        void noteAbort(){
+            //Count an abort of current Tx. Real-time CMs call it after updating total_abort_duration
+            tx_aborts++;
+        }
+
+        void noteCommit(){
+            //Current Tx committed. Feed its aborts and time lost to them into its task's estimate
+            retry_cost.sample(task, tx_aborts, total_abort_duration-tx_abort_mark);
+            tx_aborts=0;
+            tx_abort_mark=total_abort_duration;
+        }
+
+        const RetryEstimate* getRetryCost(){
+            //Recent retry cost of Txs of the current task, or NULL if none has committed yet
+            return retry_cost.find(task);
         }
 
         struct timespec* getTimeParam(){
           return &time_param;
         }
 
+        void setTimeParam(const struct timespec& in_time_param){
+          //Set the deadline or period, and its comparable key
+          time_param=in_time_param;
+          time_key=timespec_key(in_time_param);
+        }
+
 	/******************** LCM functions start ********************/
 
 	void setLength(unsigned long in_length){
@@ -148,12 +236,12 @@ namespace stm
 	/******************** LCM functions end ********************/
 
 	/******************** SH-START *******************/
-        void setAccObj(vector<double> in_acc_obj){
-	//Set list of accessed objects by current transaction
-		acc_obj=in_acc_obj;
+        void setAccObj(const vector<double>& in_acc_obj){
+	//Set list of accessed objects by current transaction. Reuses acc_obj's storage
+		acc_obj.assign(in_acc_obj.begin(), in_acc_obj.end());
 	}
 
-	vector<double> getAccObj(){
+	const vector<double>& getAccObj(){
 	//get list of accessed objects by current transaction
 		return acc_obj;
 	}
@@ -168,12 +256,20 @@ namespace stm
 		return th;
 	}
 
-      ContentionManager() : priority(0),total_abort_duration(0){
+      ContentionManager() : priority(0),total_abort_duration(0),events(NULL){
 	/******************************* SH-START **********************************/
-	tra_abort.tv_sec=0;
-	tra_abort.tv_nsec=0;
+	CMClock::init();
+	stamp=0;
+	tra_abort=0;
+	time_param.tv_sec=0;
+	time_param.tv_nsec=0;
+	time_key=0;
 	new_tx=true;
-	go_on=false;
+	task=NULL;
+	task_version=0;
+	due=0;
+	tx_aborts=0;
+	tx_abort_mark=0;
 	/******************************* SH-END **********************************/
       }
       int getPriority() { return priority; }
@@ -182,7 +278,8 @@ namespace stm
       // Transaction-level events
       virtual void onBeginTransaction() {
 	  try{
-		clock_gettime(CLOCK_REALTIME, &stamp);
+		stamp=CMClock::now();
+		logEvent(CM_EV_BEGIN, priority, 0);
 		/********************************* Debug 5 start ********************************/
 		//tra_start.push_back(stamp);
 		/********************************* Debug 5 end ********************************/
@@ -194,11 +291,15 @@ namespace stm
 	virtual void onTransactionCommitted() {
 		priority = 0;	//This step is not part of PNF. It comes from original CM
 		new_tx=true;
+		noteCommit();
+		logEvent(CM_EV_COMMIT, 0, 0);
 	}
       virtual void onTransactionAborted() {
 	  try{
-		clock_gettime(CLOCK_REALTIME, &tra_abort);
-		total_abort_duration+=subtract_ts_mod(&stamp,&tra_abort);
+		tra_abort=CMClock::now();
+		total_abort_duration+=CMClock::to_ns(tra_abort-stamp);
+		noteAbort();
+		logEvent(CM_EV_ABORT, total_abort_duration, 0);
 	    }catch(exception e){
 		cout<<"onTransactionAborted exception: "<<e.what()<<endl;
 	    }
@@ -218,7 +319,7 @@ namespace stm
       virtual ConflictResolutions onWAR(ContentionManager* enemy) = 0;
       virtual ConflictResolutions onWAW(ContentionManager* enemy) = 0;
 
-      virtual ~ContentionManager() { }
+      virtual ~ContentionManager() { delete events; }
   };
 
   // create a contention manager
@@ -133,15 +133,11 @@ stm::ECM::shouldAbort(ContentionManager* enemy)
 {
     //struct timespec* deadline=this->GetDeadline();
     ECM* t=static_cast<ECM*>(enemy);
-    timespec* other_deadline=t->GetDeadline();
-    if(time_param.tv_sec < other_deadline->tv_sec){
-	return AbortOther;
-    }
-    else if(time_param.tv_sec == other_deadline->tv_sec && time_param.tv_nsec < other_deadline->tv_nsec){
+    if(time_key < t->time_key){
 	return AbortOther;
     }
     //The following case needs to have more restrict criteria
-    else if(time_param.tv_sec==other_deadline->tv_sec&&time_param.tv_nsec==other_deadline->tv_nsec){
+    else if(time_key == t->time_key){
         return AbortOther;
     }
 /*
@@ -9,6 +9,7 @@
 #endif
 
 #include "ContentionManager.hpp"
+#include "AlphaCache.hpp"
 #include <time.h>
 #include <iostream>
 #include <sstream>
@@ -40,18 +41,24 @@ namespace stm
 
     public:
 	
-	bool m_set;                     //If true, current transaction is in m_set
-        struct timespec m_set_join;     //Records time of joining current transaction to m_set
+	//The inherited m_set (on the conflict line) is true while current transaction is in m_set.
+	//m_set_join is the other field enemies read, so it opens FBLT's part of the object,
+	//and the fields only this thread writes start a line of their own
+        cm_ticks_t m_set_join;          //Records time (CMClock ticks) of joining current transaction to m_set
         struct fblt_args args;
-        struct timespec now;
+        struct timespec now __attribute__((aligned(64)));
+        AlphaCache alpha_cache;         //Abort thresholds per enemy, so conflicts need no log()
+        int abort_gen;                  //cm_prio_gate generation when current transaction last aborted
+        bool retry;                     //true between an abort and the next begin
         
         FBLT(){
             new_tx=true;
 	    m_set=false;
 	    eta=-1;
             //Initilize m_set_join to dummy value
-            m_set_join.tv_sec=LONG_MAX;
-            m_set_join.tv_nsec=LONG_MAX;
+            m_set_join=CM_TICKS_MAX;
+            abort_gen=0;
+            retry=false;
         }
         
 	FBLT(void* t_args){
@@ -59,8 +66,9 @@ namespace stm
 		m_set=false;
 		eta=-1;
                 //Initilize m_set_join to dummy value
-                m_set_join.tv_sec=LONG_MAX;
-                m_set_join.tv_nsec=LONG_MAX;
+                m_set_join=CM_TICKS_MAX;
+                abort_gen=0;
+                retry=false;
                 args=*((struct fblt_args*)t_args);
                 length=args.length;
                 psy=args.psy;
@@ -69,54 +77,57 @@ namespace stm
       
       //The inherited time_param is the input deadline
       timespec* GetDeadline() {return &time_param;}
-      timespec* GetTimestamp() { return &stamp; }
+      cm_ticks_t GetTimestamp() { return stamp; }
       struct fblt_args* getFBLTargs(){
           return &args;
       }
 
       void onBeginTransaction(){
-        clock_gettime(CLOCK_REALTIME, &stamp); 
+	if(retry && (!m_set) && (eta!=0) && (cm_prio_mode==CM_PRIO_USER)){
+            //Retrying outside m_set with no priority below m_set to run at. Yield until an
+            //m_set transaction leaves (at once if none was in m_set when we aborted)
+            cm_prio_gate.await(abort_gen);
+	}
+        retry=false;
+        stamp=CMClock::now();
 	if((!m_set) && (eta==0)){
             //End work in real time priority to increase priority of current transaction
             //First time to include current transaction in m_set
             //set m_set to true and increase priority of current transaction
-            end_rtseg_self(PNF_M_PRIO);
+            if(cm_prio_mode==CM_PRIO_SCHED){
+                __sync_fetch_and_add(&cm_prio_gate.stats.sched_calls, 1);
+                end_rtseg_self(PNF_M_PRIO);
+            }
+            else{
+                cm_prio_gate.enter();
+            }
             m_set=true;
             //Record time of joining m_set to be used in conflict resolution
-            clock_gettime(CLOCK_REALTIME, &m_set_join);
+            m_set_join=CMClock::now();
+            logEvent(CM_EV_MSET, eta, 0);
 	}
-		/******************** Debug 3 start **********************/              
-/* 
-                clock_gettime(CLOCK_REALTIME, &rec_time);
-                sched_getparam(0, &param);
-                rec_in << (rec_time.tv_sec) << "\t" << (rec_time.tv_nsec) << "\t" << th << "\t" << (param.sched_priority) << "\t" << m_set << "\t" <<eta<<"\t"<<m_set_join.tv_sec<<"\t"<<m_set_join.tv_nsec<<"\t"<< "startBeginTx" << endl;
-                rec.push_back(rec_in.str());
-                rec_in.str("");              
-*/
-                /******************** Debug 3 end **********************/
+                logEvent(CM_EV_BEGIN, m_set, eta);
       }
       
       void onTransactionCommitted(){
           try{
 //	      eta=-1;
 	      new_tx=true;
+	      noteCommit();
               //If current tx is in m_set, reduce its priority to real-time task
               if(m_set){
                   m_set=false;
-		  m_set_join.tv_sec=LONG_MAX;
-		  m_set_join.tv_nsec=LONG_MAX;
-                  begin_rtseg_self(task_run_prio, task_util, task_deadline, task_period,
+		  m_set_join=CM_TICKS_MAX;
+                  if(cm_prio_mode==CM_PRIO_SCHED){
+                      __sync_fetch_and_add(&cm_prio_gate.stats.sched_calls, 1);
+                      begin_rtseg_self(task_run_prio, task_util, task_deadline, task_period,
 		task_unlocked + task_locked);
+                  }
+                  else{
+                      cm_prio_gate.leave();     //Wake transactions yielding to m_set
+                  }
               }
-                /******************** Debug 3 start **********************/
-/*  
-                clock_gettime(CLOCK_REALTIME, &rec_time);
-                sched_getparam(0, &param);
-                rec_in << (rec_time.tv_sec) << "\t" << (rec_time.tv_nsec) << "\t" << th << "\t" << (param.sched_priority) << "\t" << m_set << "\t" <<eta<<"\t"<<m_set_join.tv_sec<<"\t"<<m_set_join.tv_nsec<<"\t"<< "committingTx" << endl;
-                rec.push_back(rec_in.str());
-                rec_in.str("");              
-*/
-                /******************** Debug 3 end **********************/
+                logEvent(CM_EV_COMMIT, m_set, eta);
           }catch(exception e){
 		cout<<"onTxCommitted exception: "<<e.what()<<endl;
 	    }
@@ -124,20 +135,15 @@ namespace stm
       
       void onTransactionAborted(){
           try{
-              clock_gettime(CLOCK_REALTIME, &tra_abort);
-              total_abort_duration+=subtract_ts_mod(&stamp,&tra_abort);
+              tra_abort=CMClock::now();
+              total_abort_duration+=CMClock::to_ns(tra_abort-stamp);
+              noteAbort();
+              abort_gen=cm_prio_gate.generation();
+              retry=true;
 	      if(eta>0){
 		eta--;
 	      }
-                /******************** Debug 3 start **********************/
-/*  
-                clock_gettime(CLOCK_REALTIME, &rec_time);
-                sched_getparam(0, &param);
-                rec_in << (rec_time.tv_sec) << "\t" << (rec_time.tv_nsec) << "\t" << th << "\t" << (param.sched_priority) << "\t" << m_set << "\t" <<eta<<"\t"<<m_set_join.tv_sec<<"\t"<<m_set_join.tv_nsec<<"\t"<<total_abort_duration<<"\t"<< "AbortTx" << endl;
-                rec.push_back(rec_in.str());
-                rec_in.str("");              
-*/
-                /******************** Debug 3 end **********************/
+                logEvent(CM_EV_ABORT, total_abort_duration, eta);
 
           }catch(exception e){
               cout<<"onTransactionAborted exception: "<<e.what()<<endl;
@@ -166,19 +172,14 @@ stm::FBLT::shouldAbort(ContentionManager* enemy)
 {
     //struct timespec* deadline=this->GetDeadline();
     FBLT* t=static_cast<FBLT*>(enemy);
-    timespec* other_time_param=t->getTimeParam();
     bool other_m_set=t->m_set;
-    timespec other_m_set_join=t->m_set_join;
-    struct timespec* other_timestamp=t->GetTimestamp();
-    long double alpha,passed;   //alpha is the threshold of the interfered transaction
-                                // passed is the percentage of already executed part of the interfered transaction
+    cm_ticks_t other_m_set_join=t->m_set_join;
+    cm_ticks_t other_timestamp=t->GetTimestamp();
     if(m_set){
         if(!other_m_set){
             return AbortOther;
         }else{
-            if(m_set_join.tv_sec<other_m_set_join.tv_sec){
-                return AbortOther;
-            }else if(m_set_join.tv_sec==other_m_set_join.tv_sec && m_set_join.tv_nsec<other_m_set_join.tv_nsec){
+            if(m_set_join<other_m_set_join){
                 return AbortOther;
             }
             else{
@@ -191,17 +192,18 @@ stm::FBLT::shouldAbort(ContentionManager* enemy)
             return AbortSelf;
         }else{
             //Normal comparison using priority. Default to LCM
-            if(time_param.tv_sec<other_time_param->tv_sec || (time_param.tv_sec==other_time_param->tv_sec && time_param.tv_nsec<=other_time_param->tv_nsec)){
+            //Thresholds replace "passed <= alpha": alpha times the length of the interfered transaction,
+            //in ticks, against the time it has already executed
+            const AlphaCache::Thresholds& th=alpha_cache.lookup(t,length,psy,t->length,t->psy);
+            if(time_key<=t->time_key){
                 //If current transaction started BEFORE the other one
-                if(stamp.tv_sec<other_timestamp->tv_sec || (stamp.tv_sec==other_timestamp->tv_sec && stamp.tv_nsec <= other_timestamp->tv_nsec)){
+                if(stamp<=other_timestamp){
                     return AbortOther;
                 }
                 //If current transaction started AFTER the other
                 else{
                         //Needs to check alpha
-                        alpha=checkAlpha((FBLT*)enemy,this); //Alpha of the enemy
-                        passed=((FBLT*)enemy)->getPassed();  //passed of the enemy
-                        if(passed<=alpha){
+                        if((long long)(CMClock::now()-other_timestamp)<=th.enemy_ticks){  //passed of the enemy <= alpha of the enemy
                                 return AbortOther;
                         }
                 }
@@ -209,15 +211,13 @@ stm::FBLT::shouldAbort(ContentionManager* enemy)
              //If current task has a LOWER priority
              else{
                 //If current transaction started AFTER the other
-                if(stamp.tv_sec>other_timestamp->tv_sec || (stamp.tv_sec==other_timestamp->tv_sec && stamp.tv_nsec > other_timestamp->tv_nsec)){
+                if(stamp>other_timestamp){
                         return AbortSelf;
                 }
                 //If current transaction started BEFORE the other
                 else{
                         //Needs to check alpha
-                        alpha=checkAlpha(this,(FBLT*)enemy); //alpha of current LCM
-                        passed=this->getPassed();           //passed of current LCM
-                        if(passed>alpha){
+                        if((long long)(CMClock::now()-stamp)>th.self_ticks){  //passed of current FBLT > alpha of current FBLT
                         return AbortOther;
                 }
                 }
@@ -237,8 +237,6 @@ inline long double stm::FBLT::checkAlpha(struct FBLT* first,struct FBLT* second)
 inline long double stm::FBLT::getPassed(){
     //This function returns the percentage of the already executed lenght of the current transaction
     //relative to the total length of the current transaction
-    struct timespec now;
-    clock_gettime(CLOCK_REALTIME, &now);
-    return ((long double)subtract_ts_mod(&stamp,&now)/(this->getLength()))/1000;//Note that subtract_ts produces result in n_sec but length is in u_sec
+    return ((long double)CMClock::to_ns(CMClock::now()-stamp)/(this->getLength()))/1000;//Note that the difference is in n_sec but length is in u_sec
 }
 #endif // __FBLT_H__
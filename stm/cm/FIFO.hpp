@@ -37,7 +37,6 @@ namespace stm
           max_tries = MAX_TRIES;
       }
 */
-        struct timespec stamp;
       ConflictResolutions shouldAbort(ContentionManager* enemy);
 
     public:
@@ -45,7 +44,8 @@ namespace stm
       FIFO() /*: tries(0), max_tries(MAX_TRIES), defunct(false)*/ {
       }
       
-      timespec* GetTimestamp() { return &time_param; }
+      //The inherited stamp is set when the transaction begins
+      cm_ticks_t GetTimestamp() { return stamp; }
 /*
       void SetDefunct() { defunct = true; }
       bool GetDefunct() { return defunct; }
@@ -84,11 +84,7 @@ inline stm::ConflictResolutions
 stm::FIFO::shouldAbort(ContentionManager* enemy)
 {
     FIFO* t=static_cast<FIFO*>(enemy);
-    struct timespec* other_stamp=t->GetTimestamp();
-    if(stamp.tv_sec < other_stamp->tv_sec)
-	return AbortOther;
-
-    else if (stamp.tv_sec == other_stamp->tv_sec && stamp.tv_nsec <= other_stamp->tv_nsec)
+    if(stamp <= t->GetTimestamp())
 	return AbortOther;
 
 /*
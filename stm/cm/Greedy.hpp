@@ -36,7 +36,7 @@
 #define __GREEDY_H
 
 #include "ContentionManager.hpp"
-#include "../support/atomic_ops.h"
+#include "TimestampAllocator.hpp"
 
 namespace stm
 {
@@ -49,19 +49,20 @@ namespace stm
       unsigned long timestamp; // For priority
       bool waiting;
 
-      static volatile unsigned long timeCounter;
+      static TimestampSource timestamps;
+      TimestampRange         range;
 
       ConflictResolutions shouldAbort(ContentionManager* enemy);
 
     public:
-      Greedy() : waiting(false) { timestamp = fai(&timeCounter); }
+      Greedy() : waiting(false) { timestamp = range.take(timestamps); }
 
       virtual void onBeginTransaction() { waiting = false; }
 
       virtual void onTransactionCommitted()
       {
           priority = 0;
-          timestamp = fai(&timeCounter);
+          timestamp = range.take(timestamps);
       }
 
       virtual ConflictResolutions onRAW(ContentionManager* e)
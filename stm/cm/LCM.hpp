@@ -16,6 +16,7 @@
 #endif
 
 #include "ContentionManager.hpp"
+#include "AlphaCache.hpp"
 #include <time.h>
 #include <chronos/chronos_utils.h>
 #include <cmath>
@@ -47,6 +48,7 @@ namespace stm
         struct lcm_args args;
         //struct timespec stamp;
         struct timespec now;
+        AlphaCache alpha_cache;	//Abort thresholds per enemy, so conflicts need no log()
 	//unsigned long length;
 	//double psy;
 	
@@ -63,7 +65,7 @@ namespace stm
 	length=args.length;
 	psy=args.psy;
     }
-      timespec* GetTimestamp() { return &stamp; }
+      cm_ticks_t GetTimestamp() { return stamp; }
       struct lcm_args* getLCMargs(){
           return &args;
       }
@@ -127,22 +129,20 @@ inline stm::ConflictResolutions
 stm::LCM::shouldAbort(ContentionManager* enemy)
 {
     LCM* t=static_cast<LCM*>(enemy);
-    struct timespec* other_timestamp=t->GetTimestamp();
-    struct timespec* other_time_param=t->getTimeParam();
-    long double alpha,passed;//alpha is the threshold of the interfered transaction
-                        // passed is the percentage of already executed part of the interfered transaction
+    cm_ticks_t other_timestamp=t->GetTimestamp();
+    //Thresholds replace "passed <= alpha": alpha times the length of the interfered transaction, in
+    //ticks, against the time it has already executed
+    const AlphaCache::Thresholds& th=alpha_cache.lookup(t,length,psy,t->length,t->psy);
     //If current task has a HIGHER priority
-    if(time_param.tv_sec<other_time_param->tv_sec || (time_param.tv_sec==other_time_param->tv_sec && time_param.tv_nsec<=other_time_param->tv_nsec)){
+    if(time_key<=t->time_key){
         //If current transaction started BEFORE the other one
-        if(stamp.tv_sec<other_timestamp->tv_sec || (stamp.tv_sec==other_timestamp->tv_sec && stamp.tv_nsec <= other_timestamp->tv_nsec)){
+        if(stamp<=other_timestamp){
             return AbortOther;
         }
         //If current transaction started AFTER the other
         else{
             //Needs to check alpha
-            alpha=checkAlpha((LCM*)enemy,this); //Alpha of the enemy
-            passed=((LCM*)enemy)->getPassed();  //passed of the enemy
-            if(passed<=alpha){
+            if((long long)(CMClock::now()-other_timestamp)<=th.enemy_ticks){	//passed of the enemy <= alpha of the enemy
                 /********************* Debug 1 start *************************/
                 //cout<<"c_d:"<<time_param.tv_sec<<" sec, "<<time_param.tv_nsec<<" nsec, o_d:"<<other_time_param->tv_sec<<" sec, "<<other_time_param->tv_nsec<<" nsec, o_alpha:"<<alpha<<", o_passed:"<<passed<<", abort_other"<<endl;
                 /********************* Debug 1 end *************************/
@@ -158,15 +158,13 @@ stm::LCM::shouldAbort(ContentionManager* enemy)
     //If current task has a LOWER priority
     else{
         //If current transaction started AFTER the other
-        if(stamp.tv_sec>other_timestamp->tv_sec || (stamp.tv_sec==other_timestamp->tv_sec && stamp.tv_nsec > other_timestamp->tv_nsec)){
+        if(stamp>other_timestamp){
             return AbortSelf;
         }
         //If current transaction started BEFORE the other
         else{
             //Needs to check alpha
-            alpha=checkAlpha(this,(LCM*)enemy); //alpha of current LCM
-            passed=this->getPassed();           //passed of current LCM
-            if(passed>alpha){
+            if((long long)(CMClock::now()-stamp)>th.self_ticks){	//passed of current LCM > alpha of current LCM
                 /********************* Debug 3 start *************************/
                 //cout<<"c_d:"<<time_param.tv_sec<<" sec, "<<time_param.tv_nsec<<" nsec, o_d:"<<other_time_param->tv_sec<<" sec, "<<other_time_param->tv_nsec<<" nsec, c_alpha:"<<alpha<<", c_passed:"<<passed<<", abort_other"<<endl;
                 /********************* Debug 3 end *************************/
@@ -217,8 +215,6 @@ inline long double stm::LCM::checkAlpha(struct LCM* first,struct LCM* second){
 inline long double stm::LCM::getPassed(){
     //This function returns the percentage of the already executed lenght of the current transaction
     //relative to the total length of the current transaction
-    struct timespec now;
-    clock_gettime(CLOCK_REALTIME, &now);
     /***************************** Debug 5 start **********************************/
     /*
     double diff=subtract_ts(&stamp,&now);
@@ -226,7 +222,7 @@ inline long double stm::LCM::getPassed(){
     cout<<"stamp:"<<stamp.tv_sec<<" sec, "<<stamp.tv_nsec<<" nsec"<<", now:"<<now.tv_sec<<" sec, "<<now.tv_nsec<<" nsec"<<", diff:"<<diff<<", length:"<<this->args.length<<", passed:"<<result<<endl;
     */
     /***************************** Debug 5 end **********************************/
-    return ((long double)subtract_ts(&stamp,&now)/(this->getLength()))/1000;//Note that subtract_ts produces result in n_sec but length is in u_sec
+    return ((long double)CMClock::to_ns(CMClock::now()-stamp)/(this->getLength()))/1000;//Note that the difference is in n_sec but length is in u_sec
     //return result;
 }
 /*
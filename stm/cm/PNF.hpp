@@ -43,8 +43,8 @@ namespace stm
 		cur_state=released;
     }
 
-    timespec* GetTimestamp(){
-    	return &stamp;
+    cm_ticks_t GetTimestamp(){
+    	return stamp;
     }
 
 	void setMset(bool in_m_set){
@@ -59,50 +59,76 @@ namespace stm
 
 	void setObjBits(){
 		/*
-		 * Transform accessed objects into binary form.
+		 * Transform accessed objects into the form m_set_objs uses.
 		 */
-		unsigned int acc_obj_size=acc_obj.size();
-		for(unsigned int i=0;i<acc_obj_size;i++){
-			curr_objs_bits|=((unsigned long long)1)<<((int)(acc_obj[i]));
-		}
+		m_set_objs.build(curr_objs,acc_obj);
 	}
 
 	virtual void onBeginTransaction() {
 	  try{
-		clock_gettime(CLOCK_REALTIME, &stamp);
+		stamp=CMClock::now();
+		logEvent(CM_EV_BEGIN, cur_state, m_set);
+		bool yield=(cm_prio_mode==CM_PRIO_USER);	//No low priority to run at. Wait for m_set instead
+		int gen=cm_prio_gate.generation();	//Read before checking m_set, so no Tx leaving is missed
 		if(cur_state==released){
 			sched_getparam(0,&orig_param);	//records original sched_param for current thread
-			curr_objs_bits=0;	//Reset to set bits corresponding to objects of current Tx
-			setObjBits();
+			setObjBits();	//Reset to objects of current Tx
+			if(pnf_main_th){
+				//pnf_main decides whether current Tx executes or waits in n_set
+				pnf_post_wait(this, PNFEvent::RELEASED);
+				if(yield && cur_state==retrying){
+					cm_prio_gate.await(gen);	//Until an m_set Tx leaves and pnf_main rechecks n_set
+				}
+				return;
+			}
+		}
+		else if(pnf_main_th){
+			//Retrying Tx restarting after an abort. pnf_main moves it to m_set when possible
+			if(yield && !m_set){
+				cm_prio_gate.await(gen);
+			}
+			return;
 		}
 		//check conflict between current Tx and other Txs
-		cur_m_set_bits=m_set_bits;	//current version of m_set_bits
-		if(cur_m_set_bits & curr_objs_bits){
+		bool conflict=m_set_objs.overlaps(curr_objs);
+		if(conflict && yield && !m_set){
+			//Yield until an m_set Tx leaves, then look once more. Never wait on ourselves
+			cm_prio_gate.await(gen);
+			conflict=m_set_objs.overlaps(curr_objs);
+		}
+		if(conflict){
 			/*
-			 * This is a weak comparison because m_set_bits might have already changed by now. But to enhance
+			 * This is a weak comparison because m_set_objs might have already changed by now. But to enhance
 			 * performance, we use it this way
 			 */
 			//There is a conflict
 			if(cur_state==released){
 				//Change status and priority if not already done so
 				cur_state=retrying;
-				param.sched_priority=PNF_N_PRIO;
-				sched_setscheduler(0, SCHED_FIFO, &param);
+				if(!yield){
+					cm_sched_prio(cm_prio_gate, 0, &param, PNF_N_PRIO);
+				}
 			}
 		}
 		else{
 			/*
-			 * According to current version of m_set_bits, there is no conflict. But we must use lock-free
+			 * According to current version of m_set_objs, there is no conflict. But we must use lock-free
 			 * operation to be sure
 			 */
 			mu_lock();
-			if(!(m_set_bits & curr_objs_bits)){
-				m_set_bits |= curr_objs_bits;
-				param.sched_priority=PNF_M_PRIO;
-				sched_setscheduler(0, SCHED_FIFO, &param);
+			if(!m_set_objs.overlaps(curr_objs)){
+				m_set_objs.join(curr_objs);
+				if(yield){
+					cm_prio_gate.enter();
+				}
+				else{
+					cm_sched_prio(cm_prio_gate, 0, &param, PNF_M_PRIO);
+				}
 				m_set=true;
 			}
 			mu_unlock();
+			if(m_set)
+				logEvent(CM_EV_MSET, cur_state, 0);
 		}
 	  }catch(exception e){
 	    	cout << "onBeginTransaction exception: " << e.what() << endl;
@@ -111,10 +137,24 @@ namespace stm
 
 	virtual void onTransactionCommitted() {
 		try{
+			new_tx=true;
+			noteCommit();
+			logEvent(CM_EV_COMMIT, cur_state, m_set);
+			if(pnf_main_th){
+				//pnf_main releases our objects and rechecks n_set
+				pnf_post_wait(this, PNFEvent::COMMITTED);
+				return;
+			}
+			//Release our objects if we joined m_set; other Txs' objects stay
+			if(m_set){
+				mu_lock();
+				m_set_objs.leave(curr_objs);
+				mu_unlock();
+				if(cm_prio_mode==CM_PRIO_USER){
+					cm_prio_gate.leave();	//Wake Txs yielding to m_set
+				}
+			}
 			m_set=false;
-			mu_lock();
-			cur_m_set_bits &= (~curr_objs_bits);
-			mu_unlock();
 			cur_state=released;
 			//sched_setscheduler(0, SCHED_FIFO, &orig_param);	//Restore priority of current Tx to its original real-time priority
 		}catch(exception e){
@@ -124,8 +164,10 @@ namespace stm
 
     virtual void onTransactionAborted() {
 	    try{
-		  clock_gettime(CLOCK_REALTIME, &tra_abort);
-		  total_abort_duration+=subtract_ts_mod(&stamp,&tra_abort);
+		  tra_abort=CMClock::now();
+		  total_abort_duration+=CMClock::to_ns(tra_abort-stamp);
+		  noteAbort();
+		  logEvent(CM_EV_ABORT, total_abort_duration, cur_state);
 	    }catch(exception e){
 		  cout << "onTransactionAborted exception: " << e.what() << endl;
 	    }
@@ -185,7 +227,7 @@ stm::PNF::shouldAbort(ContentionManager* enemy)
 		/*
 		 * Precaution case due to timing issues
 		 */
-		if(compTimeSpec(&stamp,&(((PNF*)enemy)->stamp))){
+		if(stamp<((PNF*)enemy)->stamp){
 			return AbortOther;
 		}
 		else{
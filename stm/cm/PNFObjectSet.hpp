@@ -0,0 +1,246 @@
+#ifndef __PNFOBJECTSET_H__
+#define __PNFOBJECTSET_H__
+
+#include <vector>
+#include <algorithm>
+
+/**
+ *  Default width of the PNF conflict set: the number of bits in hashed mode,
+ *  or of ownership words in exact mode.  64 matches the old single-word
+ *  bitmap; stm::pnf_set_configure() changes it at run time.
+ */
+#ifndef STM_PNF_SET_BITS
+#define STM_PNF_SET_BITS 64
+#endif
+
+namespace stm
+{
+  class PNFConflictSet;
+
+  /**
+   *  The objects a PNF transaction is going to access (its acc_obj list), in
+   *  the form PNFConflictSet works with.  In hashed mode that is a sorted
+   *  list of (word, bits) pairs, one per word of the set that the objects
+   *  touch; in exact mode it is the sorted object ids themselves.  Either
+   *  way every test against the set costs time in proportion to the number
+   *  of objects, not the width of the set.
+   */
+  class PNFObjectSet
+  {
+      struct Mask
+      {
+          unsigned long word;
+          unsigned long bits;
+      };
+
+      std::vector<Mask>          masks;
+      std::vector<unsigned long> ids;
+
+      friend class PNFConflictSet;
+
+    public:
+      bool empty() const { return masks.empty() && ids.empty(); }
+  };
+
+  /**
+   *  The objects held by transactions in PNF's m_set.  A transaction joins
+   *  the m_set only if none of its objects are already in the set, so
+   *  m_set members never share an entry, and leaving just clears one's own.
+   *
+   *  Hashed mode: a bitset of /width/ bits.  Object i is bit i % width, so
+   *  when every object id is below the width the set is exact; beyond that,
+   *  two transactions whose objects share a bit conflict even if they don't
+   *  share an object.
+   *
+   *  Exact mode: an open-addressed table of /width/ ownership words, each
+   *  holding (object id + 1) or 0.  Conflicts are exact.  A transaction that
+   *  would fill the table beyond 3/4 is treated as conflicting, so it waits
+   *  in the n_set until enough objects are released; the width must exceed
+   *  the number of objects any one transaction accesses.
+   *
+   *  Callers serialize join() and leave(); overlaps() may also be called
+   *  without the lock as a quick check, and then it may be wrong either way.
+   */
+  class PNFConflictSet
+  {
+      static const unsigned long BITS = 8 * sizeof(unsigned long);
+
+      unsigned long width;
+      bool exact;
+      volatile unsigned long* words;
+      unsigned long claimed;
+
+      unsigned long slot(unsigned long id) const
+      {
+          // width is a power of two in exact mode
+          return (id * 2654435761UL) & (width - 1);
+      }
+
+      /*** exact mode: index of /id/'s word, or -1 */
+      long find(unsigned long id) const
+      {
+          unsigned long s = slot(id);
+          for (unsigned long n = 0; n < width; n++) {
+              unsigned long v = words[s];
+              if (v == 0)
+                  return -1;
+              if (v == id + 1)
+                  return s;
+              s = (s + 1) & (width - 1);
+          }
+          return -1;
+      }
+
+      /*** exact mode: remove the id at word /s/ and close the gap */
+      void erase(unsigned long s)
+      {
+          unsigned long hole = s;
+          unsigned long i = s;
+          while (true) {
+              i = (i + 1) & (width - 1);
+              unsigned long v = words[i];
+              if (v == 0)
+                  break;
+              // move v back into the hole unless its home lies between the
+              // hole and where it is now
+              unsigned long home = slot(v - 1);
+              bool stays = (hole <= i) ? (hole < home && home <= i)
+                                       : (hole < home || home <= i);
+              if (!stays) {
+                  words[hole] = v;
+                  hole = i;
+              }
+          }
+          words[hole] = 0;
+      }
+
+    public:
+      PNFConflictSet() : width(0), exact(false), words(NULL), claimed(0)
+      {
+          configure(STM_PNF_SET_BITS, false);
+      }
+
+      /**
+       *  Resize the set and pick the mode.  Only call this while no PNF
+       *  transaction is running.  Exact mode rounds the width up to a power
+       *  of two.
+       */
+      void configure(unsigned long new_width, bool new_exact)
+      {
+          if (new_width == 0)
+              new_width = 1;
+          if (new_exact) {
+              unsigned long w = 1;
+              while (w < new_width)
+                  w <<= 1;
+              new_width = w;
+          }
+          unsigned long n = new_exact ? new_width
+                                      : (new_width + BITS - 1) / BITS;
+          delete[] words;
+          words = new unsigned long[n];
+          for (unsigned long i = 0; i < n; i++)
+              words[i] = 0;
+          width = new_width;
+          exact = new_exact;
+          claimed = 0;
+      }
+
+      unsigned long getWidth() const { return width; }
+      bool isExact() const { return exact; }
+
+      /*** translate an acc_obj list into /s/ */
+      void build(PNFObjectSet& s, const std::vector<double>& objs) const
+      {
+          s.masks.clear();
+          s.ids.clear();
+          for (unsigned int i = 0; i < objs.size(); i++)
+              s.ids.push_back((unsigned long)objs[i]);
+          std::sort(s.ids.begin(), s.ids.end());
+          s.ids.erase(std::unique(s.ids.begin(), s.ids.end()), s.ids.end());
+          if (exact)
+              return;
+
+          // fold the ids into one mask per word; sorting the words keeps
+          // the list short when ids wrap around the width
+          for (unsigned int i = 0; i < s.ids.size(); i++) {
+              unsigned long bit = s.ids[i] % width;
+              PNFObjectSet::Mask m = { bit / BITS, 1UL << (bit % BITS) };
+              s.masks.push_back(m);
+          }
+          s.ids.clear();
+          std::sort(s.masks.begin(), s.masks.end(), maskLess);
+          unsigned int out = 0;
+          for (unsigned int i = 0; i < s.masks.size(); i++) {
+              if (out > 0 && s.masks[out - 1].word == s.masks[i].word)
+                  s.masks[out - 1].bits |= s.masks[i].bits;
+              else
+                  s.masks[out++] = s.masks[i];
+          }
+          s.masks.resize(out);
+      }
+
+      /*** does any object of /s/ belong to a transaction in the m_set? */
+      bool overlaps(const PNFObjectSet& s) const
+      {
+          if (!exact) {
+              for (unsigned int i = 0; i < s.masks.size(); i++)
+                  if (words[s.masks[i].word] & s.masks[i].bits)
+                      return true;
+              return false;
+          }
+          // keep the table at most 3/4 full, except that a transaction
+          // may always have it to itself
+          unsigned long n = claimed + s.ids.size();
+          if ((n >= width) || ((claimed > 0) && (4 * n > 3 * width)))
+              return true;
+          for (unsigned int i = 0; i < s.ids.size(); i++)
+              if (find(s.ids[i]) >= 0)
+                  return true;
+          return false;
+      }
+
+      /*** add the objects of /s/; they must not overlap the set */
+      void join(const PNFObjectSet& s)
+      {
+          if (!exact) {
+              for (unsigned int i = 0; i < s.masks.size(); i++)
+                  words[s.masks[i].word] |= s.masks[i].bits;
+              return;
+          }
+          for (unsigned int i = 0; i < s.ids.size(); i++) {
+              unsigned long w = slot(s.ids[i]);
+              while (words[w] != 0)
+                  w = (w + 1) & (width - 1);
+              words[w] = s.ids[i] + 1;
+          }
+          claimed += s.ids.size();
+      }
+
+      /*** remove the objects of /s/, which joined earlier */
+      void leave(const PNFObjectSet& s)
+      {
+          if (!exact) {
+              for (unsigned int i = 0; i < s.masks.size(); i++)
+                  words[s.masks[i].word] &= ~s.masks[i].bits;
+              return;
+          }
+          for (unsigned int i = 0; i < s.ids.size(); i++) {
+              long w = find(s.ids[i]);
+              if (w >= 0) {
+                  erase(w);
+                  claimed--;
+              }
+          }
+      }
+
+    private:
+      static bool maskLess(const PNFObjectSet::Mask& a,
+                           const PNFObjectSet::Mask& b)
+      {
+          return a.word < b.word;
+      }
+  };
+} // namespace stm
+
+#endif // __PNFOBJECTSET_H__
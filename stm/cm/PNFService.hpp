@@ -0,0 +1,229 @@
+#ifndef __PNFSERVICE_H__
+#define __PNFSERVICE_H__
+
+#include <time.h>
+#include <stddef.h>
+
+namespace stm
+{
+  class ContentionManager;
+
+  /**
+   *  A request from a PNF transaction to the pnf_main service.  Each
+   *  ContentionManager embeds its own event, and a transaction has at most
+   *  one request outstanding, so posting never allocates.
+   */
+  struct PNFEvent
+  {
+      enum Kind { RELEASED, COMMITTED };
+
+      Kind               kind;
+      ContentionManager* cm;
+      PNFEvent* volatile next;
+  };
+
+  /**
+   *  Multi-producer, single-consumer event queue.  Producers push onto a
+   *  Treiber stack with one CAS; the service takes the whole stack with one
+   *  swap and reverses it, so it sees events in the order they were posted
+   *  and never contends with producers on a per-event basis.
+   */
+  class PNFEventQueue
+  {
+      PNFEvent* volatile head;
+
+    public:
+      PNFEventQueue() : head(NULL) { }
+
+      /*** returns true if the queue was empty before the push */
+      bool push(PNFEvent* e)
+      {
+          PNFEvent* old;
+          do {
+              old = head;
+              e->next = old;
+          } while (!__sync_bool_compare_and_swap(&head, old, e));
+          return old == NULL;
+      }
+
+      bool empty() const { return head == NULL; }
+
+      /*** take every posted event, oldest first */
+      PNFEvent* takeAll()
+      {
+          PNFEvent* e = __sync_lock_test_and_set(&head, (PNFEvent*)NULL);
+          PNFEvent* fifo = NULL;
+          while (e) {
+              PNFEvent* n = e->next;
+              e->next = fifo;
+              fifo = e;
+              e = n;
+          }
+          return fifo;
+      }
+  };
+
+  /**
+   *  A transaction waiting in the n_set.  key points at the transaction's
+   *  time_param (its deadline or period); seq breaks ties in arrival order,
+   *  which is what the old sorted-vector n_set did.
+   */
+  struct PNFHeapNode
+  {
+      PNFHeapNode*           child;
+      PNFHeapNode*           sibling;
+      PNFHeapNode*           prev;    // parent if leftmost child, else left sibling
+      const struct timespec* key;
+      unsigned long          seq;
+      ContentionManager*     cm;
+  };
+
+  /**
+   *  The n_set as a pairing heap ordered by time_param, earliest first.
+   *  insert() is O(1), pop() and remove() are O(log n) amortized, against
+   *  O(n) insertion and removal for the sorted vector.  Only the pnf_main
+   *  service touches it, so it needs no synchronization.
+   */
+  class PNFWaitHeap
+  {
+      PNFHeapNode*  root;
+      unsigned long count;
+      unsigned long next_seq;
+
+      static bool before(const PNFHeapNode* a, const PNFHeapNode* b)
+      {
+          if (a->key->tv_sec != b->key->tv_sec)
+              return a->key->tv_sec < b->key->tv_sec;
+          if (a->key->tv_nsec != b->key->tv_nsec)
+              return a->key->tv_nsec < b->key->tv_nsec;
+          return a->seq < b->seq;
+      }
+
+      /*** link two detached heaps, returning the new root */
+      static PNFHeapNode* meld(PNFHeapNode* a, PNFHeapNode* b)
+      {
+          if (!a)
+              return b;
+          if (!b)
+              return a;
+          if (before(b, a)) {
+              PNFHeapNode* t = a;
+              a = b;
+              b = t;
+          }
+          b->prev = a;
+          b->sibling = a->child;
+          if (a->child)
+              a->child->prev = b;
+          a->child = b;
+          a->sibling = NULL;
+          a->prev = NULL;
+          return a;
+      }
+
+      /*** two-pass pairing of a sibling list; iterative, so deep lists are fine */
+      static PNFHeapNode* combine(PNFHeapNode* first)
+      {
+          if (!first)
+              return NULL;
+          // pass 1: meld pairs left to right, chaining the results through
+          // their (now unused) prev pointers in reverse order
+          PNFHeapNode* pairs = NULL;
+          while (first) {
+              PNFHeapNode* a = first;
+              PNFHeapNode* b = a->sibling;
+              first = b ? b->sibling : NULL;
+              a->sibling = a->prev = NULL;
+              if (b)
+                  b->sibling = b->prev = NULL;
+              PNFHeapNode* m = meld(a, b);
+              m->prev = pairs;
+              pairs = m;
+          }
+          // pass 2: meld right to left
+          PNFHeapNode* result = pairs;
+          pairs = pairs->prev;
+          result->prev = NULL;
+          while (pairs) {
+              PNFHeapNode* n = pairs->prev;
+              pairs->prev = NULL;
+              result = meld(pairs, result);
+              pairs = n;
+          }
+          return result;
+      }
+
+    public:
+      PNFWaitHeap() : root(NULL), count(0), next_seq(0) { }
+
+      bool empty() const { return root == NULL; }
+      unsigned long size() const { return count; }
+
+      void insert(PNFHeapNode* n, ContentionManager* cm,
+                  const struct timespec* key)
+      {
+          n->child = n->sibling = n->prev = NULL;
+          n->key = key;
+          n->seq = next_seq++;
+          n->cm = cm;
+          root = meld(root, n);
+          count++;
+      }
+
+      /*** put back a node taken by pop(), keeping its place among equals */
+      void reinsert(PNFHeapNode* n)
+      {
+          n->child = n->sibling = n->prev = NULL;
+          root = meld(root, n);
+          count++;
+      }
+
+      /*** remove and return the earliest node, or NULL */
+      PNFHeapNode* pop()
+      {
+          PNFHeapNode* top = root;
+          if (!top)
+              return NULL;
+          root = combine(top->child);
+          top->child = NULL;
+          count--;
+          return top;
+      }
+
+      /*** remove /n/, which must be in the heap */
+      void remove(PNFHeapNode* n)
+      {
+          if (n == root) {
+              pop();
+              return;
+          }
+          // unlink n from its parent's child list
+          if (n->prev->child == n)
+              n->prev->child = n->sibling;
+          else
+              n->prev->sibling = n->sibling;
+          if (n->sibling)
+              n->sibling->prev = n->prev;
+          n->sibling = n->prev = NULL;
+          root = meld(root, combine(n->child));
+          n->child = NULL;
+          count--;
+      }
+  };
+
+  /**
+   *  Counters kept by the pnf_main service.  events is requests served,
+   *  parks is times the service went to sleep for lack of work, scans is
+   *  passes over the n_set after a commit, and cpu_ns is the service
+   *  thread's CPU time, so its cost can be compared to the old busy loop.
+   */
+  struct PNFServiceStats
+  {
+      volatile unsigned long long events;
+      volatile unsigned long long parks;
+      volatile unsigned long long scans;
+      volatile unsigned long long cpu_ns;
+  };
+} // namespace stm
+
+#endif // __PNFSERVICE_H__
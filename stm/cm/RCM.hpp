@@ -120,15 +120,11 @@ inline stm::ConflictResolutions
 stm::RCM::shouldAbort(ContentionManager* enemy)
 {
     RCM* t=static_cast<RCM*>(enemy);
-    timespec* other_period=t->GetPeriod();
-    if(time_param.tv_sec < other_period->tv_sec){
-	return AbortOther;
-    }
-    else if(time_param.tv_sec == other_period->tv_sec && time_param.tv_nsec < other_period->tv_nsec){
+    if(time_key < t->time_key){
 	return AbortOther;
     }
     //The following case needs more restrict criteria
-    else if(time_param.tv_sec==other_period->tv_sec && time_param.tv_nsec==other_period->tv_nsec){
+    else if(time_key == t->time_key){
         return AbortOther;
     }
 /*
@@ -0,0 +1,85 @@
+#ifndef __RTTASK_H__
+#define __RTTASK_H__
+
+#include <time.h>
+#include <vector>
+#include <rstm_hlp.hpp>
+#include "CMClock.hpp"
+
+namespace stm
+{
+  /**
+   *  Everything the real-time CMs need to know about the task running a
+   *  transaction: its chronos scheduling segment (FBLT), its deadline or
+   *  period (ECM, RCM), length and psy (LCM, FBLT), abort budget (FBLT)
+   *  and the objects its transactions access (PNF).
+   *
+   *  A task registers one RTTask with stm::init() (or passes it to each
+   *  BEGIN_RT_TRANSACTION), and transactions refer to it by pointer.  The
+   *  CM copies the task in only when it is a different task, or when the
+   *  task has called touch() since the last copy; retries copy nothing.
+   *  So after changing fields directly, call touch(); the setters below do
+   *  it themselves.  eta and due are per-job values that every new
+   *  transaction reads, so they can change without touch().
+   */
+  struct RTTask
+  {
+      int              run_prio;     // chronos priority outside the m_set
+      int              end_prio;
+      int              util;
+      struct timespec* deadline;     // chronos segment deadline and period
+      struct timespec* period;
+      unsigned long    unlocked;     // execution time outside / inside
+      unsigned long    locked;       // atomic sections
+      struct timespec  time_param;   // deadline for ECM, period for RCM
+      unsigned long    length;       // atomic section length (us); 0 keeps the CM's
+      double           psy;          // LCM/FBLT alpha threshold; with length
+      int              eta;          // aborts before FBLT joins the m_set, per Tx
+      cm_ticks_t       due;          // current job's deadline (CMClock ticks), 0 if
+                                     // none; read for every new Tx, like eta
+      std::vector<double> objects;   // objects its transactions access
+      int              th;           // calling thread
+      unsigned long    version;      // changed by touch()
+
+      RTTask()
+          : run_prio(0), end_prio(0), util(0), deadline(NULL), period(NULL),
+            unlocked(0), locked(0), length(0), psy(0), eta(-1), due(0), th(0),
+            version(0)
+      {
+          time_param.tv_sec = 0;
+          time_param.tv_nsec = 0;
+      }
+
+      /*** fields were changed; the next transaction's CM must reload them */
+      void touch() { version++; }
+
+      void setObjects(const std::vector<double>& objs)
+      {
+          objects.assign(objs.begin(), objs.end());
+          touch();
+      }
+
+      void setTimeParam(const struct timespec& ts)
+      {
+          time_param = ts;
+          touch();
+      }
+
+      /*** take the parameters of the old void* task_in_param interface */
+      void set(const struct task_in_param& p)
+      {
+          run_prio = p.task_run_prio;
+          end_prio = p.task_end_prio;
+          util = p.task_util;
+          deadline = p.task_deadline;
+          period = p.task_period;
+          unlocked = p.task_unlocked;
+          locked = p.task_locked;
+          time_param = *p.time_param;
+          eta = p.gen_eta;
+          touch();
+      }
+  };
+} // namespace stm
+
+#endif // __RTTASK_H__
@@ -36,7 +36,7 @@
 #define __REINCARNATE_H__
 
 #include "ContentionManager.hpp"
-#include "../support/atomic_ops.h"
+#include "TimestampAllocator.hpp"
 
 #ifdef _MSC_VER
 #include "../../alt-license/rand_r.h"
@@ -58,7 +58,8 @@ namespace stm
   {
       unsigned long timestamp; // For priority
 
-      static volatile unsigned long timeCounter;
+      static TimestampSource timestamps;
+      TimestampRange         range;
 
       enum Backoff {
           MIN_BACKOFF = 7,
@@ -114,7 +115,7 @@ namespace stm
       virtual void onBeginTransaction()
       {
           tries = 0;
-          timestamp = fai(&timeCounter);
+          timestamp = range.take(timestamps);
       }
 
       virtual ConflictResolutions onRAW(ContentionManager* e)
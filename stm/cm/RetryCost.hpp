@@ -0,0 +1,131 @@
+#ifndef __RETRYCOST_H__
+#define __RETRYCOST_H__
+
+#include <stddef.h>
+#include "CMClock.hpp"
+
+namespace stm
+{
+  /**
+   *  What a transaction of one type has cost in retries lately:
+   *  exponentially weighted moving averages of its aborts and of the time
+   *  it spent in aborted attempts (ns), per committed transaction.
+   */
+  struct RetryEstimate
+  {
+      double        aborts;
+      double        abort_ns;
+      unsigned long samples;
+
+      /*** mean cost of one aborted attempt, or 0 with no aborts seen */
+      double nsPerAbort() const
+      {
+          return (aborts > 0) ? abort_ns / aborts : 0;
+      }
+  };
+
+  /**
+   *  Retry-cost estimates kept by each contention manager, one per
+   *  transaction type.  The type is the RTTask the transaction belongs to
+   *  (NULL for transactions begun without one).  A handful of types is
+   *  the norm per thread, so the table is small and direct-mapped; a
+   *  collision restarts the estimate.  Each new sample has weight
+   *  1/2^SHIFT, i.e. 1/8.
+   */
+  class RetryCostTable
+  {
+      enum { SIZE = 8, SHIFT = 3 };
+
+      struct Entry
+      {
+          const void*   key;
+          RetryEstimate est;
+      };
+
+      Entry entries[SIZE];
+
+      Entry& slot(const void* key)
+      {
+          return entries[((unsigned long)key >> 6) % SIZE];
+      }
+
+    public:
+      RetryCostTable()
+      {
+          for (int i = 0; i < SIZE; i++) {
+              entries[i].key = NULL;
+              entries[i].est.samples = 0;
+          }
+      }
+
+      /*** a transaction of type /key/ committed after /aborts/ aborts costing /ns/ */
+      void sample(const void* key, unsigned long aborts, unsigned long long ns)
+      {
+          Entry& e = slot(key);
+          if ((e.key != key) || (e.est.samples == 0)) {
+              e.key = key;
+              e.est.aborts = aborts;
+              e.est.abort_ns = ns;
+              e.est.samples = 1;
+              return;
+          }
+          const double w = 1.0 / (1 << SHIFT);
+          e.est.aborts += w * (aborts - e.est.aborts);
+          e.est.abort_ns += w * ((double)ns - e.est.abort_ns);
+          e.est.samples++;
+      }
+
+      /*** the estimate for /key/, or NULL if it has none yet */
+      const RetryEstimate* find(const void* key) const
+      {
+          const Entry& e = entries[((unsigned long)key >> 6) % SIZE];
+          return ((e.key == key) && e.est.samples) ? &e.est : NULL;
+      }
+  };
+
+  /**
+   *  How an adaptive CM should set a new transaction's eta and psy so that
+   *  it finishes by /due/ (CMClock ticks), given its length (us), the
+   *  task's own eta and psy, and its retry-cost estimate (may be NULL).
+   *
+   *  slack is the time left once the transaction has run once.  The
+   *  transaction may afford as many aborts as slack holds aborted attempts
+   *  of the usual cost, so eta is cut to that (and to 0, joining FBLT's
+   *  m_set at once, when there is no slack).  psy moves from the task's
+   *  value toward 1 in proportion to how much of the slack the expected
+   *  retries would use up: a psy nearer 1 shrinks the alpha an enemy gets,
+   *  so fewer enemies that started earlier are let finish first.
+   */
+  inline void retryAdvice(const RetryEstimate* est, cm_ticks_t now,
+                          cm_ticks_t due, unsigned long length,
+                          int base_eta, double base_psy,
+                          int& eta, double& psy)
+  {
+      eta = base_eta;
+      psy = base_psy;
+      if (!due)
+          return;
+      double slack = (due > now) ? (double)CMClock::to_ns(due - now) : 0;
+      slack -= length * 1000.0;
+      if (slack <= 0) {
+          eta = 0;
+          psy = (base_psy < 0.99) ? 0.99 : base_psy;
+          return;
+      }
+      if (!est)
+          return;
+      double per_abort = est->nsPerAbort();
+      if (per_abort > 0) {
+          double affordable = slack / per_abort;
+          if ((affordable < 1e9) && ((base_eta < 0) || (affordable < base_eta)))
+              eta = (int)affordable;
+      }
+      double pressure = est->abort_ns / slack;
+      if (pressure > 1)
+          pressure = 1;
+      if (base_psy < 0.99)
+          psy = base_psy + (0.99 - base_psy) * pressure;
+  }
+} // namespace stm
+
+#endif // __RETRYCOST_H__
@@ -36,7 +36,7 @@
 #define __SERIALIZER_H__
 
 #include "ContentionManager.hpp"
-#include "../support/atomic_ops.h"
+#include "TimestampAllocator.hpp"
 
 namespace stm
 {
@@ -49,7 +49,8 @@ namespace stm
     private:
       unsigned long timestamp; // For priority
 
-      static volatile unsigned long timeCounter;
+      static TimestampSource timestamps;
+      TimestampRange         range;
 
       ConflictResolutions shouldAbort(ContentionManager* enemy)
       {
@@ -64,7 +65,7 @@ namespace stm
       Serializer() { }
       virtual void onBeginTransaction()
       {
-          timestamp = fai(&timeCounter);
+          timestamp = range.take(timestamps);
       }
 
       virtual ConflictResolutions onRAW(ContentionManager* e)
@@ -0,0 +1,83 @@
+#ifndef __TIMESTAMPALLOCATOR_H__
+#define __TIMESTAMPALLOCATOR_H__
+
+#include "../support/atomic_ops.h"
+
+/**
+ *  Timestamps a thread takes from the shared counter at a time.  1 gives
+ *  back the old behavior, one fetch-and-increment per transaction.
+ */
+#ifndef STM_CM_TS_BATCH
+#define STM_CM_TS_BATCH 32
+#endif
+
+namespace stm
+{
+  /**
+   *  The shared side of the timestamps used by Greedy, Serializer and
+   *  Reincarnate: a counter on a cache line of its own, from which each
+   *  thread takes a range of /batch/ timestamps at once.  With 64 threads
+   *  beginning transactions, a per-transaction fai on one word made that
+   *  word's line the busiest in the program; with ranges it is written
+   *  once per /batch/ transactions, and otherwise only read.
+   */
+  class TimestampSource
+  {
+      char pad_before[64];
+      volatile unsigned long counter;
+      int batch;
+      char pad_after[64 - sizeof(unsigned long) - sizeof(int)];
+
+    public:
+      TimestampSource(int b = STM_CM_TS_BATCH)
+          : counter(0), batch(b > 0 ? b : 1) { }
+
+      int batchSize() const { return batch; }
+
+      /*** the first timestamp no thread has taken yet */
+      unsigned long frontier() const { return counter; }
+
+      /*** reserve the next /batch/ timestamps, returning the first */
+      unsigned long grab() { return faa(&counter, batch); }
+  };
+
+  /**
+   *  One thread's current range from a TimestampSource.
+   *
+   *  Timestamps stay unique, and each thread's increase, as before.  What
+   *  ranges give up is that a later begin always gets a larger timestamp:
+   *  a thread still working through an old range hands out values below
+   *  ones other threads already hold.  take() bounds that: once the
+   *  frontier has moved a whole batch past the thread's next value, the
+   *  rest of its range is dropped and it takes a fresh one.  So no
+   *  timestamp is handed out once the frontier is more than a batch past
+   *  it, and a transaction that keeps its timestamp (as Greedy's do across
+   *  aborts) is older than every transaction begun after the frontier
+   *  moves two batches on.  That is the property the three CMs
+   *  rely on for progress; the inversions left are among transactions
+   *  that began within a couple of batches of each other, which are
+   *  concurrent anyway.
+   *
+   *  Reading the frontier is a read of a line that changes once per
+   *  batch, so it is nearly always a cache hit.
+   */
+  class TimestampRange
+  {
+      unsigned long next;
+      unsigned long end;
+
+    public:
+      TimestampRange() : next(0), end(0) { }
+
+      unsigned long take(TimestampSource& src)
+      {
+          if ((next == end) || (next + src.batchSize() < src.frontier())) {
+              next = src.grab();
+              end = next + src.batchSize();
+          }
+          return next++;
+      }
+  };
+} // namespace stm
+
+#endif // __TIMESTAMPALLOCATOR_H__
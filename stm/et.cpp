@@ -48,8 +48,8 @@ template <> LOCAL_POINTER_ANNOTATION ETThread*
 ThreadLocalPointer<ETThread>::thr_local_key = NULL;
 #endif
 
-/*** Provide backing for the global timestamp */
-volatile unsigned long ETThread::timestamp = 0;
+/*** Provide backing for the global time base */
+TimeBase::Global TimeBase::globals;
 
 /*** Provide backing for the global inevitability metadata */
 InevPolicy::Global InevPolicy::globals;
@@ -104,8 +104,7 @@ ETThread::ETThread(string cm_type, string validation)
 }
 
 /*** Provide backing for the set of orecs (locks) */
-volatile OrecWBTxThread::orec_t
-OrecWBTxThread::orecs[OrecWBTxThread::NUM_STRIPES] = {{{0}}};
+OrecWBTxThread::OrecTable OrecWBTxThread::table = STM_OREC_TABLE_DEFAULT;
 
 /*** Provide backing for the allocator */
 unsigned long
@@ -63,23 +63,23 @@
 #include "support/WBMMPolicy.hpp"
 #include "support/Inevitability.hpp"
 #include "support/Privatization.hpp"
+#include "support/TimeBase.hpp"
+
+#if defined(STM_TIME_VECTOR)
+#error "ET extends its start time, which needs a scalar time base"
+#endif
 
 namespace stm {
 
 /*** Everything about this STM is encapsulated in its Descriptor */
 class ETThread : public OrecWBTxThread {
-  /*** STATIC FIELD DEFINITIONS ***/
-
-  /*** The global timestamp */
-  static volatile unsigned long timestamp;
-
   /*** PER-INSTANCE FIELD DEFINITIONS */
 
-  /*** for caching the counter start time */
-  unsigned start_time;
+  /*** start time, and the time base it came from (see TimeBase.hpp) */
+  TimeBase time;
 
   /*** for caching the counter end time */
-  unsigned end_time;
+  unsigned long end_time;
 
   /*** all of the lists of metadata that must be tracked */
   RedoLog     redolog;
@@ -136,7 +136,7 @@ class ETThread : public OrecWBTxThread {
       owner_version_t ovt;
       ovt.all = (*i)->v.all;
       // if unlocked and newer than start time, abort
-      if (!ovt.version.lock && (ovt.version.num > start_time))
+      if (!ovt.version.lock && time.newer(ovt.version.num))
         abort();
       // if locked and not by me, abort
       else if (ovt.version.lock && (ovt.all != my_lock_word.all))
@@ -155,7 +155,7 @@ class ETThread : public OrecWBTxThread {
       ovt.all = (*i)->v.all;
       // abort if locked, or if unlocked but the timestamp is newer
       // than my start time
-      if (ovt.version.lock || (ovt.version.num > start_time))
+      if (ovt.version.lock || time.newer(ovt.version.num))
         abort();
     }
   }
@@ -175,7 +175,7 @@ class ETThread : public OrecWBTxThread {
       // reads.  Since most writes are also reads, we'll just abort under this
       // condition.  This can introduce false conflicts
       if (!ovt.version.lock) {
-        if (ovt.version.num > start_time)
+        if (time.newer(ovt.version.num))
           abort();
         // NB: if we can't lock the location, we could call CM instead of just
         //     aborting
@@ -245,11 +245,9 @@ class ETThread : public OrecWBTxThread {
     }
 
     // if we bumped a version number to higher than the timestamp, we need to
-    // increment the timestamp or else this location could become permanently
-    // unreadable
-    unsigned ts = timestamp;
-    if (max > ts)
-      bool_cas(&timestamp, ts, ts+1);
+    // move the timestamp up to it or else this location could become
+    // permanently unreadable
+    TimeBase::advance(max);
   }
 
   /*** commit memops and release inevitability */
@@ -367,10 +365,10 @@ class ETThread : public OrecWBTxThread {
         continue;
       }
       // if this location is too new, validate
-      else if (ovt.version.num > start_time) {
-        unsigned newts = timestamp;
+      else if (time.newer(ovt.version.num)) {
+        unsigned long newts = time.now();
         validate();
-        start_time = newts;
+        time.extend(newts);
         continue;
       }
 
@@ -427,10 +425,10 @@ class ETThread : public OrecWBTxThread {
         continue;
       }
       // if this location is too new, scale forward
-      else if (ovt.version.num > start_time) {
-        unsigned newts = timestamp;
+      else if (time.newer(ovt.version.num)) {
+        unsigned long newts = time.now();
         validate();
-        start_time = newts;
+        time.extend(newts);
         continue;
       }
 
@@ -489,10 +487,10 @@ class ETThread : public OrecWBTxThread {
         continue;
       }
       // if this location is too new, scale forward
-      else if (ovt.version.num > start_time) {
-        unsigned newts = timestamp;
+      else if (time.newer(ovt.version.num)) {
+        unsigned long newts = time.now();
         validate_fast(); // faster, because we don't hold locks
-        start_time = newts;
+        time.extend(newts);
         continue;
       }
 
@@ -528,12 +526,12 @@ class ETThread : public OrecWBTxThread {
 
       // if orec free, lock it and put it in lock set
       if (!ovt.version.lock) {
-        if (ovt.version.num > start_time) {
+        if (time.newer(ovt.version.num)) {
           // orec too new.  If we are valid, change our start time to the
           // current timestamp.  Otherwise abort
-          unsigned newts = timestamp;
+          unsigned long newts = time.now();
           validate();
-          start_time = newts;
+          time.extend(newts);
           continue;
         }
 
@@ -625,7 +623,7 @@ class ETThread : public OrecWBTxThread {
     priv.onBeginTx();
     inev.onBeginTx();
 
-    start_time = timestamp;
+    time.begin();
     end_time = 0; // so that we know if we need to get a timestamp in
     // order to safely call free()
     // notify CM
@@ -667,11 +665,12 @@ class ETThread : public OrecWBTxThread {
     if (mode == LazyLazy)
       acquireLocks();
 
-    // we're a writer, so increment the global timestamp
-    end_time = 1 + fai(&timestamp);
+    // we're a writer, so get a commit time
+    bool quiet;
+    end_time = time.commit(quiet);
 
     // skip validation if nobody else committed
-    if (end_time != (start_time + 1))
+    if (!quiet)
       validate();
 
     // set status to committed, abort on failure
@@ -109,8 +109,7 @@ FairThread::FairThread(string cm_type)
 }
 
 /*** Provide backing for the set of orecs (locks) */
-volatile OrecWBTxThread::orec_t
-OrecWBTxThread::orecs[OrecWBTxThread::NUM_STRIPES] = {{{0}}};
+OrecWBTxThread::OrecTable OrecWBTxThread::table = STM_OREC_TABLE_DEFAULT;
 
 /*** Provide backing for the allocator */
 unsigned long
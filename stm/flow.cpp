@@ -106,8 +106,7 @@ FlowThread::FlowThread()
 }
 
 /*** Provide backing for the set of orecs (locks) */
-volatile OrecWBTxThread::orec_t
-OrecWBTxThread::orecs[OrecWBTxThread::NUM_STRIPES] = {{{0}}};
+OrecWBTxThread::OrecTable OrecWBTxThread::table = STM_OREC_TABLE_DEFAULT;
 
 /*** Provide backing for the allocator */
 unsigned long
@@ -54,8 +54,11 @@ ThreadLocalPointer<LLTThread>::thr_local_key = NULL;
 volatile unsigned long LLTThread::throw_lock = 0;
 #endif
 
-/*** Provide backing for the global timestamp */
-volatile unsigned long LLTThread::timestamp = 0;
+/*** Provide backing for the global time base */
+TimeBase::Global TimeBase::globals;
+
+/*** Provide backing for the read-set summary counts */
+ReadSetPolicy::Global ReadSetPolicy::globals;
 
 /*** Inevitability token */
 volatile unsigned long LLTThread::inev_token = 0;
@@ -90,8 +93,12 @@ void LLTThread::dumpstats(unsigned long i)
        << "; Commits: "  << num_commits
        << "; Aborts: "   << num_aborts
        << "; Retrys: "   << num_retrys
-       << "; Restarts: " << num_restarts
-       << endl;
+       << "; Restarts: " << num_restarts;
+#if !defined(STM_READSET_LIST)
+  cout << "; Duplicate reads: " << readset.dropped
+       << "; Validations skipped: " << readset.skipped;
+#endif
+  cout << endl;
 
   LWSYNC;
   mtx = 0;
@@ -131,8 +138,7 @@ LLTThread::LLTThread()
 }
 
 /*** Provide backing for the set of orecs (locks) */
-volatile OrecWBTxThread::orec_t
-OrecWBTxThread::orecs[OrecWBTxThread::NUM_STRIPES] = {{{0}}};
+OrecWBTxThread::OrecTable OrecWBTxThread::table = STM_OREC_TABLE_DEFAULT;
 
 /*** Provide backing for the allocator */
 unsigned long
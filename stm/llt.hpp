@@ -49,6 +49,8 @@
 #include "support/ThreadLocalPointer.hpp"
 #include "support/WBMMPolicy.hpp"
 #include "support/Privatization.hpp"
+#include "support/TimeBase.hpp"
+#include "support/ReadSetFilter.hpp"
 
 // for some forms of inevitability
 #if defined(STM_INEV_BLOOM_SMALL) || defined(STM_INEV_BLOOM_MEDIUM) ||  \
@@ -103,16 +105,13 @@ class LLTThread : public OrecWBTxThread
   static padded_unsigned_t epoch[128];
 #endif
 
-  /*** The global timestamp */
-  static volatile unsigned long timestamp;
-
   /*** PER-INSTANCE FIELD DEFINITIONS ***/
 
-  // for caching the counter start time
-  unsigned start_time;
+  // start time, and the time base it came from (see TimeBase.hpp)
+  TimeBase time;
 
   // for caching the counter end time
-  unsigned end_time;
+  unsigned long end_time;
 
   // all of the lists of metadata that must be tracked
   RedoLog     writes;
@@ -120,6 +119,9 @@ class LLTThread : public OrecWBTxThread
   OrecList    locks;
   WBMMPolicy  allocator;
 
+  // duplicate filter and commit summary for reads (see ReadSetFilter.hpp)
+  ReadSetPolicy readset;
+
   // for limiting lookups in write set
   unsigned write_filter;
 
@@ -172,6 +174,9 @@ class LLTThread : public OrecWBTxThread
    * timestamps older than our start time, unless we locked those orecs.
    */
   void validate() {
+    // nothing to do if no orec we read from can have been locked since
+    if (readset.unchanged())
+      return;
     for (OrecList::iterator i = reads.begin(), e = reads.end(); i != e; ++i) {
       // read this orec
       owner_version_t ovt;
@@ -181,7 +186,7 @@ class LLTThread : public OrecWBTxThread
       ovt.version.reads = 0;
 #endif
       // if unlocked and newer than start time, it changed, so abort
-      if (!ovt.version.lock && (ovt.version.num > start_time))
+      if (!ovt.version.lock && time.newer(ovt.version.num))
         abort();
       // if locked and not by me, abort
       else if (ovt.version.lock && (ovt.all != my_lock_word.all))
@@ -201,7 +206,7 @@ class LLTThread : public OrecWBTxThread
       // if orec not locked, lock it and save old to orec.p
       if (!ovt.version.lock) {
         // abort if location changed after I started
-        if (ovt.version.num > start_time)
+        if (time.newer(ovt.version.num))
           abort();
 #if defined(STM_INEV_IRL)
         // abort if IRL bit set
@@ -214,6 +219,7 @@ class LLTThread : public OrecWBTxThread
         // save old version to o->p
         o->p.all = ovt.all;
         // remember that we hold this lock
+        readset.onLock(o - table.orecs);
         locks.insert((orec_t*)o);
       }
       // else if we don't hold the lock abort
@@ -258,7 +264,8 @@ class LLTThread : public OrecWBTxThread
 #else
     // if I have writes, get a commit time
     if (locks.size() != 0) {
-      end_time = 1 + fai(&timestamp);
+      bool quiet;
+      end_time = time.commit(quiet);
     }
 
 #if defined(STM_INEV_IRL)
@@ -345,6 +352,7 @@ class LLTThread : public OrecWBTxThread
   /*** reset lists and exit epochs */
   void common_cleanup() {
     reads.reset();
+    readset.reset();
     writes.reset();
     locks.reset();
 
@@ -563,7 +571,7 @@ class LLTThread : public OrecWBTxThread
     }
 #endif
 
-    start_time = timestamp;
+    time.begin();
     LWSYNC; // RBR between timestamp and any orecs
     end_time = 0; // so that we know if we need to get a timestamp in
     // order to safely call free()
@@ -669,11 +677,12 @@ class LLTThread : public OrecWBTxThread
           abort();
     }
 #endif
-    // increment the global timestamp if we have writes
-    end_time = 1 + fai(&timestamp);
+    // get a commit time, since we have writes
+    bool quiet;
+    end_time = time.commit(quiet);
 
     // skip validation if nobody else committed
-    if (end_time != (start_time + 1))
+    if (!quiet)
       validate();
 
     // set status to committed... don't need a cas for now.
@@ -805,7 +814,9 @@ class LLTThread : public OrecWBTxThread
 #endif
 
     // get the orec addr, read the orec's version#
-    volatile orec_t* o = get_orec((void*)addr); // cast away const addr
+    unsigned long idx = orec_index((void*)addr);
+    volatile orec_t* o = &table.orecs[idx];
+    readset.onRead(idx);
     owner_version_t ovt;
     ovt.all = o->v.all;
 
@@ -814,7 +825,7 @@ class LLTThread : public OrecWBTxThread
     ovt.version.reads = 0;
 #endif
     // abort if locked or too new
-    if (ovt.version.lock || (ovt.version.num > start_time))
+    if (ovt.version.lock || time.newer(ovt.version.num))
       abort();
 
     ISYNC;
@@ -835,8 +846,9 @@ class LLTThread : public OrecWBTxThread
     if (ovt2.all != ovt.all)
       abort();
 
-    // log orec, return value
-    reads.insert((orec_t*)o);
+    // log orec unless it is logged already, return value
+    if (!readset.logged(idx, (orec_t*)o, reads))
+      reads.insert((orec_t*)o);
     return tmp;
   }
 
@@ -994,6 +1006,7 @@ inline bool LLTThread::inev_write(void* addr)
     o->v.all = my_lock_word.all;
     o->p.all = ovt.all;
     // bookkeep the lock
+    readset.onLock(o - table.orecs);
     locks.insert(const_cast<orec_t*>(o)); // cast away volatile
     return true;
   }
@@ -1003,6 +1016,7 @@ inline bool LLTThread::inev_write(void* addr)
   o->v.all = my_lock_word.all;
   o->p.all = ovt.all;
   // remember the lock, return
+  readset.onLock(o - table.orecs);
   locks.insert(const_cast<orec_t*>(o)); // cast away volatile
   return true;
 #else
@@ -1017,6 +1031,7 @@ inline bool LLTThread::inev_write(void* addr)
     if (bool_cas(&o->v.all, ovt.all, my_lock_word.all)) {
       o->p.all = ovt.all;
       // log the acquire
+      readset.onLock(o - table.orecs);
       locks.insert(const_cast<orec_t*>(o)); // cast away volatile
       return true;
     }
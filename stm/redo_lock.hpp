@@ -38,7 +38,7 @@
 #include <string>
 #include "support/defs.hpp"
 #include "support/ThreadLocalPointer.hpp"
-#include "support/MiniVector.hpp"
+#include "support/SegmentLog.hpp"
 #include "support/ConflictDetector.hpp"
 #include "support/MMPolicy.hpp"
 #include "support/Inevitability.hpp"
@@ -234,9 +234,9 @@ class Descriptor {
       : shared(sh), version(ver), clone(cl), obj_size(s) { }
   };
 
-  typedef stm::MiniVector<ReadLogEntry> ReadLog;
-  typedef stm::MiniVector<EagerWriteLogEntry> EagerWriteLog;
-  typedef stm::MiniVector<LazyWriteLogEntry> LazyWriteLog;
+  typedef stm::SegmentLog<ReadLogEntry> ReadLog;
+  typedef stm::SegmentLog<EagerWriteLogEntry> EagerWriteLog;
+  typedef stm::SegmentLog<LazyWriteLogEntry> LazyWriteLog;
 
  public:
   /*** COMMITTED, ABORTED, or ACTIVE */
@@ -249,7 +249,7 @@ class Descriptor {
 #endif
 
   /** Wrapper for a contention manager. */
-  stm::HybridCMPolicy cm;
+  stm::DescriptorCMPolicy cm;
 
   /** Eager/lazy acquisition strategy flag. */
   const bool isLazy;
@@ -353,7 +353,8 @@ class Descriptor {
       this stores our local heuristic information. */
   stm::ValidationPolicy conflicts;
 
-  // logs
+  // logs, and the arena their segments come from
+  stm::LogArena logArena;
   ReadLog reads;
   EagerWriteLog eagerWrites;
   LazyWriteLog lazyWrites;
@@ -397,9 +398,10 @@ class Descriptor {
       isLazy((val != "invis-eager") && (val != "vis-eager")),
       mm(),                           // set up deferred reclamation
       conflicts(),                    // heap based bookkeeping fields
-      reads(64),
-      eagerWrites((isLazy) ? 0 : 64),
-      lazyWrites((isLazy) ? 64 : 0),
+      logArena(),
+      reads(logArena, 64),
+      eagerWrites(logArena, (isLazy) ? 0 : 64),
+      lazyWrites(logArena, (isLazy) ? 64 : 0),
       nesting_depth(0),
       num_commits(0), num_aborts(0)
   { }
@@ -1013,8 +1015,7 @@ class Descriptor {
    * write-set and clear out all of the clones that we have made.
    *
    * A side effect of this operation is that the log itself is cleared, which
-   * is a simple O(1) operation when using the default MiniVector<> log
-   * implementation.
+   * is a simple O(1) operation with the SegmentLog<> logs.
    */
   void clearEagerWrites() {
      for (EagerWriteLog::iterator i = eagerWrites.begin(),
@@ -1029,8 +1030,7 @@ class Descriptor {
    * all of the clones. This does that.
    *
    * A side effect of this operation is that the log itself is cleared, which
-   * is a simple O(1) operation when using the default MiniVector<> log
-   * implementation.
+   * is a simple O(1) operation with the SegmentLog<> logs.
    */
   void redoEagerWrites() {
     for (EagerWriteLog::iterator i = eagerWrites.begin(),
@@ -34,6 +34,7 @@
 
 
 #include <iostream>
+#include <new>
 using std::cout;
 using std::endl;
 
@@ -57,6 +58,19 @@ volatile unsigned long
 stm::GlobalCommitCounterValidationPolicy::global_counter = 0;
 #endif
 
+#ifdef STM_COMMIT_TIMESTAMP
+/*** ensure that the timestamp ValidationPolicy's clock is backed */
+volatile unsigned long
+stm::CommitTimestampValidationPolicy::timestamp = 0;
+#endif
+
+/*** back the list of transaction sites the acquire advisor has seen */
+stm::TxSite* volatile stm::AcquireAdvisor::sites = NULL;
+
+/*** back the snapshot counters for read-only transactions */
+volatile unsigned long rstm::Descriptor::commits_started = 0;
+volatile unsigned long rstm::Descriptor::commits_finished = 0;
+
 #ifdef STM_PRIV_NONBLOCKING
 /***  Provide backing for the privatization counter */
 volatile unsigned long rstm::privatizer_clock = 0;
@@ -81,7 +95,7 @@ void rstm::acquire_fence() { currentDescriptor->mm.waitForDominatingEpoch(); }
 void rstm::release_fence() { currentDescriptor->mm.waitForDominatingEpoch(); }
 
 /*** back the token manager for mapping Descriptors to vis reader bits */
-stm::TokenManager<Descriptor> rstm::readbits(32);
+stm::TokenManager<Descriptor> rstm::readbits(stm::VisReaderSet::MAX_READERS);
 
 // These are for MMPolicy's epoch
 unsigned long
@@ -89,6 +103,10 @@ stm::RADDMMPolicy::trans_nums[MAX_THREADS * CACHELINE_SIZE] = {0};
 
 volatile unsigned long stm::RADDMMPolicy::thread_count = 0;
 
+/*** back the global table of per-thread statistics */
+stm::TxStats* volatile stm::TxStats::registry[MAX_THREADS] = {0};
+volatile unsigned long stm::TxStats::registered = 0;
+
 void rstm::thr_shutdown(unsigned long i)
 {
   // we're not going to bother with making this nonblocking...
@@ -141,6 +159,13 @@ void rstm::thr_init(std::string cm_type, std::string validation,
   currentDescriptor.set(new Descriptor(cm_type, validation, use_static_cm,t_args));
 }
 
+void rstm::thr_init(std::string cm_type, std::string validation,
+                    bool use_static_cm,stm::RTTask* task)
+{
+  thr_init(cm_type, validation, use_static_cm);
+  currentDescriptor->rt_task = task;
+}
+
 void rstm::thr_shutdown_nodeb(unsigned long i)
 //This version to not print any data when shutting down
 {
@@ -156,13 +181,6 @@ void rstm::thr_shutdown_nodeb(unsigned long i)
 
 Object* Descriptor::openReadOnly(SharedHandle* const header) {
   // make sure all parameters meet our expectations
-//#if defined(STM_CHECKPOINT)
-	  jmp_buf _jmpbuf;
-	if(STM_CHECKPOINT){
-	  setjmp(_jmpbuf);
-	}
-//#endif
-
   if (!header)
     return NULL;
 
@@ -172,6 +190,9 @@ Object* Descriptor::openReadOnly(SharedHandle* const header) {
   if (inev.isInevitable())
     return header->m_payload;
 
+  if (snapshotMode)
+    return openSnapshot(header);
+
   verifySelf();
 
   // if we have a RW copy of this that we opened lazily, we must return it
@@ -212,13 +233,15 @@ Object* Descriptor::openReadOnly(SharedHandle* const header) {
 
         // continue unless we kill the owner; if kill the owner, use older
         // version
-        stm::ConflictResolutions r = cm.onRAW(owner->cm.getCM());
+        stm::ConflictResolutions r = decided(cm.onRAW(owner->cm.getCM()));
         if (r == stm::AbortSelf)
-          abort();
+          abort(stm::TxStats::ABORT_RAW);
+        if (r != stm::Wait)
+          owner->abort_cause = stm::TxStats::ABORT_RAW;
         if (r == stm::Wait ||
             !bool_cas(&(owner->tx_state), stm::ACTIVE, stm::ABORTED))
         {
-          cm.onContention();
+          backoff();
           verifySelf();
           continue;
         }
@@ -229,11 +252,18 @@ Object* Descriptor::openReadOnly(SharedHandle* const header) {
 
       // if current owner is aborted use cleanOnAbort
       if (ownerState == stm::ABORTED) {
+        // an object written in place isn't usable until its owner has
+        // undone its writes and restored the header itself
+        if (is_inplace(newer)) {
+          backoff();
+          verifySelf();
+          continue;
+        }
         if (!CleanOnAbort(header, snap, older)) {
           // if cleanup failed; if snap != older there is contention.
           // Otherwise, a like-minded tx did the cleanup for us
           if (header->m_payload != older) {
-            cm.onContention();
+            backoff();
             verifySelf();
             continue;
           }
@@ -252,7 +282,7 @@ Object* Descriptor::openReadOnly(SharedHandle* const header) {
           // cleanOnCommit failed; if payload != newer there is contention.
           // Otherwise someone did the cleanup for us
           if (header->m_payload != newer) {
-            cm.onContention();
+            backoff();
             verifySelf();
             continue;
           }
@@ -269,7 +299,7 @@ Object* Descriptor::openReadOnly(SharedHandle* const header) {
       // verify that the header of /this/ hasn't changed; if it changed, at
       // least one writer acquired /this/, and we may be incorrect
       if (newer != header->m_payload) {
-        abort();
+        abort(stm::TxStats::ABORT_VALIDATION);
       }
 
       // validate
@@ -277,7 +307,7 @@ Object* Descriptor::openReadOnly(SharedHandle* const header) {
     }
     else {
       // can cause duplicates if we don't use addValidateInvisRead()
-      if (conflicts.shouldValidate()) {
+      if (shouldValidate(header)) {
         if (conflicts.isValidatingInsertSafe()) {
           addValidateInvisRead(header, newer);
           verifyLazyWrites();
@@ -296,25 +326,57 @@ Object* Descriptor::openReadOnly(SharedHandle* const header) {
     // notify cm, update read count, and return
     cm.onOpenRead();
 
-    //#if defined(STM_CHECKPOINT)
-    if(STM_CHECKPOINT){
-        setjmp_buf.insert(cp_sh(header,&_jmpbuf));
-    }
-    //#endif
-
     return newer;
   } // end while (true)
 }
 
+/**
+ *  Open /header/ without logging it or installing ourselves as a reader.  The
+ *  committed version is the payload, unless a writer that hasn't committed
+ *  owns the object, in which case it is the version that writer cloned.
+ *  Either way it is only the version as of our snapshot if no writer has
+ *  begun to commit since, so check that last.
+ *
+ *  The owner's tx_state only speaks for /snap/ while the owner still owns
+ *  the header: a writer that committed, cleaned up and began its next
+ *  transaction reads as ACTIVE again, and its m_next is stale.  So reread
+ *  the payload after reading the state, and start over if it moved.
+ */
+Object* Descriptor::openSnapshot(SharedHandle* const header) {
+  Object* ver;
+  while (true) {
+    Object* snap = const_cast<Object*>(header->m_payload);
+    ver = get_data_ptr(snap);
+    assert(ver);
+    if (!is_owned(snap))
+      break;
+
+    const Descriptor* owner = const_cast<Descriptor*>(ver->m_owner);
+    unsigned long ownerState = owner->tx_state;
+    if (header->m_payload != snap)
+      continue;
+    if (ownerState != stm::COMMITTED) {
+      // an object written in place has no older copy to read
+      if (is_inplace(ver))
+        abort(stm::TxStats::ABORT_RAW);
+      ver = ver->m_next;
+      assert(ver);
+    }
+    break;
+  }
+  assert_not_deleted(ver);
+
+  if (commits_started != snapshot)
+    abort(stm::TxStats::ABORT_VALIDATION);
+
+  cm.onOpenRead();
+  return ver;
+}
+
 Object*
-Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
+Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize,
+                          bool* validateLater)
 {
-	//#if defined(STM_CHECKPOINT)
-	  jmp_buf _jmpbuf;
-	if(STM_CHECKPOINT){
-	  setjmp(_jmpbuf);
-	}
-	//#endif
   // make sure all parameters meet our expectations
   if (!header)
     return NULL;
@@ -326,6 +388,10 @@ Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
     return header->m_payload;
   }
 
+  // a read-only transaction that writes after all has to start over, logged
+  if (snapshotMode)
+    abandonSnapshot();
+
   // ensure this tx isn't aborted
   verifySelf();
 
@@ -369,12 +435,14 @@ Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
 
         // continue unless we kill the owner; if kill the owner, use older
         // version
-        stm::ConflictResolutions r = cm.onWAW(owner->cm.getCM());
+        stm::ConflictResolutions r = decided(cm.onWAW(owner->cm.getCM()));
         if (r == stm::AbortSelf)
-          abort();
+          abort(stm::TxStats::ABORT_WAW);
+        if (r != stm::Wait)
+          owner->abort_cause = stm::TxStats::ABORT_WAW;
         if (r == stm::Wait
             || !bool_cas(&(owner->tx_state), stm::ACTIVE, stm::ABORTED)) {
-          cm.onContention();
+          backoff();
           verifySelf();
           continue;
         }
@@ -386,13 +454,20 @@ Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
       // if current owner is aborted use cleanOnAbort if we are lazy, else just
       // plan on using older
       if (ownerState == stm::ABORTED) {
+        // an object written in place isn't usable until its owner has
+        // undone its writes and restored the header itself
+        if (is_inplace(newer)) {
+          backoff();
+          verifySelf();
+          continue;
+        }
         if (isLazy) {
           // if lazy, we must clean header:
           if (!CleanOnAbort(header, snap, older)) {
             // cleanup failed; if snap != older there is contention.
             // Otherwise, a like-minded tx did the cleanup for us
             if (header->m_payload != older) {
-              cm.onContention();
+              backoff();
               verifySelf();
               continue;
             }
@@ -414,7 +489,7 @@ Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
             // cleanOnCommit failed; if payload != newer there is contention.
             // Otherwise someone cleaned up for us
             if (header->m_payload != newer) {
-              cm.onContention();
+              backoff();
               verifySelf();
               continue;
             }
@@ -426,36 +501,79 @@ Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
     // EAGER: continue if we can't abort all visible readers
     bool canAbortAll = true;
     {
-      unsigned int index = 0;
-      unsigned int bits = header->m_readers;
-      while (bits) {
-        if (bits & 1) {
-          Descriptor* reader = readbits.lookup(index);
-          if (reader != this) {
-            // if can't abort this reader, return false
-            stm::ConflictResolutions r = cm.onWAR(reader->cm.getCM());
-            if (r == stm::AbortSelf)
-              abort();
-            if (r == stm::Wait) {
-              canAbortAll = false;
-              break;
-            }
+      for (int index = header->m_readers.next(0); index != -1;
+           index = header->m_readers.next(index + 1))
+      {
+        Descriptor* reader = readbits.lookup(index);
+        if (reader != this) {
+          // if can't abort this reader, return false
+          stm::ConflictResolutions r =
+            decided(cm.onWAR(reader->cm.getCM()));
+          if (r == stm::AbortSelf)
+            abort(stm::TxStats::ABORT_WAR);
+          if (r == stm::Wait) {
+            canAbortAll = false;
+            break;
           }
         }
-        bits >>= 1;
-        ++index;
       }
     }
 
-    if (!isLazy && !canAbortAll) {
-      cm.onContention();
+#if defined(STM_INPLACE_LARGE_OBJECTS)
+    // large objects (and anything already written in place) aren't cloned:
+    // acquire eagerly with an in-place version, and let the setters log the
+    // fields they overwrite
+    bool inPlace = (objsize >= STM_INPLACE_THRESHOLD) || is_inplace(newer);
+#else
+    bool inPlace = false;
+#endif
+
+    if ((!isLazy || inPlace) && !canAbortAll) {
+      backoff();
       verifySelf();
       continue;
     }
 
+#if defined(STM_INPLACE_LARGE_OBJECTS)
+    if (inPlace) {
+      // allocated outside mm.txAlloc(), so we decide when it is garbage
+      Object* new_version = ::new (stm::mm::txalloc(sizeof(InPlaceVersion)))
+        InPlaceVersion(get_data(newer), newer, this);
+      if (!SwapHeader(header, snap, set_lsb(new_version))) {
+        // no one else ever saw it
+        delete new_version;
+        backoff();
+        verifySelf();
+        continue;
+      }
+
+      // CAS succeeded: no one can read the fields until we're done, so abort
+      // visible readers before the first write.  Only in-place versions are
+      // garbage after we commit; the data object lives on.  Readers may hold
+      // ours if we abort, so it goes through the reclaimer then too.
+      mm.deleteOnAbort.insert(new_version);
+      abortVisibleReaders(header);
+      if (is_inplace(newer))
+        mm.deleteOnCommit.insert(newer);
+      eagerWrites.insert(eager_bookkeep_t(header, newer, new_version));
+
+      if (shouldValidate(header)) {
+        if (validateLater)
+          *validateLater = true;
+        else
+          validate();
+      }
+
+      verifySelf();
+      cm.onOpenWrite();
+      return new_version;
+    }
+#endif
+
     // clone the object and make me the owner of the new version NB: the clone
     // actually copies the vtable pointer, too
     Object* new_version = (Object*)memcpy(mm.txAlloc(objsize), newer, objsize);
+    stats.add(stm::TxStats::CLONE_BYTES, objsize);
 
     assert(new_version);
     // new_version->m_st = header; // NB: happens in the bitcopy
@@ -465,6 +583,7 @@ Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
     if (isLazy) {
       // LAZY: just add /this/ to my lazy writeset and mark the old version for
       // delete on commit
+      lazyIndex.insert(header, lazyWrites.size());
       lazyWrites.insert(lazy_bookkeep_t(header, newer, new_version));
       mm.deleteOnCommit.insert(newer);
     }
@@ -477,7 +596,7 @@ Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
         // something of a shame, because no one but us has ever seen this;
         // running it through the reclaimer wastes time.
         new_version = NULL;
-        cm.onContention();
+        backoff();
         verifySelf();
         continue;
       }
@@ -490,25 +609,53 @@ Descriptor::openReadWrite(SharedHandle* const header, const size_t objsize)
     }
 
     // Validate, notify cm, and return
-    if (conflicts.shouldValidate())
-      validate();
+    if (shouldValidate(header)) {
+      if (validateLater)
+        *validateLater = true;
+      else
+        validate();
+    }
 
     verifySelf();
     cm.onOpenWrite();
 
-    //#if defined(STM_CHECKPOINT)
-    if(STM_CHECKPOINT){
-    /**************** DEBUG 1 ST ********************/
-    //cout<<"openReadWrite checkpoint"<<endl;
-    /**************** DEBUG 1 END ************************/
-        setjmp_buf.insert(cp_sh(header,&_jmpbuf));
-    }
-    //#endif
-
     return new_version;
   } // end while (true)
 }
 
+void Descriptor::openWriteBatch(const size_t objsize)
+{
+  SharedHandle** headers = writeBatch.begin();
+  unsigned long n = writeBatch.size();
+
+  // start pulling every header into the cache before we need the first one
+  for (unsigned long i = 0; i < n; i++)
+    __builtin_prefetch(headers[i], 1);
+
+  // sort by address; batches are small, so insertion sort is fine
+  for (unsigned long i = 1; i < n; i++) {
+    SharedHandle* h = headers[i];
+    unsigned long j = i;
+    for (; j > 0 && headers[j - 1] > h; j--)
+      headers[j] = headers[j - 1];
+    headers[j] = h;
+  }
+
+  // empty the batch now, in case we abort part way through it; nothing
+  // below inserts into it, so /headers/ stays intact
+  writeBatch.reset();
+
+  // acquire in order, skipping duplicates, and validate once at the end
+  bool validateLater = false;
+  for (unsigned long i = 0; i < n; i++)
+    if (i == 0 || headers[i] != headers[i - 1])
+      openReadWrite(headers[i], objsize, &validateLater);
+
+  if (validateLater)
+    validate();
+  verifySelf();
+}
+
 Object* rstm::open_privatized(SharedHandle* const header) {
   if (!header)
     return NULL;
@@ -518,7 +665,7 @@ Object* rstm::open_privatized(SharedHandle* const header) {
 
   assert(!is_owned(snap));
 
-  return newer;
+  return get_data(newer);
 #else
   while (true) {
     // read the header of /this/ to a local, opportunistically get data ptr
@@ -558,8 +705,11 @@ Object* rstm::open_privatized(SharedHandle* const header) {
         ownerState = stm::ABORTED;
       }
 
-      // if current owner is aborted use cleanOnAbort
+      // if current owner is aborted use cleanOnAbort, unless the owner wrote
+      // in place and still has to undo its writes
       if (ownerState == stm::ABORTED) {
+        if (is_inplace(newer))
+          continue;
         if (!Descriptor::CleanOnAbort(header, snap, older)) {
           // if cleanup failed; if snap != older there is contention.
           // Otherwise, a like-minded tx did the cleanup for us
@@ -584,7 +734,7 @@ Object* rstm::open_privatized(SharedHandle* const header) {
 
     // we're going to use whatever is in newer from here on out
     assert(newer);
-    return newer;
+    return get_data(newer);
   } // end while (true)
 #endif
 }
@@ -601,6 +751,8 @@ void rstm::retry() {
   // we cannot be inevitable and call this!
   assert(!currentDescriptor->inev.isInevitable());
 
+  currentDescriptor->onRetry();
+
   currentDescriptor->retry();
 }
 
@@ -617,6 +769,7 @@ void rstm::Descriptor::retry() {
   // cleanup and just free the list
   cleanupEagerWrites(stm::ABORTED);
   lazyWrites.reset();
+  lazyIndex.reset();
 
   // uninstall visible readers, zero read sets
   cleanupVisReads();
@@ -630,11 +783,11 @@ void rstm::Descriptor::retry() {
 
   // sleep only if we didn't take a remote abort
   if (sleep_at_end) {
-    ++num_retrys;
+    stats.inc(stm::TxStats::RETRYS);
     retryImpl.endRetry(retryHandle);
   }
   else {
-    ++num_aborts;
+    countAbort();
     cm.onTxAborted();
   }
 
@@ -643,7 +796,7 @@ void rstm::Descriptor::retry() {
   throw stm::RollBack();
 #elif defined(STM_ROLLBACK_SETJMP)
   nesting_depth = 0;
-  longjmp(*((setjmp_buf.begin())->cp), 1);
+  longjmp(*setjmp_buf, 1);
 #endif
 }
 
@@ -683,6 +836,7 @@ void rstm::Descriptor::retry() {
       tx_state = stm::ABORTED;
 
   // now we can uninstall self as eager owner / vis reader
+  undoLog.undo();
   for (EagerWriteLog::iterator i = eagerWrites.begin(),
          e = eagerWrites.end(); i != e; ++i)
     CleanOnAbort(i->shared, i->write_version, i->read_version);
@@ -698,6 +852,7 @@ void rstm::Descriptor::retry() {
 
   // now we can reset all lists
   lazyWrites.reset();
+  lazyIndex.reset();
   eagerWrites.reset();
   visibleReads.reset();
   invisibleReads.reset();
@@ -713,12 +868,12 @@ void rstm::Descriptor::retry() {
   if (!sleep_at_end) {
     retryImpl.cancelRetry(retryHandle);
     cm.onTxAborted();
-    ++num_aborts;
+    countAbort();
   }
   else {
     // validation was OK.
     retryImpl.endRetry(retryHandle);
-    ++num_retrys;
+    stats.inc(stm::TxStats::RETRYS);
   }
 
   // Unwind
@@ -741,6 +896,7 @@ void rstm::Descriptor::retry() {
   // notion of read/write sets.
 
   // eager writes: install as retry on each, then clean on abort each
+  undoLog.undo();
   for (EagerWriteLog::iterator i = eagerWrites.begin(),
          e = eagerWrites.end(); i != e; ++i) {
     retryHandle->insert(i->shared);
@@ -776,6 +932,7 @@ void rstm::Descriptor::retry() {
 
   // now we can reset all lists
   lazyWrites.reset();
+  lazyIndex.reset();
   eagerWrites.reset();
   visibleReads.reset();
   invisibleReads.reset();
@@ -787,12 +944,12 @@ void rstm::Descriptor::retry() {
   if (!sleep_at_end) {
     retryImpl.cancelRetry(retryHandle);
     cm.onTxAborted();
-    ++num_aborts;
+    countAbort();
   }
   else {
     // validation was OK.
     retryImpl.endRetry(retryHandle);
-    ++num_retrys;
+    stats.inc(stm::TxStats::RETRYS);
   }
 
   mm.onTxEnd(stm::ABORTED);
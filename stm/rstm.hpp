@@ -51,14 +51,20 @@
 #include "support/defs.hpp"
 #include "support/ThreadLocalPointer.hpp"
 #include "support/MiniVector.hpp"
+#include "support/SegmentLog.hpp"
+#include "support/LogIndex.hpp"
+#include "support/UndoLog.hpp"
 #include "support/ConflictDetector.hpp"
 #include "support/MMPolicy.hpp"
 #include "support/Inevitability.hpp"
 #include "cm/ContentionManager.hpp"
 #include "cm/CMPolicies.hpp"
 #include "support/TokenManager.hpp"
+#include "support/VisReaderSet.hpp"
 #include "support/atomic_ops.h"
 #include "support/Retry.hpp"
+#include "support/TxStats.hpp"
+#include "support/AcquireAdvisor.hpp"
 /******************************** SH-START ********************************************/
 #include <rstm_hlp.hpp>
 #include "cm/ECM.hpp"
@@ -78,6 +84,15 @@ using namespace std;
 #include <setjmp.h>
 #endif
 
+#if defined(STM_INPLACE_LARGE_OBJECTS) && !defined(STM_INPLACE_THRESHOLD)
+/**
+ *  Objects opened for writing with a size of at least this many bytes are
+ *  written in place under an undo log instead of being cloned.  Override it
+ *  with -DSTM_INPLACE_THRESHOLD=<bytes>.
+ */
+#define STM_INPLACE_THRESHOLD 1024
+#endif
+
 namespace rstm {
 
 class Descriptor;
@@ -106,7 +121,10 @@ extern stm::TokenManager<Descriptor> readbits;
 class Object : public stm::mm::CustomAllocedBase
 {
   friend class Descriptor;
+  friend class InPlaceVersion;
   friend Object* open_privatized(SharedHandle* const);
+  friend bool is_inplace(const Object* const);
+  friend Object* get_data(Object* const);
  protected:
   /**
    *  Version from which /this/ was cloned.  The bits of this field are
@@ -135,6 +153,59 @@ class Object : public stm::mm::CustomAllocedBase
 
 };
 
+#if defined(STM_INPLACE_LARGE_OBJECTS)
+/**
+ *  When a large object is written in place, the writer installs one of these
+ *  in the header instead of a clone.  It carries the same ownership metadata
+ *  as a clone (m_next is the version it replaces, m_owner is the writer), and
+ *  after the writer commits it stays in the header as the object's current
+ *  version, so that every in-place commit still gives the object a new
+ *  version pointer to validate against.  The data itself never moves: it is
+ *  always in m_master.
+ *
+ *  An InPlaceVersion is never reachable through an sh_ptr, so its m_st is
+ *  NULL, which is how we tell it apart from a real object.
+ */
+class InPlaceVersion : public Object
+{
+  friend class Descriptor;
+  friend Object* get_data(Object* const);
+
+  /*** The object whose fields are being written in place */
+  Object* m_master;
+
+ public:
+  InPlaceVersion(Object* master, Object* prev, Descriptor* owner)
+    : m_master(master)
+  {
+    m_next = prev;
+    m_owner = owner;
+  }
+};
+#endif
+
+/***  Check if a version is an in-place version rather than a real object */
+inline bool is_inplace(const Object* const version) {
+#if defined(STM_INPLACE_LARGE_OBJECTS)
+  return version->m_st == NULL;
+#else
+  return false;
+#endif
+}
+
+/**
+ *  Map a version (what the header and the read/write sets hold) to the object
+ *  whose fields the application should use.  Versions are objects unless the
+ *  object is written in place.
+ */
+inline Object* get_data(Object* const version) {
+#if defined(STM_INPLACE_LARGE_OBJECTS)
+  if (version && version->m_st == NULL)
+    return static_cast<InPlaceVersion*>(version)->m_master;
+#endif
+  return version;
+}
+
 ////////////////////////////////////////////
 // Utilities for managing object metadata //
 ////////////////////////////////////////////
@@ -191,24 +262,37 @@ struct SharedHandle : public stm::mm::CustomAllocedBase
   Object* volatile __attribute__((__may_alias__)) m_payload;
 
   /**
-   *  Visible reader bitmap.  Up to 32 transactions can read an object visibly
-   *  by getting permission to 'own' one of the 32 global bits and then setting
-   *  that bit in a shared object's visible reader bitmap.
+   *  Visible reader set.  Up to MAX_THREADS transactions can read an object
+   *  visibly by getting permission to 'own' one of the global reader tokens
+   *  and then setting that token's bit in a shared object's reader set.
    */
-  volatile unsigned long m_readers;
+  stm::VisReaderSet m_readers;
 
   /**
    *  Similar to above, but for retry() (depending on retry implementation)
    */
   volatile stm::RetryMechanism::PerObjectRetryMetadata m_retryers;
 
+#if defined(STM_COMMIT_TIMESTAMP)
+  /**
+   *  Commit time of the last writer of this object.  Set by the writer after
+   *  it takes its commit time and before it CASes itself COMMITTED, so anyone
+   *  who sees the new version also sees its timestamp.
+   */
+  volatile unsigned long m_version;
+#endif
+
   /**
    *  Constructor for shared objects. All this constructor does is initialize a
    *  SharedHandle to wrap the object for transactional use.
    *
    *  @param t - The Object that this shared manages.  t should not be NULL
    */
-  SharedHandle(Object* t) : m_payload(t), m_readers(0), m_retryers(0) { }
+  SharedHandle(Object* t) : m_payload(t), m_readers(), m_retryers(0)
+#if defined(STM_COMMIT_TIMESTAMP)
+                          , m_version(0)
+#endif
+  { }
 }; // class rstm::SharedHandle
 
 
@@ -248,17 +332,34 @@ struct invis_bookkeep_t {
   { }
 };
 
-/*** Tuble for storing CHECKPOINTS with corresponding SharedHandles ***/
-struct cp_sh{
-	//used to record CHECKPOINTs
-	SharedHandle* sh;
-	jmp_buf* cp;
-
-	cp_sh(SharedHandle* sh_tmp=NULL, jmp_buf* cp_tmp=NULL)
-	:sh(sh_tmp),cp(cp_tmp)
-	{}
+#if defined(STM_ROLLBACK_SETJMP)
+/**
+ *  A point inside a transaction that CHECKPOINT() asked us to be able to
+ *  roll back to.  Since all the logs only grow between checkpoints, it is
+ *  enough to remember how long each of them was; rolling back is then a
+ *  matter of undoing and truncating everything past these marks.
+ */
+struct checkpoint_t {
+  jmp_buf       buf;            /// where to resume
+  unsigned long invisReads;     /// invisibleReads.size() at the checkpoint
+  unsigned long visReads;       /// visibleReads.size()
+  unsigned long eagerWrites;    /// eagerWrites.size()
+  unsigned long lazyWrites;     /// lazyWrites.size()
+  unsigned long undo;           /// undoLog.mark()
+  unsigned long deleteOnCommit; /// mm.deleteOnCommit.size()
+  unsigned long deleteOnAbort;  /// mm.deleteOnAbort.size()
+  unsigned int  nesting_depth;  /// nesting depth of the CHECKPOINT() call
 };
 
+/**
+ *  The checkpoint stack has a fixed size, so that taking a checkpoint never
+ *  allocates.  CHECKPOINT() is a no-op once the stack is full.
+ */
+#ifndef STM_MAX_CHECKPOINTS
+#define STM_MAX_CHECKPOINTS 8
+#endif
+#endif
+
 /**
  *  The entire RSTM algorithm, and all of the metadata pertaining to an active
  *  transaction instance, are ensapsulated in the Descriptor.
@@ -272,10 +373,11 @@ class Descriptor {
 
  private:
   /**
-   *  sw vis reader bitmask.  If we get permission to use SharedHandle
-   *  m_readers bits from the TokenManager, then this field will be nonzero.
+   *  sw vis reader token.  If we get permission to use a SharedHandle
+   *  m_readers bit from the TokenManager, then this field will be the index of
+   *  that bit; otherwise it is -1.
    */
-  unsigned long id_mask;
+  int vis_token;
 
 #ifdef STM_PRIV_NONBLOCKING
   /**
@@ -289,7 +391,20 @@ class Descriptor {
   /**
    * Policy wrapper around a CM
    */
-  stm::HybridCMPolicy cm;
+  stm::DescriptorCMPolicy cm;
+
+  /**
+   *  The real-time task this thread runs, registered with init(); used by
+   *  BEGIN_RT_TRANSACTION when it isn't given a task of its own
+   */
+  stm::RTTask* rt_task;
+
+  /**
+   *  True from the first begin_rt_transaction() of a transaction until it
+   *  commits, so that its retries don't reload the task.  Kept here rather
+   *  than in the CM's new_tx, which only some CMs' commit hooks reset.
+   */
+  bool rt_begun;
 
  private:
   /**
@@ -305,6 +420,50 @@ class Descriptor {
    */
   void check_privatizer_clock();
 
+  /**
+   *  For in-place writes, and for writes made while a checkpoint is live:
+   *  save the bytes at [addr, addr + len) before a setter overwrites them, so
+   *  that an abort or partial rollback can put them back.
+   */
+  void logWrite(void* addr, unsigned long len) {
+    undoLog.log(addr, len);
+  }
+
+  /**
+   *  Setters only need to log writes to clones when a partial rollback could
+   *  resume the transaction with those clones still installed.
+   */
+  bool hasCheckpoint() const {
+#if defined(STM_ROLLBACK_SETJMP)
+    return num_checkpoints != 0;
+#else
+    return false;
+#endif
+  }
+
+#if defined(STM_ROLLBACK_SETJMP)
+  /**
+   *  Called by CHECKPOINT(): remember how far each log has grown, and return
+   *  the jump buffer that the caller must setjmp() into.  Returns NULL, and
+   *  takes no checkpoint, if checkpointing is off, if we are inevitable, or
+   *  if the checkpoint stack is full.
+   */
+  jmp_buf* checkpoint();
+#endif
+
+#if defined(STM_INPLACE_LARGE_OBJECTS)
+
+  /**
+   *  For in-place reads: a field read from an object that is written in place
+   *  is only good if no other writer has acquired the object since we opened
+   *  /version/ of it.  Abort if one has.
+   */
+  void verifyInPlaceRead(const SharedHandle* const sh, const Object* version) {
+    if (get_data_ptr(sh->m_payload) != version && !isCurrent(sh, version))
+      abort(stm::TxStats::ABORT_VALIDATION);
+  }
+#endif
+
   /**
    *  Constructor is very straightforward
    */
@@ -335,6 +494,24 @@ class Descriptor {
   /*** are we using lazy or eager acquire? */
   bool isLazy;
 
+  /**
+   *  With the "-adapt" validation strings, each BEGIN_TRANSACTION site
+   *  picks eager or lazy acquire for itself; transactions that don't name
+   *  their site use defaultLazy.
+   */
+  bool adaptive;
+  bool defaultLazy;
+  stm::AcquireAdvisor advisor;
+
+  /*** the advisor's record for the current transaction's site, if any */
+  stm::AcquireAdvisor::Record* site;
+
+  /*** set isLazy for a transaction starting at /where/ */
+  void chooseAcquire(stm::TxSite* where) {
+    site = advisor.find(where);
+    isLazy = site ? site->lazy : defaultLazy;
+  }
+
   /*** are we using visible or invisible reads? */
   bool isVisible;
 
@@ -362,10 +539,12 @@ class Descriptor {
       mm.onTxBegin();
 
       // mark myself active
+      abort_cause = stm::TxStats::ABORT_OTHER;
       tx_state = stm::ACTIVE;
 
 #if defined(STM_ROLLBACK_SETJMP)
-   	  setjmp_buf.insert(cp_sh(NULL,buf));
+      setjmp_buf = buf;
+      num_checkpoints = 0;
 #endif
 
       // cm notification
@@ -375,11 +554,79 @@ class Descriptor {
     nesting_depth++;
   }
 
+  /**
+   *  BEGIN_TRANSACTION names its call site, so that an adaptive Descriptor
+   *  can choose the acquire policy for it.
+   */
+#if defined(STM_ROLLBACK_SETJMP)
+  void begin_transaction(jmp_buf* buf, stm::TxSite* where)
+  {
+    if ((nesting_depth == 0) && adaptive)
+      chooseAcquire(where);
+    begin_transaction(buf);
+  }
+#else
+  void begin_transaction(stm::TxSite* where)
+  {
+    if ((nesting_depth == 0) && adaptive)
+      chooseAcquire(where);
+    begin_transaction();
+  }
+#endif
+
+  /**
+   *  Begin a transaction that promises not to write.  The outermost one runs
+   *  in snapshot mode (see openSnapshot()) unless it has already failed to
+   *  commit that way SNAPSHOT_ATTEMPTS times in a row, or a writer is in the
+   *  middle of committing; then it runs as an ordinary transaction.
+   */
+#if defined(STM_ROLLBACK_SETJMP)
+  void begin_readonly_transaction(jmp_buf* buf)
+  {
+    begin_transaction(buf);
+#else
+  void begin_readonly_transaction()
+  {
+    begin_transaction();
+#endif
+    if ((nesting_depth == 1) && (snapshotFailures < SNAPSHOT_ATTEMPTS))
+      snapshotMode = takeSnapshot();
+  }
+
 /************************************* SH-START *********************************************/
+  /**
+   *  Begin a transaction of a real-time task: /task/, or if that is NULL,
+   *  the task registered with init().  The CM reloads the task's
+   *  parameters only for a new transaction of a different or touched task,
+   *  so a retry, or the next transaction of the same task, copies nothing.
+   */
+#if defined(STM_ROLLBACK_SETJMP)
+  void begin_rt_transaction(jmp_buf* buf, stm::RTTask* task)
+#else
+  void begin_rt_transaction(stm::RTTask* task)
+#endif
+  {
+    stm::ContentionManager* c = cm.getCM();
+    if (!task)
+      task = rt_task;
+    if ((nesting_depth == 0) && !rt_begun && c && task) {
+      c->beginTask(task);
+      rt_begun = true;
+    }
+#if defined(STM_ROLLBACK_SETJMP)
+    begin_transaction(buf);
+#else
+    begin_transaction();
+#endif
+  }
+
+//The two forms below take the parameters as a void* to task_in_param, and copy them in for every new Tx.
+//BEGIN_RT_TRANSACTION and RTTask replace them
+
 #if defined(STM_ROLLBACK_SETJMP)
-  void begin_transaction(jmp_buf* buf,void* in_time,vector<double> obj_lst,int th)
+  void begin_transaction(jmp_buf* buf,void* in_time,const vector<double>& obj_lst,int th)
 #else
-  void begin_transaction(void* in_time,vector<double> obj_lst,int th)
+  void begin_transaction(void* in_time,const vector<double>& obj_lst,int th)
 #endif
   {
 	if(cm.getCM()->new_tx){
@@ -392,40 +639,28 @@ class Descriptor {
 	      cm.getCM()->task_period=((struct task_in_param*)in_time)->task_period;
 	      cm.getCM()->task_unlocked=((struct task_in_param*)in_time)->task_unlocked;
 	      cm.getCM()->task_locked=((struct task_in_param*)in_time)->task_locked;
-	      cm.getCM()->time_param=*(((struct task_in_param*)in_time)->time_param);	//Set the time parameter which is going to be used with ECM and being cast to deadline
+	      cm.getCM()->setTimeParam(*(((struct task_in_param*)in_time)->time_param));	//Set the time parameter which is going to be used with ECM and being cast to deadline
 					// This parameter could be cast to other types according to the used cm
 //      if(cm.getCM()->eta<0){
 	      cm.getCM()->eta=((struct task_in_param*)in_time)->gen_eta;
 //      }
 	      cm.getCM()->setAccObj(obj_lst);     // Set accessed object list by current Tx
 	      cm.getCM()->setCurThr(th);          // Ptr to thread calling Tx
+	      cm.getCM()->task=NULL;	// No RTTask holds these parameters
     }
-    // only for outermost transaction
-    if (nesting_depth == 0) {
-      inev.onBeginTx();
-      conflicts.onTxBegin();
-      mm.onTxBegin();
-
-      // mark myself active
-      tx_state = stm::ACTIVE;
-
 #if defined(STM_ROLLBACK_SETJMP)
-   	  setjmp_buf.insert(cp_sh(NULL,buf));
+    begin_transaction(buf);
+#else
+    begin_transaction();
 #endif
-
-      // cm notification
-      cm.onBeginTx();
-    }
-
-    nesting_depth++;
   }
 
 //Another form for begin_transaction that is used with LCM
 
 #if defined(STM_ROLLBACK_SETJMP)
-  void begin_transaction(jmp_buf* buf,double psy,unsigned long exec,void* in_time,vector<double> obj_lst,int th)
+  void begin_transaction(jmp_buf* buf,double psy,unsigned long exec,void* in_time,const vector<double>& obj_lst,int th)
 #else
-  void begin_transaction(double psy,unsigned long exec,void* in_time,vector<double> obj_lst,int th)
+  void begin_transaction(double psy,unsigned long exec,void* in_time,const vector<double>& obj_lst,int th)
 #endif
   {
 	if(cm.getCM()->new_tx){
@@ -438,7 +673,7 @@ class Descriptor {
 	      cm.getCM()->task_period=((struct task_in_param*)in_time)->task_period;
 	      cm.getCM()->task_unlocked=((struct task_in_param*)in_time)->task_unlocked;
 	      cm.getCM()->task_locked=((struct task_in_param*)in_time)->task_locked;
-	      cm.getCM()->time_param=*(((struct task_in_param*)in_time)->time_param);	//Set the time parameter which is going to be used with ECM and being cast to deadline
+	      cm.getCM()->setTimeParam(*(((struct task_in_param*)in_time)->time_param));	//Set the time parameter which is going to be used with ECM and being cast to deadline
 					// This parameter could be cast to other types according to the used cm
 //      if(cm.getCM()->eta<0){
 	      cm.getCM()->eta=((struct task_in_param*)in_time)->gen_eta;
@@ -447,27 +682,13 @@ class Descriptor {
 	      cm.getCM()->setCurThr(th);          // Ptr to thread calling Tx
 	      cm.getCM()->setPsy(psy);
 	      cm.getCM()->setLength(exec);
-          cm.getCM()->setAccObj(obj_lst);
-   } 
-    
-    // only for outermost transaction
-    if (nesting_depth == 0) {
-      inev.onBeginTx();
-      conflicts.onTxBegin();
-      mm.onTxBegin();
-
-      // mark myself active
-      tx_state = stm::ACTIVE;
-
+	      cm.getCM()->task=NULL;	// No RTTask holds these parameters
+    }
 #if defined(STM_ROLLBACK_SETJMP)
-   	  setjmp_buf.insert(cp_sh(NULL,buf));
+    begin_transaction(buf);
+#else
+    begin_transaction();
 #endif
-
-      // cm notification
-      cm.onBeginTx();
-    }
-
-    nesting_depth++;
   }
 
 /************************************* SH-END *********************************************/
@@ -483,7 +704,38 @@ class Descriptor {
    * Undo a transaction's operations and roll back by throwing Rollback()
    */
   void abort();
-  void abort(SharedHandle*);
+
+  /*** Abort for a reason we found ourselves */
+  void abort(stm::TxStats::Counter cause) {
+    abort_cause = cause;
+    abort();
+  }
+
+  /**
+   *  We found that the read at position /invis/ of the invisible read set,
+   *  or the lazy write at position /lazy/, is out of date.  If we are still
+   *  active and took a checkpoint before that read, roll back to the newest
+   *  such checkpoint; otherwise abort the whole transaction.
+   */
+  void abortToCheckpoint(unsigned long invis, unsigned long lazy);
+
+#if defined(STM_ROLLBACK_SETJMP)
+  /**
+   *  Undo everything done since checkpoints[index], drop the checkpoints
+   *  taken after it, and resume execution at it.
+   */
+  void rollbackTo(unsigned int index);
+
+  /**
+   *  Forget the checkpoints taken at /depth/ or deeper.  Their frames go
+   *  away when the nested transaction that took them commits.
+   */
+  void dropCheckpoints(unsigned int depth) {
+    while (num_checkpoints > 0 &&
+           checkpoints[num_checkpoints - 1].nesting_depth >= depth)
+      num_checkpoints--;
+  }
+#endif
 
  public:
   /**
@@ -492,7 +744,6 @@ class Descriptor {
    *  any per-object metadata that the most recent transaction modified.
    */
   void rollback();
-  void rollback(SharedHandle* sh);
 
   /*** Called by the catch block in END_TRANSACTION to implement retry(). */
   void retry();
@@ -501,14 +752,77 @@ class Descriptor {
   /***  The current depth of nested transactions, where 0 is no transaction. */
   unsigned int nesting_depth;
 
+  /**
+   *  Read-only transactions in snapshot mode keep no read set.  Instead,
+   *  every writer bumps commits_started just before the CAS that commits it
+   *  and commits_finished just after.  A reader takes its snapshot when the
+   *  two are equal, i.e. when no writer is between those points, and
+   *  everything it opens is then the committed version as of the snapshot
+   *  for as long as commits_started doesn't move: any commit after the
+   *  snapshot bumps it before it takes effect.  So checking that counter
+   *  after each open, and once more at commit, stands in for validation.
+   */
+  static volatile unsigned long commits_started __attribute__ ((aligned(64)));
+  static volatile unsigned long commits_finished;
+
+  /*** snapshot-mode transactions that abort this often in a row run logged */
+  static const unsigned int SNAPSHOT_ATTEMPTS = 2;
+
+  /*** is the current transaction running in snapshot mode? */
+  bool snapshotMode;
+
+  /*** commits_started when the snapshot was taken */
+  unsigned long snapshot;
+
+  /*** aborts of snapshot-mode attempts since our last commit */
+  unsigned int snapshotFailures;
+
+  /**
+   *  Wait briefly for a moment when no writer is committing, and record the
+   *  commit count then.  Returns false if we couldn't find one.
+   */
+  bool takeSnapshot() {
+    for (int tries = 0; tries < 16; tries++) {
+      // reading finished first means that, if the two match, started hadn't
+      // moved past finished when we read it either
+      unsigned long f = commits_finished;
+      unsigned long s = commits_started;
+      if (s == f) {
+        snapshot = s;
+        return true;
+      }
+      spin64();
+    }
+    return false;
+  }
+
+  /*** the snapshot-mode version of openReadOnly() */
+  Object* openSnapshot(SharedHandle* const header);
+
+  /**
+   *  A snapshot-mode transaction tried to do something that needs logs
+   *  (write, or retry): restart it as an ordinary transaction.
+   */
+  void abandonSnapshot() {
+    snapshotFailures = SNAPSHOT_ATTEMPTS;
+    abort(stm::TxStats::ABORT_OTHER);
+  }
+
+ public:
+  /*** called by retry(); a snapshot has no read set to wait on */
+  void onRetry() {
+    if (snapshotMode)
+      abandonSnapshot();
+  }
+
+ private:
 #if defined(STM_ROLLBACK_SETJMP)
   /*** non-throw rollback needs a jump buffer */
-  /*
-   * To enable CHECKPOINTING, setjmp_buf is changed to a double column verctor where
-   * the first column contains pointers to each newly accessed object's SharedHandle
-   * and the second column contains pointers to setjmp/longjmp points
-   */
-  //vector<struct cp_sh> setjmp_buf;
+  jmp_buf* setjmp_buf;
+
+  /*** checkpoints taken by CHECKPOINT(), oldest first */
+  checkpoint_t checkpoints[STM_MAX_CHECKPOINTS];
+  unsigned int num_checkpoints;
 #endif
 
   /**
@@ -526,6 +840,25 @@ class Descriptor {
    */
   stm::ValidationPolicy conflicts;
 
+  /**
+   *  Ask the validation policy whether opening /header/ requires validating
+   *  the read set.  Timestamp-based validation needs to see the version of
+   *  the object we just opened; the other policies don't.
+   */
+  bool shouldValidate(SharedHandle* header)
+  {
+#if defined(STM_COMMIT_TIMESTAMP)
+      return conflicts.shouldValidate(header->m_version);
+#else
+      return conflicts.shouldValidate();
+#endif
+  }
+
+#if defined(STM_COMMIT_TIMESTAMP)
+  /***  Stamp every object we wrote with our commit time */
+  void stampWrites(unsigned long end_time);
+#endif
+
   /**
    *  Make sure that any object we read and are writing lazily hasn't changed.
    */
@@ -546,11 +879,6 @@ class Descriptor {
    */
   void cleanupEagerWrites(unsigned long tx_state);
 
-  /*
-   * The same as cleanupEagerWrites except that it stops at the sh handler in the list
-   */
-  void cleanupEagerWrites(unsigned long tx_state, SharedHandle* sh);
-
   /**
    *  Lookup an entry in the lazy write set.  If we try to read something that
    *  we've opened lazily, the only way to avoid an alias error is to use this
@@ -566,11 +894,6 @@ class Descriptor {
    */
   void cleanupLazyWrites(unsigned long tx_state);
 
-  /*
-   * The same as cleanupLazyWrites except that it stops at the sh handler in the list
-   */
-  void cleanupLazyWrites(unsigned long tx_state,SharedHandle* sh);
-
   /**
    *  Combine add / lookup / validate in the read set.  This lets me avoid
    *  duplicate entries.  If I'm opening O, instead of looking up O in my read
@@ -596,11 +919,6 @@ class Descriptor {
    */
   void removeInvisRead(SharedHandle* shared);
 
-  /**
-   * Remove all elements of invisibleRead from last element up to a specific sh
-   */
-  void cleanupInvisRead(SharedHandle* sh);
-
   /**
    *  For each entry in the visible read set, take myself out of the object's
    *  reader list.
@@ -608,53 +926,82 @@ class Descriptor {
   void cleanupVisReads();
 
   /**
-   * Remove checkpoints of current list from end up to sh
+   *  Remove an entry from the visible reader list, as part of early release.
    */
-  void cleanupCheckpoints(SharedHandle* sh);
+  void removeVisRead(const SharedHandle* const shared);
 
-  /**
-   * The same as cleanupCheckpoints(sh) except that it removes all checkpoints except the first one
-   */
-  void cleanupCheckpoints();
+  /***  Bookkeeping typedefs */
+  typedef stm::SegmentLog<invis_bookkeep_t> InvisReadLog;
+  typedef stm::SegmentLog<SharedHandle*>    VisReadLog;
+  typedef stm::SegmentLog<eager_bookkeep_t> EagerWriteLog;
+  typedef stm::SegmentLog<lazy_bookkeep_t>  LazyWriteLog;
+
+  /*** scratch list of headers for openWriteBatch() */
+  stm::MiniVector<SharedHandle*> writeBatch;
+
+  /*** this thread's arena for log segments; must precede the logs */
+  stm::LogArena logArena;
+
+  InvisReadLog  invisibleReads;     /// Invisible read log
+  VisReadLog    visibleReads;       /// Visible read log
+  EagerWriteLog eagerWrites;        /// Eager write log
+  LazyWriteLog  lazyWrites;         /// Lazy write log
 
   /**
-   * The same as cleanupCheckpoints(sh) except that it removes all checkpoints
+   *  Hash index over lazyWrites, so that lookupLazyWrite() is O(1) instead
+   *  of a walk over the whole lazy write set on every open.
    */
-  void removeCheckpoints();
+  stm::LogIndex lazyIndex;
 
   /**
-   * The same as cleanupVisReads() except it removes items from end of visiblereads
-   * up to sh
+   *  Old contents of fields we wrote in place, or wrote while a checkpoint
+   *  was live, for rollback
    */
-  void cleanupVisReads(SharedHandle* sh);
+  stm::UndoLog undoLog;
+
+  // for tracking statistics
+  stm::TxStats stats;
 
   /**
-   *  Remove an entry from the visible reader list, as part of early release.
+   *  Why the current transaction is going to abort: one of the
+   *  TxStats::ABORT_* counters.  A transaction that aborts us remotely sets
+   *  it just before it CASes our state, so that we can count the abort under
+   *  the right cause when we notice.
    */
-  void removeVisRead(const SharedHandle* const shared);
+  volatile unsigned long abort_cause;
 
-  /***  Bookkeeping typedefs */
-  typedef stm::MiniVector<invis_bookkeep_t> InvisReadLog;
-  typedef stm::MiniVector<SharedHandle*>    VisReadLog;
-  typedef stm::MiniVector<eager_bookkeep_t> EagerWriteLog;
-  typedef stm::MiniVector<lazy_bookkeep_t>  LazyWriteLog;
-  typedef stm::MiniVector<cp_sh> setjmp_bufLog;
+  /*** count an abort under the recorded cause */
+  void countAbort() {
+    stats.inc(stm::TxStats::ABORTS);
+    stats.inc((stm::TxStats::Counter)abort_cause);
+  }
 
-  InvisReadLog  invisibleReads;     /// Invisible read log
-  VisReadLog    visibleReads;       /// Visible read log
-  EagerWriteLog eagerWrites;        /// Eager write log
-  LazyWriteLog  lazyWrites;         /// Lazy write log
-  setjmp_bufLog setjmp_buf;			/// CHECKPOINTS log
+  /*** count what the CM decided about a conflict, and pass the decision on */
+  stm::ConflictResolutions decided(stm::ConflictResolutions r) {
+    if (r == stm::AbortSelf)
+      stats.inc(stm::TxStats::CM_ABORT_SELF);
+    else if (r == stm::AbortOther)
+      stats.inc(stm::TxStats::CM_ABORT_OTHER);
+    else
+      stats.inc(stm::TxStats::CM_WAIT);
+    return r;
+  }
 
-  // for tracking statistics
-  unsigned num_commits;
-  unsigned num_aborts;
-  unsigned num_retrys;
+  /*** back off through the CM, and count the time it took */
+  void backoff() {
+    unsigned long long start = getElapsedTime();
+    cm.onContention();
+    stats.add(stm::TxStats::BACKOFF_NS, getElapsedTime() - start);
+  }
 
  public:
-  unsigned getCommits() { return num_commits; }
-  unsigned getAborts()  { return num_aborts; }
-  unsigned getRetrys()  { return num_retrys; }
+  unsigned getCommits() { return stats.get(stm::TxStats::COMMITS); }
+  unsigned getAborts()  { return stats.get(stm::TxStats::ABORTS); }
+  unsigned getRetrys()  { return stats.get(stm::TxStats::RETRYS); }
+  unsigned getPartialAborts() {
+    return stats.get(stm::TxStats::PARTIAL_ABORTS);
+  }
+  const stm::TxStats& getStats() const { return stats; }
 
   /**
    *  Ensure that Object t has a shared header guarding access to it
@@ -755,7 +1102,27 @@ class Descriptor {
 
   Object* openReadOnly(SharedHandle* const sh);
 
-  Object* openReadWrite(SharedHandle* const sh, const size_t objsize);
+  /**
+   *  Open /sh/ for writing.  If /validateLater/ is given, a validation that
+   *  this open would have done is left to the caller, by setting
+   *  *validateLater to true.
+   */
+  Object* openReadWrite(SharedHandle* const sh, const size_t objsize,
+                        bool* validateLater = NULL);
+
+  /**
+   *  Open every object queued with addToWriteBatch() for writing.  The
+   *  headers are prefetched, duplicates are dropped, and the objects are
+   *  acquired in address order, so that two transactions batching
+   *  overlapping sets can't each hold what the other is waiting for.  We
+   *  validate once for the whole batch instead of once per object.
+   *  Afterwards, opening any of these objects for writing just finds it in
+   *  the write set.
+   */
+  void openWriteBatch(const size_t objsize);
+
+  /*** queue /sh/ for the next openWriteBatch() */
+  void addToWriteBatch(SharedHandle* const sh) { writeBatch.insert(sh); }
 
   Object* upgradeToReadWrite(SharedHandle* const sh, const size_t objsize) {
     return openReadWrite(sh, objsize);
@@ -776,6 +1143,7 @@ class Descriptor {
     if (nesting_depth-- > 1)
       return;
     tx_state = stm::ABORTED;
+    rt_begun = false;
     rollback();
   }
 #endif
@@ -790,8 +1158,11 @@ class Descriptor {
   void release(SharedHandle* const obj);
 
   void deleteTransactionally(SharedHandle* sh) {
+    Object* version = const_cast<Object*>(openReadOnly(sh));
     mm.deleteOnCommit.insert(sh);
-    mm.deleteOnCommit.insert(const_cast<Object*>(openReadOnly(sh)));
+    mm.deleteOnCommit.insert(version);
+    if (is_inplace(version))
+      mm.deleteOnCommit.insert(get_data(version));
   }
 };  // class rstm::Descriptor
 
@@ -809,39 +1180,86 @@ inline void tx_free(void* ptr) {
     tx->mm.deleteOnCommit.insert((stm::mm::CustomAllocedBase*)ptr);
 }
 
-inline void Descriptor::abort(SharedHandle* sh) {
+inline void Descriptor::abort() {
   // need to assert not inevitable
-	/*
-	 * sh is a pointer to CHECKPOINT location. If sh is NULL, tx returns to
-	 * beginning of tx
-	 */
-
   tx_state = stm::ABORTED;
-  if(!sh){
-	  rollback();
-  }
-  else{
-	  rollback(sh);
-  }
+  rollback();
 #if defined(STM_ROLLBACK_THROW)
   throw stm::RollBack();
 #elif defined(STM_ROLLBACK_SETJMP)
   nesting_depth = 0;
-  if(!sh){
-	  longjmp(*((setjmp_buf.begin())->cp),1);
-  }
-  else{
-	  /*
-	   * Un-needed checkpoints should have been removed from CHECKPOINT vector. So,
-	   * just jump to the last CHECKPOINT
-	   */
-	  longjmp(*((setjmp_buf.end()-1)->cp),1);
-  }
+  longjmp(*setjmp_buf, 1);
 #endif
 }
 
-inline void Descriptor::abort(){
-	abort(NULL);
+#if defined(STM_ROLLBACK_SETJMP)
+inline jmp_buf* Descriptor::checkpoint() {
+  if (!STM_CHECKPOINT || inev.isInevitable() || snapshotMode ||
+      (num_checkpoints == STM_MAX_CHECKPOINTS))
+    return NULL;
+
+  checkpoint_t& cp = checkpoints[num_checkpoints++];
+  cp.invisReads     = invisibleReads.size();
+  cp.visReads       = visibleReads.size();
+  cp.eagerWrites    = eagerWrites.size();
+  cp.lazyWrites     = lazyWrites.size();
+  cp.undo           = undoLog.mark();
+  cp.deleteOnCommit = mm.deleteOnCommit.size();
+  cp.deleteOnAbort  = mm.deleteOnAbort.size();
+  cp.nesting_depth  = nesting_depth;
+  return &cp.buf;
+}
+
+inline void Descriptor::rollbackTo(unsigned int index) {
+  checkpoint_t& cp = checkpoints[index];
+
+  // put back the fields we overwrote since the checkpoint, while we still own
+  // every object they belong to
+  undoLog.undo(cp.undo);
+
+  // give back objects acquired since the checkpoint, newest first
+  for (unsigned long i = eagerWrites.size(); i > cp.eagerWrites; --i) {
+    EagerWriteLog::iterator w = eagerWrites.begin() + (i - 1);
+    CleanOnAbort(w->shared, w->write_version, w->read_version);
+  }
+  eagerWrites.resize(cp.eagerWrites);
+
+  // lazy writes aren't acquired before commit, and lookupLazyWrite() ignores
+  // index entries past the end of the log
+  lazyWrites.resize(cp.lazyWrites);
+
+  for (unsigned long i = cp.visReads; i < visibleReads.size(); ++i)
+    removeVisibleReader(*(visibleReads.begin() + i));
+  visibleReads.resize(cp.visReads);
+  invisibleReads.resize(cp.invisReads);
+
+  mm.onRollbackTo(cp.deleteOnCommit, cp.deleteOnAbort);
+
+  stats.inc(stm::TxStats::PARTIAL_ABORTS);
+
+  num_checkpoints = index + 1;
+  nesting_depth = cp.nesting_depth;
+  longjmp(cp.buf, 1);
+}
+#endif
+
+inline void Descriptor::abortToCheckpoint(unsigned long invis,
+                                          unsigned long lazy)
+{
+  // if someone else aborted us, they may already be cleaning up our writes
+  if (tx_state == stm::ACTIVE) {
+#if defined(STM_ROLLBACK_SETJMP)
+    // checkpoints are ordered, so the newest one that predates both reads
+    // undoes the least work
+    for (unsigned int i = num_checkpoints; i > 0; --i) {
+      checkpoint_t& cp = checkpoints[i - 1];
+      if ((cp.invisReads <= invis) && (cp.lazyWrites <= lazy))
+        rollbackTo(i - 1);
+    }
+#endif
+    abort(stm::TxStats::ABORT_VALIDATION);
+  }
+  abort();
 }
 
 inline void Descriptor::validate() {
@@ -855,6 +1273,14 @@ inline void Descriptor::removeVisRead(const SharedHandle* const shared) {
   for (VisReadLog::iterator i = visibleReads.begin(),
          e = visibleReads.end(); i != e; ++i) {
     if (shared == *i) {
+#if defined(STM_ROLLBACK_SETJMP)
+      // the log stays in order, so a checkpoint taken after this read just
+      // has one read fewer before it
+      unsigned long pos = i - visibleReads.begin();
+      for (unsigned int c = 0; c < num_checkpoints; c++)
+        if (checkpoints[c].visReads > pos)
+          checkpoints[c].visReads--;
+#endif
       visibleReads.remove(i);
       return;
     }
@@ -865,66 +1291,30 @@ inline void Descriptor::removeInvisRead(SharedHandle* shared) {
   for (InvisReadLog::iterator i = invisibleReads.begin(),
          e = invisibleReads.end(); i != e; ++i) {
     if (i->shared == shared) {
+#if defined(STM_ROLLBACK_SETJMP)
+      unsigned long pos = i - invisibleReads.begin();
+      for (unsigned int c = 0; c < num_checkpoints; c++)
+        if (checkpoints[c].invisReads > pos)
+          checkpoints[c].invisReads--;
+#endif
       invisibleReads.remove(i);
       return;
     }
   }
 }
 
-inline void Descriptor::cleanupInvisRead(SharedHandle* sh){
-	unsigned long num_rem_elm=0;	//number of removed elements of invisibleReads
-	unsigned long cur_size=invisibleReads.size();	//current size of invisibleReads
-	for (InvisReadLog::iterator i = invisibleReads.end()-1,
-	         e = invisibleReads.begin(); i >= e; --i) {
-		invisibleReads.remove(i);
-		num_rem_elm++;
-	    if (i->shared == sh) {
-	    	break;
-	    }
-    }
-	invisibleReads.resize(cur_size-num_rem_elm);
-}
-
-inline void Descriptor::removeCheckpoints(){
-	/*
-	 * Remove all checkpoints including the first one. Used when transaction commits
-	 */
-	for(setjmp_bufLog::iterator i=setjmp_buf.end()-1,e=setjmp_buf.begin();i>=e;--i){
-		setjmp_buf.remove(i);
-	}
-	setjmp_buf.reset();
-}
-
-inline void Descriptor::cleanupCheckpoints(SharedHandle* sh){
-	/*
-	 * The first element in checkpoint list is not removed as it represents the
-	 * beginning of transaction
-	 */
-	unsigned long num_rem_elem=0;
-	unsigned long cur_size=setjmp_buf.size();
-	for(setjmp_bufLog::iterator i=setjmp_buf.end()-1,
-			e=setjmp_buf.begin(); i>e; --i){
-		if(i->sh==sh){
-			//Used for CHECKPOINTING
-			break;
-		}
-		setjmp_buf.remove(i);
-		num_rem_elem++;
-	}
-	setjmp_buf.resize(cur_size-num_rem_elem);
-}
-
-inline void Descriptor::cleanupCheckpoints(){
-	cleanupCheckpoints(NULL);
-}
-
 inline Object* Descriptor::lookupLazyWrite(SharedHandle* shared) const {
   assert(shared);
-  for (LazyWriteLog::iterator i = lazyWrites.begin(),
-         e = lazyWrites.end(); i != e; ++i)
-    if (i->shared == shared)
-      return i->write_version;
-  return NULL;
+  if (lazyWrites.is_empty())
+    return NULL;
+
+  // the index may hold stale positions after a partial rollback truncated
+  // lazyWrites, so make sure the slot it names still belongs to /shared/
+  long pos = lazyIndex.find(shared);
+  if ((pos < 0) || ((unsigned long)pos >= lazyWrites.size()))
+    return NULL;
+  LazyWriteLog::iterator i = lazyWrites.begin() + pos;
+  return (i->shared == shared) ? i->write_version : NULL;
 }
 
 inline void Descriptor::check_privatizer_clock() {
@@ -939,39 +1329,60 @@ inline void Descriptor::check_privatizer_clock() {
 
 inline Descriptor::Descriptor(std::string dynamic_cm, std::string validation,
                               bool _use_static_cm)
-  : id_mask(0),
+  : vis_token(-1),
     cm(_use_static_cm, dynamic_cm),         // set up CM
     retryHandle(new stm::RetryMechanism::RetryHandle()),
     mm(),                       // set up the DeferredReclamationMMPolicy
     conflicts(),                                // construct bookkeeping
-    invisibleReads(64), visibleReads(64),       // fields that depend on
-    eagerWrites(64), lazyWrites(64), setjmp_buf(64),           // the heap
-    num_commits(0), num_aborts(0), num_retrys(0)
+    writeBatch(16),
+    logArena(),                                 // fields that depend on
+    invisibleReads(logArena, 64),               // the heap
+    visibleReads(logArena, 64),
+    eagerWrites(logArena, 64), lazyWrites(logArena, 64),
+    lazyIndex(64),
+    abort_cause(stm::TxStats::ABORT_OTHER)
 {
   // the state is stm::COMMITTED, in tx #0
   tx_state = stm::COMMITTED;
+  rt_task = NULL;
+  rt_begun = false;
 
 #ifdef STM_PRIV_NONBLOCKING
   privatizer_clock_cache = privatizer_clock;
 #endif
   isVisible = false;
   // try to become visible... this should change eventually
-  if (validation == "vis-eager" || validation == "vis-lazy") {
-    int myToken = readbits.get_token(this);
-    if (myToken != -1) {
-      id_mask = 1 << myToken;
+  if (validation == "vis-eager" || validation == "vis-lazy" ||
+      validation == "vis-adapt") {
+    vis_token = readbits.get_token(this);
+    if (vis_token != -1)
       isVisible = true;
-    }
   }
 
-  // for now, the acquire rule is boolean; 1=eager
-  isLazy = !(validation == "invis-eager" || validation == "vis-eager");
+  // for now, the acquire rule is boolean; 1=eager.  Adaptive sites start
+  // eager, and so does anything that doesn't name its site
+  adaptive = (validation == "invis-adapt" || validation == "vis-adapt");
+  isLazy = !(validation == "invis-eager" || validation == "vis-eager" ||
+             adaptive);
+  defaultLazy = isLazy;
+  site = NULL;
 
   // set up retry handle
   retryImpl.init_thread(retryHandle);
 
   // initialize nesting depth
   nesting_depth = 0;
+
+  snapshotMode = false;
+  snapshot = 0;
+  snapshotFailures = 0;
+
+  stats.registerThread();
+
+#if defined(STM_ROLLBACK_SETJMP)
+  setjmp_buf = NULL;
+  num_checkpoints = 0;
+#endif
 }
 
 /************************** SH-START *********************************/
@@ -981,40 +1392,61 @@ inline Descriptor::Descriptor(std::string dynamic_cm, std::string validation,
 
 inline Descriptor::Descriptor(std::string dynamic_cm, std::string validation,
                               bool _use_static_cm, void* t_args)
-  : id_mask(0),
+  : vis_token(-1),
 /************ cm is changed here *****************/
     cm(_use_static_cm, dynamic_cm, t_args),         // set up CM
     retryHandle(new stm::RetryMechanism::RetryHandle()),
     mm(),                       // set up the DeferredReclamationMMPolicy
     conflicts(),                                // construct bookkeeping
-    invisibleReads(64), visibleReads(64),       // fields that depend on
-    eagerWrites(64), lazyWrites(64), setjmp_buf(64),           // the heap
-    num_commits(0), num_aborts(0), num_retrys(0)
+    writeBatch(16),
+    logArena(),                                 // fields that depend on
+    invisibleReads(logArena, 64),               // the heap
+    visibleReads(logArena, 64),
+    eagerWrites(logArena, 64), lazyWrites(logArena, 64),
+    lazyIndex(64),
+    abort_cause(stm::TxStats::ABORT_OTHER)
 {
   // the state is stm::COMMITTED, in tx #0
   tx_state = stm::COMMITTED;
+  rt_task = NULL;
+  rt_begun = false;
 
 #ifdef STM_PRIV_NONBLOCKING
   privatizer_clock_cache = privatizer_clock;
 #endif
   isVisible = false;
   // try to become visible... this should change eventually
-  if (validation == "vis-eager" || validation == "vis-lazy") {
-    int myToken = readbits.get_token(this);
-    if (myToken != -1) {
-      id_mask = 1 << myToken;
+  if (validation == "vis-eager" || validation == "vis-lazy" ||
+      validation == "vis-adapt") {
+    vis_token = readbits.get_token(this);
+    if (vis_token != -1)
       isVisible = true;
-    }
   }
 
-  // for now, the acquire rule is boolean; 1=eager
-  isLazy = !(validation == "invis-eager" || validation == "vis-eager");
+  // for now, the acquire rule is boolean; 1=eager.  Adaptive sites start
+  // eager, and so does anything that doesn't name its site
+  adaptive = (validation == "invis-adapt" || validation == "vis-adapt");
+  isLazy = !(validation == "invis-eager" || validation == "vis-eager" ||
+             adaptive);
+  defaultLazy = isLazy;
+  site = NULL;
 
   // set up retry handle
   retryImpl.init_thread(retryHandle);
 
   // initialize nesting depth
   nesting_depth = 0;
+
+  snapshotMode = false;
+  snapshot = 0;
+  snapshotFailures = 0;
+
+  stats.registerThread();
+
+#if defined(STM_ROLLBACK_SETJMP)
+  setjmp_buf = NULL;
+  num_checkpoints = 0;
+#endif
 }
 /************************** SH-END *********************************/
 
@@ -1028,28 +1460,35 @@ inline Descriptor::~Descriptor() {
  *             nested or not.  If it is nested, then we don't rollback, and we
  *             should rethrow the exception that caused us to land here.
  */
-inline void Descriptor::rollback(SharedHandle* sh) {
+inline void Descriptor::rollback() {
   // we'd better be aborted if we're here
   assert(tx_state == stm::ABORTED);
-  num_aborts++;
+  countAbort();
+
+  if (snapshotMode) {
+    snapshotMode = false;
+    snapshotFailures++;
+  }
+
+  // a retry chooses again; anything else starts from the default
+  if (site) {
+    advisor.onAbort(site);
+    site = NULL;
+    isLazy = defaultLazy;
+  }
 
   // notify CM
   cm.onTxAborted();
 
   // at the end of a transaction, we are supposed to restore the headers of any
   // objects that we acquired
-  cleanupLazyWrites(stm::ABORTED,sh);
-  cleanupEagerWrites(stm::ABORTED,sh);
+  cleanupLazyWrites(stm::ABORTED);
+  cleanupEagerWrites(stm::ABORTED);
 
   // clean up read sets: uninstall myself from any objects I have open for
   // reading visibly, null out my invis read list
-  cleanupVisReads(sh);
-  cleanupInvisRead(sh);
-
-  // if using CHECKPOINTING
-#if defined(STM_ROLLBACK_SETJMP)
-  cleanupCheckpoints(sh);
-#endif
+  cleanupVisReads();
+  invisibleReads.reset();
 
   // commit memory changes and reset memory logging
   mm.onTxEnd(stm::ABORTED);
@@ -1058,18 +1497,26 @@ inline void Descriptor::rollback(SharedHandle* sh) {
   inev.onEndTx();
 }
 
-inline void Descriptor::rollback() {
-	rollback(NULL);
-}
-
 inline void Descriptor::commit() {
   // only try to commit if we are still stm::ACTIVE and at the end of the
   // outermost transaction
   if (nesting_depth > 1) {
+#if defined(STM_ROLLBACK_SETJMP)
+    dropCheckpoints(nesting_depth);
+#endif
     nesting_depth--;
     return;
   }
 
+#if defined(STM_ROLLBACK_SETJMP)
+  // once we start acquiring and validating for commit, a conflict means
+  // starting over
+  num_checkpoints = 0;
+#endif
+
+  // cleanup empties the write set, so size it for the advisor now
+  unsigned long writes = eagerWrites.size() + lazyWrites.size();
+
   if (tx_state != stm::ACTIVE)
     abort();
 
@@ -1084,19 +1531,40 @@ inline void Descriptor::commit() {
     inev.onInevCommit();
     retryImpl.onCommit(eagerWrites, lazyWrites);
   }
+  else if (snapshotMode) {
+    // nothing to validate, acquire or clean up: if no writer has committed
+    // since our snapshot, everything we opened is still current
+    if (commits_started != snapshot)
+      abort(stm::TxStats::ABORT_VALIDATION);
+    tx_state = stm::COMMITTED;
+    cm.onTxCommitted();
+    stats.inc(stm::TxStats::SNAPSHOT_COMMITS);
+  }
   else {
     // acquire objects that were open_RW'd lazily
     if (isLazy)
       acquireLazily();
 
     // validate if necessary
-    if (!conflicts.tryCommit()) {
+    bool skipValidation = conflicts.tryCommit();
+#if defined(STM_COMMIT_TIMESTAMP)
+    // readers must see our timestamp as soon as they can see our versions
+    stampWrites(conflicts.commitTime());
+#endif
+    if (!skipValidation) {
       verifyInvisReads();
       conflicts.forceCommit();
     }
 
-    // cas status to commit; if this cas fails then I've been aborted
-    if (!bool_cas(&(tx_state), stm::ACTIVE, stm::COMMITTED))
+    // cas status to commit; if this cas fails then I've been aborted.  A
+    // writer brackets the cas with the snapshot counters (see snapshotMode)
+    bool wrote = !eagerWrites.is_empty() || !lazyWrites.is_empty();
+    if (wrote)
+      fai(&commits_started);
+    bool committed = bool_cas(&(tx_state), stm::ACTIVE, stm::COMMITTED);
+    if (wrote)
+      fai(&commits_finished);
+    if (!committed)
       abort();
 
     cm.onTxCommitted();
@@ -1112,56 +1580,57 @@ inline void Descriptor::commit() {
     // reading visibly, null out my invis read list
     cleanupVisReads();
     invisibleReads.reset();
-    removeCheckpoints();
   }
 
+  // our in-place writes are permanent now
+  undoLog.reset();
+
   // commit memory changes and reset memory logging
   mm.onTxEnd(stm::COMMITTED);
 
   // exit inevitability
   inev.onEndTx();
 
-  ++num_commits;
-  --nesting_depth;
-}
+  if (site) {
+    advisor.onCommit(site, writes);
+    site = NULL;
+    isLazy = defaultLazy;
+  }
 
-// for each visible reader, we must remove the reader from the objects up to sh once that
-// is done, we can reset the vis_reads list
-inline void Descriptor::cleanupVisReads(SharedHandle* sh) {
-	unsigned long num_rem_elem=0;
-	unsigned long cur_size=visibleReads.size();
-	for (VisReadLog::iterator i = visibleReads.end()-1,
-	         e = visibleReads.begin(); i >= e; --i){
-		removeVisibleReader(*i);
-		num_rem_elem++;
-		if(*i==sh){
-			//Used for CHECKPOINTING
-			break;
-		}
-	}
-  visibleReads.resize(cur_size-num_rem_elem);
+  snapshotMode = false;
+  snapshotFailures = 0;
+  rt_begun = false;
+  stats.inc(stm::TxStats::COMMITS);
+  --nesting_depth;
 }
 
 // for each visible reader, we must remove the reader from the object once that
 // is done, we can reset the vis_reads list
 inline void Descriptor::cleanupVisReads() {
-	cleanupVisReads(NULL);
+  for (VisReadLog::iterator i = visibleReads.begin(),
+         e = visibleReads.end(); i != e; ++i)
+    removeVisibleReader(*i);
+  visibleReads.reset();
 }
 
 inline void Descriptor::verifyInvisReads() {
+  stats.inc(stm::TxStats::VALIDATIONS);
+  stats.add(stm::TxStats::VALIDATED_ENTRIES, invisibleReads.size());
   for (InvisReadLog::iterator i = invisibleReads.begin(),
          e = invisibleReads.end(); i != e; ++i)
     if (!isCurrent(i->shared, i->read_version))
-      abort();
+      abortToCheckpoint(i - invisibleReads.begin(), ~0UL);
 }
 
 inline void Descriptor::addValidateInvisRead(SharedHandle* shared,
                                              Object* version) {
+  stats.inc(stm::TxStats::VALIDATIONS);
+  stats.add(stm::TxStats::VALIDATED_ENTRIES, invisibleReads.size());
   for (InvisReadLog::iterator i = invisibleReads.begin(),
          e = invisibleReads.end(); i != e; ++i)
   {
     if (!isCurrent(i->shared, i->read_version))
-      abort();
+      abortToCheckpoint(i - invisibleReads.begin(), ~0UL);
     else if (i->shared == shared)
       return;
   }
@@ -1175,13 +1644,26 @@ inline void Descriptor::verifyLazyWrites() {
   if (lazyWrites.is_empty())
     return;
 
+  stats.add(stm::TxStats::VALIDATED_ENTRIES, lazyWrites.size());
   for (LazyWriteLog::iterator i = lazyWrites.begin(),
          e = lazyWrites.end(); i != e; ++i)
     if (!isCurrent(i->shared, i->read_version))
-      abort();
+      abortToCheckpoint(~0UL, i - lazyWrites.begin());
 }
 
 // acquire all objects lazily opened for writing
+#if defined(STM_COMMIT_TIMESTAMP)
+inline void Descriptor::stampWrites(unsigned long end_time) {
+  for (EagerWriteLog::iterator i = eagerWrites.begin(),
+         e = eagerWrites.end(); i != e; ++i)
+    i->shared->m_version = end_time;
+
+  for (LazyWriteLog::iterator i = lazyWrites.begin(),
+         e = lazyWrites.end(); i != e; ++i)
+    i->shared->m_version = end_time;
+}
+#endif
+
 inline void Descriptor::acquireLazily() {
   // Leave this in to short circuit when there's nothing to acquire. Normally
   // just let the for loop handle this.
@@ -1193,78 +1675,48 @@ inline void Descriptor::acquireLazily() {
   {
     assert(!i->isAcquired);
     if (!lazyAcquire(i->shared, i->read_version, i->write_version))
-      abort();
+      abort(stm::TxStats::ABORT_WAW);
     i->isAcquired = true;
   }
 }
 
-// after COMMIT/ABORT, cleanup headers of all objects up to sh that we acquired/cloned
+// after COMMIT/ABORT, cleanup headers of all objects that we acquired/cloned
 // lazily
-inline void Descriptor::cleanupLazyWrites(unsigned long tx_state,SharedHandle* sh) {
-	unsigned long num_rem_elem=0;	//number of removed elements of lazyWrites
-	unsigned long cur_size=lazyWrites.size();	//Initial size of lazyWrites
+inline void Descriptor::cleanupLazyWrites(unsigned long tx_state) {
   if (tx_state == stm::ABORTED) {
-	  for (LazyWriteLog::iterator i = lazyWrites.end()-1,
-	             e = lazyWrites.begin(); i >= e; --i){
-    	if (i->isAcquired){
-    		CleanOnAbort(i->shared, i->write_version, i->read_version);
-    	}
-    	num_rem_elem++;
-    	if(i->shared==sh){
-    		//Used for CHECKPOINTING
-    		break;
-    	}
-    }
+    for (LazyWriteLog::iterator i = lazyWrites.begin(),
+           e = lazyWrites.end(); i != e; ++i)
+      if (i->isAcquired)
+        CleanOnAbort(i->shared, i->write_version, i->read_version);
   }
   else {
-	  //No need to perform CHECKPOINTING for the COMMITTED case
     assert(tx_state == stm::COMMITTED);
     for (LazyWriteLog::iterator i = lazyWrites.begin(),
-           e = lazyWrites.end(); i != e; ++i){
-    	CleanOnCommit(i->shared, i->write_version);
-    	num_rem_elem++;
-    }
+           e = lazyWrites.end(); i != e; ++i)
+      CleanOnCommit(i->shared, i->write_version);
   }
-  lazyWrites.resize(cur_size-num_rem_elem);
-}
-
-// after COMMIT/ABORT, cleanup headers of all objects that we acquired/cloned
-// lazily
-inline void Descriptor::cleanupLazyWrites(unsigned long tx_state) {
-	cleanupLazyWrites(tx_state,NULL);
+  lazyWrites.reset();
+  lazyIndex.reset();
 }
 
 // after COMMIT/ABORT, cleanup headers of all objects that we acquired/cloned
 // eagerly
-inline void Descriptor::cleanupEagerWrites(unsigned long tx_state, SharedHandle* sh)
-{
-	unsigned long num_rem_elem=0;	//Number of removed elements
-	unsigned long cur_size=eagerWrites.size();	//Initial size of eagerWrites
+inline void Descriptor::cleanupEagerWrites(unsigned long tx_state) {
   if (tx_state == stm::ABORTED) {
-	  for (EagerWriteLog::iterator i = eagerWrites.end()-1,
-	             e = eagerWrites.begin(); i >= e; --i){
-		  CleanOnAbort(i->shared, i->write_version, i->read_version);
-		  num_rem_elem++;
-		  if(i->shared==sh){
-			  //Used for CHECKPOINTING
-			  break;
-		  }
-	  }
+    // put back the fields we wrote in place before anyone can see the old
+    // versions again
+    undoLog.undo();
+    for (EagerWriteLog::iterator i = eagerWrites.begin(),
+           e = eagerWrites.end(); i != e; ++i)
+      CleanOnAbort(i->shared, i->write_version, i->read_version);
   }
-  //No need to perform CHECKPOINTING on COMMIT
   else {
     assert(tx_state == stm::COMMITTED);
     for (EagerWriteLog::iterator i = eagerWrites.begin(),
-           e = eagerWrites.end(); i != e; ++i){
-    	CleanOnCommit(i->shared, i->write_version);
-    	num_rem_elem++;
-    }
+           e = eagerWrites.end(); i != e; ++i)
+      CleanOnCommit(i->shared, i->write_version);
   }
-  eagerWrites.resize(cur_size-num_rem_elem);
-}
-
-inline void Descriptor::cleanupEagerWrites(unsigned long tx_state){
-	cleanupEagerWrites(tx_state,NULL);
+  eagerWrites.reset();
 }
 
 inline bool Descriptor::isCurrent(const SharedHandle* header,
@@ -1290,31 +1742,27 @@ inline bool Descriptor::lazyAcquire(SharedHandle* header,
   // while loop to retry if cannot abort visible readers yet
   while (true) {
     // check if we can abort visible readers, restart loop on failure
-    unsigned int index = 0;
-    unsigned int bits = header->m_readers;
     bool canAbortAll = true;
 
-    while (bits) {
-      if (bits & 1) {
-        Descriptor* reader = readbits.lookup(index);
-
-        if (reader != this) {
-          // if can't abort this reader, return false
-          stm::ConflictResolutions r = cm.onWAR(reader->cm.getCM());
-          if (r == stm::AbortSelf)
-            abort();
-          if (r != stm::AbortOther) {
-            canAbortAll = false;
-            break;
-          }
+    for (int index = header->m_readers.next(0); index != -1;
+         index = header->m_readers.next(index + 1))
+    {
+      Descriptor* reader = readbits.lookup(index);
+
+      if (reader != this) {
+        // if can't abort this reader, return false
+        stm::ConflictResolutions r = decided(cm.onWAR(reader->cm.getCM()));
+        if (r == stm::AbortSelf)
+          abort(stm::TxStats::ABORT_WAR);
+        if (r != stm::AbortOther) {
+          canAbortAll = false;
+          break;
         }
       }
-      bits >>= 1;
-      index++;
     }
 
     if (!canAbortAll) {
-      cm.onContention();
+      backoff();
       verifySelf();
       continue;
     }
@@ -1346,15 +1794,9 @@ inline bool Descriptor::CleanOnAbort(SharedHandle* header,
 
 inline void Descriptor::removeVisibleReader(SharedHandle* const header) const
 {
-  // don't bother with the CAS if we're not in the bitmap
-  if (header->m_readers & id_mask) {
-    unsigned long obj_mask;
-    do {
-      obj_mask = header->m_readers;
-    }
-    while (!bool_cas(&header->m_readers, obj_mask, obj_mask & (~id_mask)))
-      /* intentionally empty, spinning on failure */;
-  }
+  // the reader set doesn't bother with the CAS if we're not in it
+  if (vis_token != -1)
+    header->m_readers.remove(vis_token);
 }
 
 
@@ -1368,43 +1810,35 @@ inline bool Descriptor::SwapHeader(SharedHandle* header, Object* expected,
 }
 
 inline bool Descriptor::installVisibleReader(SharedHandle* header) {
-  if (header->m_readers & id_mask)
-    return false;
-  unsigned long obj_mask;
-  do {
-    obj_mask = header->m_readers;
-  }
-  while (!bool_cas(&header->m_readers, obj_mask, obj_mask | id_mask));
-  return true;
+  return header->m_readers.install(vis_token);
 }
 
 inline void Descriptor::abortVisibleReaders(SharedHandle* header) {
-  unsigned long tmp_reader_bitmap = header->m_readers;
-  unsigned long desc_array_index = 0;
-
-  while (tmp_reader_bitmap) {
-    if (tmp_reader_bitmap & 1) {
-      Descriptor* reader = readbits.lookup(desc_array_index);
-      // abort only if the reader exists, is stm::ACTIVE, and isn't me
-      if (reader && reader != this) {
-        if (reader->tx_state == stm::ACTIVE)
-          bool_cas(&reader->tx_state, stm::ACTIVE, stm::ABORTED);
+  for (int index = header->m_readers.next(0); index != -1;
+       index = header->m_readers.next(index + 1))
+  {
+    Descriptor* reader = readbits.lookup(index);
+    // abort only if the reader exists, is stm::ACTIVE, and isn't me
+    if (reader && reader != this) {
+      if (reader->tx_state == stm::ACTIVE) {
+        reader->abort_cause = stm::TxStats::ABORT_VISREADER;
+        bool_cas(&reader->tx_state, stm::ACTIVE, stm::ABORTED);
       }
     }
-    tmp_reader_bitmap >>= 1;
-    desc_array_index++;
   }
 }
 
 inline void Descriptor::release(SharedHandle* const obj)
 {
-  // NB: no need to check if I own this in my eager or lazy writeset; that's
-  // orthogonal to whether it's in my read set ... but that will change if lazy
-  // writers can be visible
+  // NB: no need to check if I own this in my eager writeset; that's
+  // orthogonal to whether it's in my read set.  A lazy write, however, is
+  // validated through its read_version until commit, so it can't be released.
+  if (lookupLazyWrite(obj))
+    return;
 
   // branch based on whether this is a visible read or not
-  if ((obj->m_readers & id_mask) != 0) {
-    // I'm a vis reader: remove self from the visible reader bitmap and remove
+  if (vis_token != -1 && obj->m_readers.contains(vis_token)) {
+    // I'm a vis reader: remove self from the visible reader set and remove
     // /this/ from my vis read set
     removeVisibleReader(obj);
     removeVisRead(obj);
@@ -1486,6 +1920,10 @@ void thr_init(std::string cm_type, std::string validation,
 void thr_init(std::string cm_type, std::string validation,
               bool use_static_cm,void* t_args);
 
+// Register the real-time task the thread runs, for BEGIN_RT_TRANSACTION
+void thr_init(std::string cm_type, std::string validation,
+              bool use_static_cm,stm::RTTask* task);
+
 void thr_shutdown_nodeb(unsigned long i);//to not print any data when shutting down
 
 vector<unsigned long long> thr_printStatistics();//To only print statistics about the thread when it finishes
@@ -1548,6 +1986,10 @@ Object* open_privatized(SharedHandle* const sh);
 inline void delete_privatized(SharedHandle* sh) {
   currentDescriptor->mm.add(sh);
   currentDescriptor->mm.add(open_privatized(sh));
+  // an in-place version is garbage too once its data object is
+  Object* version = get_data_ptr(sh->m_payload);
+  if (is_inplace(version))
+    currentDescriptor->mm.add(version);
 }
 
 /**
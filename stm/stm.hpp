@@ -105,4 +105,10 @@ namespace stm { typedef CGLThread Descriptor; }
 #   error "Error, no version defined"
 #endif
 
+/** the word-based STMs whose metadata is OrecWBTxThread's orec table */
+#if defined(STM_LIB_LLT) || defined(STM_LIB_ET) || defined(STM_LIB_FAIR) || \
+    defined(STM_LIB_FLOW) || defined(STM_LIB_STRICT) || defined(STM_LIB_SGLA)
+#   define STM_OREC_TABLE
+#endif
+
 #endif // __STM_API_HPP__
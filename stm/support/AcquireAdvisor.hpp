@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005, 2006, 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __ACQUIREADVISOR_HPP__
+#define __ACQUIREADVISOR_HPP__
+
+#include <ostream>
+#include "atomic_ops.h"
+
+namespace stm
+{
+  /**
+   *  One BEGIN_TRANSACTION call site.  The macro declares a static TxSite
+   *  initialized with STM_TX_SITE, which is a constant initializer, so it
+   *  costs nothing to find.  Threads add what they learn about the site to
+   *  its counters once per AcquireAdvisor::EPOCH commits, for the report.
+   *  Index 0 of each array is for eager acquire, index 1 for lazy.
+   */
+  struct TxSite
+  {
+      const char* file;
+      int line;
+
+      /*** every site any thread has used, for the report */
+      TxSite* volatile next;
+      volatile unsigned long registered;
+
+      volatile unsigned long epochs[2];
+      volatile unsigned long commits[2];
+      volatile unsigned long aborts[2];
+      volatile unsigned long writes[2];
+  };
+
+#define STM_TX_SITE { __FILE__, __LINE__ }
+
+  /**
+   *  Per-thread choice of eager or lazy acquire for each transaction site.
+   *
+   *  Every EPOCH commits at a site we score the policy we ran it with by
+   *  its aborts per commit, averaged over the epochs it has had, and pick
+   *  the policy with the lower score for the next epoch.  Lazy acquire has
+   *  to win by a margin that grows with the site's write set, since it
+   *  looks up every open in the lazy write set, revalidates the set with the
+   *  reads, and acquires all of it at commit.  Each policy is retried for an
+   *  epoch every PROBE_EVERY epochs, so a site whose behavior changes can
+   *  switch back.
+   *
+   *  New sites start eager, and try lazy after their first epoch.  Sites
+   *  are kept in a small open-addressed table keyed by TxSite address;
+   *  sites that don't fit just use the Descriptor's default policy.
+   */
+  class AcquireAdvisor
+  {
+    public:
+      struct Record
+      {
+          TxSite*       site;
+          bool          lazy;
+          unsigned long commits;
+          unsigned long aborts;
+          unsigned long writes;
+          unsigned long epochs;
+
+          /*** aborts per commit for each policy, in 1/16ths */
+          unsigned long score[2];
+      };
+
+      static const unsigned long SLOTS       = 64;
+      static const unsigned long EPOCH       = 32;
+      static const unsigned long PROBE_EVERY = 8;
+      static const unsigned long UNKNOWN     = ~0UL;
+
+    private:
+      Record table[SLOTS];
+
+      /*** head of the list of every registered site */
+      static TxSite* volatile sites;
+
+      static void registerSite(TxSite* s)
+      {
+          if (s->registered || !bool_cas(&s->registered, 0, 1))
+              return;
+          while (true) {
+              TxSite* head = sites;
+              s->next = head;
+              if (bool_cas((volatile unsigned long*)&sites,
+                           (unsigned long)head, (unsigned long)s))
+                  return;
+          }
+      }
+
+    public:
+      AcquireAdvisor()
+      {
+          for (unsigned long i = 0; i < SLOTS; i++)
+              table[i].site = NULL;
+      }
+
+      /*** find the record for /s/, or make one; NULL if the table is full */
+      Record* find(TxSite* s)
+      {
+          unsigned long h = ((unsigned long)s >> 4) % SLOTS;
+          for (unsigned long i = 0; i < SLOTS; i++) {
+              Record* r = &table[(h + i) % SLOTS];
+              if (r->site == s)
+                  return r;
+              if (r->site == NULL) {
+                  r->site = s;
+                  r->lazy = false;
+                  r->commits = r->aborts = r->writes = r->epochs = 0;
+                  r->score[0] = r->score[1] = UNKNOWN;
+                  registerSite(s);
+                  return r;
+              }
+          }
+          return NULL;
+      }
+
+      void onAbort(Record* r) { r->aborts++; }
+
+      void onCommit(Record* r, unsigned long writes)
+      {
+          r->writes += writes;
+          if (++r->commits == EPOCH)
+              endEpoch(r);
+      }
+
+      /**
+       *  Write one row (CSV) or object (JSON) per site: epochs, commits,
+       *  aborts and average write set size under each policy, and the
+       *  policy that most epochs ran with.
+       */
+      static void dump(std::ostream& os, bool json)
+      {
+          if (json)
+              os << "{\"sites\": [";
+          else
+              os << "site,eager_epochs,eager_commits,eager_aborts,"
+                 << "lazy_epochs,lazy_commits,lazy_aborts,avg_writes,policy"
+                 << std::endl;
+          bool first = true;
+          for (TxSite* s = sites; s != NULL; s = s->next) {
+              unsigned long c = s->commits[0] + s->commits[1];
+              double w = c ? (double)(s->writes[0] + s->writes[1]) / c : 0;
+              const char* policy =
+                  (s->epochs[1] > s->epochs[0]) ? "lazy" : "eager";
+              if (json) {
+                  os << (first ? "\n  " : ",\n  ")
+                     << "{\"site\": \"" << s->file << ":" << s->line << "\", "
+                     << "\"eager_epochs\": " << s->epochs[0] << ", "
+                     << "\"eager_commits\": " << s->commits[0] << ", "
+                     << "\"eager_aborts\": " << s->aborts[0] << ", "
+                     << "\"lazy_epochs\": " << s->epochs[1] << ", "
+                     << "\"lazy_commits\": " << s->commits[1] << ", "
+                     << "\"lazy_aborts\": " << s->aborts[1] << ", "
+                     << "\"avg_writes\": " << w << ", "
+                     << "\"policy\": \"" << policy << "\"}";
+              }
+              else {
+                  os << s->file << ":" << s->line << ","
+                     << s->epochs[0] << "," << s->commits[0] << ","
+                     << s->aborts[0] << "," << s->epochs[1] << ","
+                     << s->commits[1] << "," << s->aborts[1] << ","
+                     << w << "," << policy << std::endl;
+              }
+              first = false;
+          }
+          if (json)
+              os << "\n]}" << std::endl;
+      }
+
+    private:
+      void endEpoch(Record* r)
+      {
+          int p = r->lazy ? 1 : 0;
+          TxSite* s = r->site;
+          fai(&s->epochs[p]);
+          faa(&s->commits[p], r->commits);
+          faa(&s->aborts[p], r->aborts);
+          faa(&s->writes[p], r->writes);
+
+          unsigned long score = (r->aborts * 16) / r->commits;
+          if (r->score[p] == UNKNOWN)
+              r->score[p] = score;
+          else
+              r->score[p] = (r->score[p] + score) / 2;
+
+          // lazy must save at least 1/16 abort per commit per object in
+          // the write set
+          unsigned long margin = r->writes / r->commits;
+
+          if ((r->score[1 - p] == UNKNOWN) ||
+              (++r->epochs % PROBE_EVERY) == 0)
+              r->lazy = !r->lazy;
+          else
+              r->lazy = (r->score[1] + margin < r->score[0]);
+
+          r->commits = r->aborts = r->writes = 0;
+      }
+  };
+} // namespace stm
+
+#endif // __ACQUIREADVISOR_HPP__
@@ -93,7 +93,7 @@ class Bloom
         for (int k = 0; k < 2; k++) {
             unsigned index = key[k] / (8*sizeof(unsigned long));
             unsigned bit = key[k] % (8*sizeof(unsigned long));
-            unsigned long mask = 1 << bit;
+            unsigned long mask = 1UL << bit;
             filter[index] |= mask;
         }
     }
@@ -110,7 +110,7 @@ class Bloom
         for (k = 0; k < 2; k++) {
             unsigned index = key[k] / (8*sizeof(unsigned long));
             unsigned bit = key[k] % (8*sizeof(unsigned long));
-            unsigned long mask = 1 << bit;
+            unsigned long mask = 1UL << bit;
             if (!(filter[index] & mask))
                 return false;
         }
@@ -132,7 +132,7 @@ class Bloom
         for (int k = 0; k < 3; k++) {
             unsigned index = key[k] / (8*sizeof(unsigned long));
             unsigned bit = key[k] % (8*sizeof(unsigned long));
-            unsigned long mask = 1 << bit;
+            unsigned long mask = 1UL << bit;
             filter[index] |= mask;
         }
     }
@@ -153,7 +153,7 @@ class Bloom
         for (k = 0; k < 3; k++) {
             unsigned index = key[k] / (8*sizeof(unsigned long));
             unsigned bit = key[k] % (8*sizeof(unsigned long));
-            unsigned long mask = 1 << bit;
+            unsigned long mask = 1UL << bit;
             if (!(filter[index] & mask))
                 return false;
         }
@@ -184,8 +184,9 @@ class Bloom
         assert((HASHES == 1) || (HASHES == 2) || (HASHES == 3));
         assert(SIZE % (8*sizeof(unsigned long)) == 0);
 
-        if (((unsigned)&true_filter)%16 == 8)
-            filter = &true_filter[2];
+        // skip one 8-byte half of a 16-byte block if we are misaligned
+        if (((unsigned long)&true_filter)%16 == 8)
+            filter = (volatile unsigned long*)((char*)true_filter + 8);
         else
             filter = &true_filter[0];
 #ifdef __SSE__
@@ -138,6 +138,87 @@ namespace stm
       const bool isValidatingInsertSafe() { return false; }
   };
 
+  /**
+   *  Policy for timestamp-based validation with snapshot extension (in the
+   *  spirit of LLT/ET's orec timestamps, but with one version word per RSTM
+   *  object header).  Every writer takes a commit time from a global clock
+   *  and stamps each object it writes with that time before it commits.  A
+   *  reader knows its read set is consistent as of valid_ts, so it only has
+   *  to validate when it opens an object stamped later than valid_ts, and
+   *  then it extends valid_ts to the current time.  Commits by writers that
+   *  don't touch anything we open never force us to validate.
+   */
+  class CommitTimestampValidationPolicy
+  {
+      /*** the global commit clock */
+      static volatile unsigned long
+      timestamp  __attribute__ ((aligned(64)));
+
+      /*** our read set is known to be valid as of this time */
+      unsigned long valid_ts;
+
+      /*** commit time, once a writer has taken one */
+      unsigned long end_time;
+
+      /*** Flag that we set if the current tx writes any objects */
+      bool didRW;
+
+    public:
+      CommitTimestampValidationPolicy()
+          : valid_ts(timestamp), end_time(0), didRW(false) { }
+
+      /**
+       *  Called after opening an object whose last committed writer stamped
+       *  it with /version/.  If the object is newer than our snapshot, move
+       *  the snapshot forward and return true; the caller must then validate
+       *  its whole read set (including the new object).  Reading the clock
+       *  before validating is what makes the extension safe.
+       */
+      bool shouldValidate(unsigned long version)
+      {
+          if (version <= valid_ts)
+              return false;
+
+          valid_ts = timestamp;
+          return true;
+      }
+
+      /**
+       *  Read-only transactions commit at valid_ts without validating.
+       *  Writers take a commit time, and can skip validation only if nobody
+       *  else committed since our last validation.
+       */
+      bool tryCommit()
+      {
+          if (!didRW)
+              return true;
+          end_time = 1 + fai(&timestamp);
+          return (end_time == valid_ts + 1);
+      }
+
+      /*** Time with which a committing writer stamps the objects it wrote */
+      unsigned long commitTime() const { return end_time; }
+
+      /*** Reset everything at the beginning of a transaction. */
+      void onTxBegin()
+      {
+          valid_ts = timestamp;
+          didRW = false;
+      }
+
+      /*** tryCommit() already advanced the clock */
+      void forceCommit() { }
+
+      /*** Event method to update metadata if the current tx has writes. */
+      void onRW() { didRW = true; }
+
+      /**
+       *  Like the commit counter, we must insert before validating, because
+       *  the validation has to cover the object being opened.
+       */
+      const bool isValidatingInsertSafe() { return false; }
+  };
+
   /**
    *  The default validation policy is to do incremental validation every
    *  time we open a new object, and before committing.
@@ -156,6 +237,8 @@ namespace stm
 
 #if defined(STM_COMMIT_COUNTER)
   typedef GlobalCommitCounterValidationPolicy ValidationPolicy;
+#elif defined(STM_COMMIT_TIMESTAMP)
+  typedef CommitTimestampValidationPolicy ValidationPolicy;
 #elif defined(STM_NO_COMMIT_COUNTER)
   typedef DefaultValidationPolicy ValidationPolicy;
 #else
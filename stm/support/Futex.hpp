@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005, 2006, 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __FUTEX_HPP__
+#define __FUTEX_HPP__
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#else
+#include <sched.h>
+#endif
+
+namespace stm
+{
+  /**
+   *  Minimal futex wrappers for parking a thread on an int until another
+   *  thread changes it.  futex_wait() returns at once if *addr != val, and
+   *  may also return spuriously, so callers wait in a loop.  Where there is
+   *  no futex, waiting degrades to yielding.
+   */
+  inline void futex_wait(volatile int* addr, int val)
+  {
+#if defined(__linux__)
+      syscall(SYS_futex, (int*)addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+      if (*addr == val)
+          sched_yield();
+#endif
+  }
+
+  inline void futex_wake(volatile int* addr, int count)
+  {
+#if defined(__linux__)
+      syscall(SYS_futex, (int*)addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#endif
+  }
+
+  /**
+   *  A one-shot handoff built on a futex word: the waiter arms it, hands
+   *  the word to someone, and wait()s; that someone calls signal().  The
+   *  waiter spins briefly first, and the signaller only makes the wake
+   *  system call if the waiter actually went to sleep.
+   */
+  struct FutexFlag
+  {
+      enum { DONE = 0, PENDING = 1, SLEEPING = 2 };
+
+      volatile int word;
+
+      FutexFlag() : word(DONE) { }
+
+      void arm() { word = PENDING; }
+
+      bool pending() const { return word != DONE; }
+
+      void wait(int spins = 256)
+      {
+          for (int i = 0; i < spins; i++)
+              if (word == DONE)
+                  return;
+          while (word != DONE) {
+              if (__sync_bool_compare_and_swap(&word, PENDING, SLEEPING) ||
+                  (word == SLEEPING))
+                  futex_wait(&word, SLEEPING);
+          }
+      }
+
+      void signal()
+      {
+          if (__sync_lock_test_and_set(&word, DONE) == SLEEPING)
+              futex_wake(&word, 1);
+      }
+  };
+} // namespace stm
+
+#endif // __FUTEX_HPP__
@@ -0,0 +1,197 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005, 2006, 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STM_SUPPORT_LOGINDEX_HPP__
+#define STM_SUPPORT_LOGINDEX_HPP__
+
+#include <algorithm>                    // std::fill
+#include <cassert>
+
+namespace stm
+{
+  /**
+   *  Open-addressed hash index from a pointer key to a position in some
+   *  external, append-only log (for example, the lazy write set of an RSTM
+   *  Descriptor).  The index does not own the log; it just remembers where
+   *  each key was inserted so that lookups are O(1) instead of a walk over
+   *  the log.
+   *
+   *  Like stm::WriteSet, every slot carries a version number, so reset() is
+   *  O(1): bumping the version logically empties the table.
+   *
+   *  The index never removes individual entries.  Callers are expected to
+   *  check that the position returned by find() still refers to the key
+   *  (i.e. that the log wasn't truncated underneath us).  This lets a log
+   *  be truncated to an arbitrary point (e.g. partial rollback) without
+   *  touching the index at all.
+   */
+  class LogIndex
+  {
+    public:
+      LogIndex(const size_t initial_capacity)
+          : index(NULL),
+            shift(32),
+            ilength(0),
+            version(1),                 // don't start with version 0
+            count(0)
+      {
+          // Find a good index length for the initial capacity of the log.
+          while (ilength < 3 * initial_capacity)
+              doubleIndexLength();
+
+          index = new index_t[ilength];
+      }
+
+      ~LogIndex() { delete[] index; }
+
+      /**
+       *  Return the log position recorded for /key/, or -1 if /key/ isn't in
+       *  the index.
+       */
+      long find(const void* const key) const
+      {
+          size_t h = hash(key);
+
+          while (index[h].version == version)
+              if (index[h].key == key)
+                  return (long)index[h].pos;
+              else
+                  h = (h + 1) & (ilength - 1);
+
+          return -1;
+      }
+
+      /**
+       *  Record that /key/ lives at /pos/ in the log.  If the key is already
+       *  present (e.g. a stale entry left behind by a truncation), its
+       *  position is simply overwritten.
+       */
+      void insert(const void* const key, const size_t pos)
+      {
+          size_t h = hash(key);
+
+          while (index[h].version == version) {
+              if (index[h].key == key) {
+                  index[h].pos = pos;
+                  return;
+              }
+              h = (h + 1) & (ilength - 1);
+          }
+
+          index[h].key     = key;
+          index[h].version = version;
+          index[h].pos     = pos;
+
+          // keep the load factor under 1/3; stale entries count against it
+          // until the next reset()
+          if ((++count * 3) >= ilength)
+              rebuild();
+      }
+
+      /*** Logically empty the index in O(1) */
+      void reset()
+      {
+          count    = 0;
+          version += 1;
+
+          // check overflow
+          if (version == 0) {
+              std::fill(index, index + ilength, index_t());
+              version = 1;
+          }
+      }
+
+    private:
+      // This doubles the size of the index. This *does not* do anything as
+      // far as actually doing memory allocation. Callers should delete[] the
+      // index table, increment the table size, and then reallocate it.
+      size_t doubleIndexLength()
+      {
+          assert(shift != 0 &&
+                 "ERROR: the log index doesn't support an index this large");
+          shift   -= 1;
+          ilength  = (size_t)1 << (32 - shift);
+          return ilength;
+      }
+
+      // Knuth's multiplicative hash, as in stm::WriteSet.  We always take the
+      // top bits of a 32-bit product, so the index behaves the same whether
+      // pointers are 4 or 8 bytes wide.
+      size_t hash(const void* const key) const
+      {
+          static const unsigned long long s = 2654435769ull;
+          const unsigned long long r = ((unsigned long)key) * s;
+          return (r & 0xFFFFFFFF) >> shift;
+      }
+
+      // double the table and re-insert every live entry
+      void rebuild()
+      {
+          assert(version != 0 && "ERROR: the version should *never* be 0");
+
+          index_t* old     = index;
+          size_t   oldlen  = ilength;
+          index = new index_t[doubleIndexLength()];
+
+          for (size_t i = 0; i < oldlen; ++i) {
+              if (old[i].version != version)
+                  continue;
+
+              size_t h = hash(old[i].key);
+              while (index[h].version == version)
+                  h = (h + 1) & (ilength - 1);
+              index[h] = old[i];
+          }
+
+          delete[] old;
+      }
+
+      struct index_t
+      {
+          size_t      version;
+          const void* key;
+          size_t      pos;
+
+          index_t() : version(0), key(NULL), pos(0) { }
+      };
+
+      index_t* index;
+      size_t   shift;
+      size_t   ilength;
+      size_t   version;
+      size_t   count;
+  };
+}
+
+#endif // STM_SUPPORT_LOGINDEX_HPP__
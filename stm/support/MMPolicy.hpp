@@ -262,6 +262,22 @@ namespace stm
           trans_nums[id*16]++;
       }
 
+      /**
+       *  Event method on partial rollback to a checkpoint
+       *  Forget the deletes requested since the checkpoint, and treat what
+       *  we allocated since then as if that part of the transaction had
+       *  aborted.  Other threads may have seen those clones, so they still
+       *  go through the reclaimer.
+       */
+      void onRollbackTo(unsigned long commit_mark, unsigned long abort_mark)
+      {
+          deleteOnCommit.resize(commit_mark);
+          for (DeleteList::iterator i = deleteOnAbort.begin() + abort_mark;
+               i != deleteOnAbort.end(); i++)
+              add(*i);
+          deleteOnAbort.resize(abort_mark);
+      }
+
       /**
        * Block until every transaction has either committed, aborted, or
        * validated.
@@ -0,0 +1,258 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+//=============================================================================
+// Read-set filters for LLT
+//=============================================================================
+//   LLT logs an orec for every read and, unless its commit time shows no
+//   other writer committed, walks the whole log at commit.  The log keeps
+//   duplicates, so a long transaction that keeps returning to the same
+//   nodes validates them over and over.  Chosen with STM_READSET_* in
+//   config.h:
+//
+//     STM_READSET_LIST     log every read (the original behavior)
+//
+//     STM_READSET_FILTER   keep a Bloom filter of the orecs logged.  A miss
+//                          means the orec is new; a hit is confirmed
+//                          against the last STM_READSET_WINDOW entries of
+//                          the log, and the read is logged again if it is
+//                          not there, so a false positive costs a short
+//                          scan and never a missed orec
+//
+//     STM_READSET_SUMMARY  the filter, plus a summary for commit: orecs are
+//                          grouped into STM_READSET_BUCKETS buckets, each
+//                          with a global count of the locks ever taken on
+//                          its orecs.  A transaction copies a bucket's
+//                          count the first time it reads an orec in it.  If
+//                          no bucket it read from has a new lock since,
+//                          none of its orecs can have changed, and commit
+//                          skips the walk.  Otherwise it walks the log as
+//                          before.
+//
+//   The summary costs each lock one more fetch-and-add, on a line shared
+//   with other buckets, and a writer counts its own locks into its copies.
+//   The add comes after the lock: a validator that still sees the old
+//   count could equally have skipped validation on its commit time, since
+//   the writer has not taken its own commit time yet.
+//
+//   Compare on long, read-mostly transactions, e.g.
+//
+//     Bench -B LinkedList  -m 256 -R 80 -p $p
+//     Bench -B RandomGraph -m 256 -R 80 -p $p
+//
+//   built once per STM_READSET_* setting.  With a filter, each thread's
+//   shutdown line also gives the duplicate reads it dropped and the
+//   commit validations it skipped.
+//=============================================================================
+
+#ifndef __READSETFILTER_HPP__
+#define __READSETFILTER_HPP__
+
+#include "atomic_ops.h"
+#include "Bloom.hpp"
+
+#if !defined(STM_READSET_LIST) && !defined(STM_READSET_FILTER) &&       \
+    !defined(STM_READSET_SUMMARY)
+#define STM_READSET_LIST
+#endif
+
+/*** bits in the duplicate filter (a multiple of 128) */
+#ifndef STM_READSET_FILTER_BITS
+#define STM_READSET_FILTER_BITS 4096
+#endif
+
+/*** log entries a filter hit is checked against */
+#ifndef STM_READSET_WINDOW
+#define STM_READSET_WINDOW 8
+#endif
+
+/*** summary buckets (a power of two, and a multiple of 128) */
+#ifndef STM_READSET_BUCKETS
+#define STM_READSET_BUCKETS 1024
+#endif
+
+namespace stm
+{
+  /*** STM_READSET_LIST: no filtering */
+  struct ReadSetList
+  {
+      struct Global { };
+
+      static Global globals;
+
+      unsigned long dropped;   // duplicate reads not logged
+      unsigned long skipped;   // commit validations avoided
+
+      ReadSetList() : dropped(0), skipped(0) { }
+
+      template <class List>
+      bool logged(unsigned long idx, const void* o, List& reads) { return false; }
+      void onRead(unsigned long idx) { }
+      void onLock(unsigned long idx) { }
+      bool unchanged() { return false; }
+      void reset() { }
+  };
+
+  /**
+   *  STM_READSET_FILTER and STM_READSET_SUMMARY.  Orecs are identified by
+   *  their index in the orec table, which is already spread over the table
+   *  by the orec hash; both filters are keyed by it.
+   */
+  class ReadSetBloom
+  {
+    public:
+      struct Global
+      {
+          /*** locks taken on the orecs of each bucket, ever */
+          volatile unsigned long changes[STM_READSET_BUCKETS];
+
+          Global()
+          {
+              for (int i = 0; i < STM_READSET_BUCKETS; i++)
+                  changes[i] = 0;
+          }
+      };
+
+      static Global globals;
+
+    private:
+      /*** orecs logged this transaction */
+      Bloom<STM_READSET_FILTER_BITS, 1> seen;
+
+#if defined(STM_READSET_SUMMARY)
+      /*** buckets read this transaction, and their counts when first read */
+      Bloom<STM_READSET_BUCKETS, 1> buckets;
+      unsigned long counts[STM_READSET_BUCKETS];
+
+      static unsigned long bucket(unsigned long idx)
+      {
+          return idx & (STM_READSET_BUCKETS - 1);
+      }
+#endif
+
+      /*** Bloom keys drop the low three bits of their argument */
+      static unsigned key(unsigned long idx) { return (unsigned)(idx << 3); }
+
+    public:
+      unsigned long dropped;
+      unsigned long skipped;
+
+      ReadSetBloom() : dropped(0), skipped(0) { }
+
+      /**
+       *  true if the orec o (table index idx) is already in /reads/, so
+       *  this read need not log it again; otherwise the caller logs it
+       */
+      template <class List>
+      bool logged(unsigned long idx, const void* o, List& reads)
+      {
+          if (!seen.lookup(key(idx))) {
+              seen.insert(key(idx));
+              return false;
+          }
+          typename List::iterator b = reads.begin(), i = reads.end();
+          if (i - b > STM_READSET_WINDOW)
+              b = i - STM_READSET_WINDOW;
+          while (i-- != b)
+              if (*i == o) {
+                  dropped++;
+                  return true;
+              }
+          return false;
+      }
+
+      /*** before reading orec idx: copy its bucket's count on first touch */
+      void onRead(unsigned long idx)
+      {
+#if defined(STM_READSET_SUMMARY)
+          unsigned long b = bucket(idx);
+          if (!buckets.lookup(key(b))) {
+              buckets.insert(key(b));
+              counts[b] = globals.changes[b];
+              LWSYNC; // RBR between the count and the orec
+          }
+#endif
+      }
+
+      /*** after locking orec idx */
+      void onLock(unsigned long idx)
+      {
+#if defined(STM_READSET_SUMMARY)
+          unsigned long b = bucket(idx);
+          fai(&globals.changes[b]);
+          // our own lock is not a change to what we read
+          if (buckets.lookup(key(b)))
+              counts[b]++;
+#endif
+      }
+
+      /*** true if no bucket this transaction read from has a new lock */
+      bool unchanged()
+      {
+#if defined(STM_READSET_SUMMARY)
+          const int BITS = 8 * sizeof(unsigned long);
+          for (int w = 0; w < STM_READSET_BUCKETS / BITS; w++) {
+              unsigned long bits = buckets.filter[w];
+              while (bits) {
+                  unsigned long b = w * BITS + __builtin_ctzl(bits);
+                  bits &= bits - 1;
+                  if (globals.changes[b] != counts[b])
+                      return false;
+              }
+          }
+          skipped++;
+          return true;
+#else
+          return false;
+#endif
+      }
+
+      void reset()
+      {
+          seen.reset();
+#if defined(STM_READSET_SUMMARY)
+          buckets.reset();
+#endif
+      }
+  };
+
+#if defined(STM_READSET_LIST)
+  typedef ReadSetList ReadSetPolicy;
+#else
+  typedef ReadSetBloom ReadSetPolicy;
+#endif
+} // namespace stm
+
+#endif // __READSETFILTER_HPP__
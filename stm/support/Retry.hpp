@@ -206,7 +206,7 @@ namespace stm
        *  is the address we care about.
        */
       template <class WS1, class WS2>
-      void onCommit(WS1 ws1, WS2 ws2)
+      void onCommit(const WS1& ws1, const WS2& ws2)
       {
           // read the head, and if it is null we can just return
           if (thread_count == 0)
@@ -348,7 +348,7 @@ namespace stm
 
       /*** On Transaction Commit, call this for uniformity (but do nothing) */
       template <class WS1, class WS2>
-      void onCommit(WS1 ws1, WS2 ws2) { }
+      void onCommit(const WS1& ws1, const WS2& ws2) { }
 
       /*** On Transaction Retry, do nothing */
       void beginRetry(RetryHandle* handle) { }
@@ -474,7 +474,7 @@ namespace stm
        * collection stores things that have a field called 'shared'
        */
       template <class WS1, class WS2>
-      void onCommit(WS1 ws1, WS2 ws2)
+      void onCommit(const WS1& ws1, const WS2& ws2)
       {
           unsigned long long bmp = 0;
           // get all retry bitmaps from eager writes and 'or' them into bmp
@@ -0,0 +1,239 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005, 2006, 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef SEGMENTLOG_HPP__
+#define SEGMENTLOG_HPP__
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+namespace stm
+{
+  /**
+   *  Per-thread bump allocator for log segments.  Each descriptor owns one
+   *  and hands it to all of its logs, so their segments come from a few large
+   *  chunks instead of one malloc apiece.  Logs keep their segments forever
+   *  (a reset log reuses them), so nothing is ever given back to the arena.
+   */
+  class LogArena
+  {
+      /*** bytes to malloc at a time */
+      static const unsigned long CHUNK = 64 * 1024;
+
+      char*         m_cur;        /// next free byte in the current chunk
+      unsigned long m_left;       /// free bytes left in the current chunk
+
+    public:
+      LogArena() : m_cur(NULL), m_left(0) { }
+
+      void* alloc(unsigned long bytes)
+      {
+          // keep every segment 16-byte aligned
+          bytes = (bytes + 15) & ~15UL;
+          if (bytes > m_left) {
+              m_left = (bytes > CHUNK) ? bytes : CHUNK;
+              m_cur = static_cast<char*>(malloc(m_left));
+              assert(m_cur);
+          }
+          void* ret = m_cur;
+          m_cur += bytes;
+          m_left -= bytes;
+          return ret;
+      }
+  };
+
+  /**
+   *  Drop-in replacement for MiniVector for transaction logs.  Elements live
+   *  in fixed-size segments of 2^SHIFT entries, found through a small
+   *  directory of segment pointers, so:
+   *
+   *  - growing never copies elements, and their addresses never change
+   *  - reset() and truncating to a mark with resize() are O(1)
+   *  - indexing (begin() + n) is O(1)
+   *  - remove() keeps the remaining elements in order, so that positions
+   *    recorded in the log (e.g. checkpoint marks) stay meaningful
+   *
+   *  Only the directory is ever reallocated, and it holds one pointer per
+   *  segment.  Like MiniVector, no constructors or destructors are run on
+   *  the elements.
+   */
+  template <class T, int SHIFT = 8>
+  class SegmentLog
+  {
+    public:
+      /*** number of elements in a segment */
+      static const unsigned long SEG = 1UL << SHIFT;
+      static const unsigned long MASK = SEG - 1;
+
+    private:
+      LogArena&     m_arena;      /// where new segments come from
+      T**           m_dir;        /// segment directory
+      unsigned long m_dircap;     /// number of slots in m_dir
+      unsigned long m_segs;       /// number of segments allocated
+      unsigned long m_size;       /// number of elements in the log
+      T*            m_tail;       /// slot for the next insert
+
+      /**
+       *  Make sure that segment /s/ exists.  We call this whenever an insert
+       *  fills a segment, so the slot at m_size always exists, even when it
+       *  is the first slot of a new segment.
+       */
+      T* segment(unsigned long s)
+      {
+          if (s == m_segs) {
+              if (m_segs == m_dircap) {
+                  T** temp = m_dir;
+                  m_dircap *= 2;
+                  m_dir = static_cast<T**>(malloc(sizeof(T*) * m_dircap));
+                  assert(m_dir);
+                  memcpy(m_dir, temp, sizeof(T*) * m_segs);
+                  free(temp);
+              }
+              m_dir[m_segs++] =
+                  static_cast<T*>(m_arena.alloc(sizeof(T) * SEG));
+          }
+          return m_dir[s];
+      }
+
+    public:
+      /**
+       *  A forward iterator that also supports the pointer arithmetic the
+       *  logs get used with (begin() + n, i - begin()).  Iterators compare
+       *  by position.
+       */
+      class iterator
+      {
+          const SegmentLog* m_log;
+          unsigned long     m_pos;
+          T*                m_ptr;
+
+        public:
+          iterator() : m_log(NULL), m_pos(0), m_ptr(NULL) { }
+
+          iterator(const SegmentLog* log, unsigned long pos)
+              : m_log(log), m_pos(pos),
+                m_ptr(log->m_dir[pos >> SHIFT] + (pos & MASK))
+          { }
+
+          T& operator*() const { return *m_ptr; }
+          T* operator->() const { return m_ptr; }
+
+          iterator& operator++()
+          {
+              if ((++m_pos & MASK) == 0)
+                  m_ptr = m_log->m_dir[m_pos >> SHIFT];
+              else
+                  ++m_ptr;
+              return *this;
+          }
+
+          iterator operator+(long n) const { return iterator(m_log, m_pos + n); }
+          long operator-(const iterator& i) const { return m_pos - i.m_pos; }
+
+          bool operator==(const iterator& i) const { return m_pos == i.m_pos; }
+          bool operator!=(const iterator& i) const { return m_pos != i.m_pos; }
+      };
+
+      /**
+       *  Construct a log whose segments come from /arena/.  /capacity/ is how
+       *  many elements to make room for up front.
+       */
+      SegmentLog(LogArena& arena, const unsigned long capacity)
+          : m_arena(arena), m_dir(NULL), m_dircap(16), m_segs(0), m_size(0),
+            m_tail(NULL)
+      {
+          while (m_dircap * SEG < capacity)
+              m_dircap *= 2;
+          m_dir = static_cast<T**>(malloc(sizeof(T*) * m_dircap));
+          assert(m_dir);
+          do {
+              segment(m_segs);
+          } while (m_segs * SEG < capacity);
+          m_tail = m_dir[0];
+      }
+
+      /** Reset the log without destroying the elements it holds */
+      void reset()
+      {
+          m_size = 0;
+          m_tail = m_dir[0];
+      }
+
+      /** Truncate the log to its first /new_size/ elements */
+      void resize(unsigned long new_size)
+      {
+          assert(new_size <= m_size);
+          m_size = new_size;
+          m_tail = m_dir[m_size >> SHIFT] + (m_size & MASK);
+      }
+
+      /** Append an element to the log */
+      void insert(T data)
+      {
+          *m_tail = data;
+          if ((++m_size & MASK) == 0)
+              m_tail = segment(m_size >> SHIFT);
+          else
+              ++m_tail;
+      }
+
+      /**
+       *  Delete by position.  Later elements move down one slot, so this is
+       *  O(n), but the log stays in insertion order.  We only use it for
+       *  early release, which is rare.
+       */
+      void remove(const iterator i)
+      {
+          iterator dst = i, src = i, e = end();
+          for (++src; src != e; ++dst, ++src)
+              *dst = *src;
+          resize(m_size - 1);
+      }
+
+      void remove(const unsigned long i) { remove(begin() + i); }
+
+      unsigned long size() const { return m_size; }
+      /** Return true if size is 0. */
+      bool is_empty() const { return !m_size; }
+      iterator begin() const { return iterator(this, 0); }
+      iterator end() const { return iterator(this, m_size); }
+      T& operator[](unsigned long i) const
+      {
+          return m_dir[i >> SHIFT][i & MASK];
+      }
+  }; // template SegmentLog
+} // stm
+
+#endif // SEGMENTLOG_HPP__
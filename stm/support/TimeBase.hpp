@@ -0,0 +1,333 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2007, 2008, 2009, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+//=============================================================================
+// Time bases for the timestamp-based word STMs (LLT, ET)
+//=============================================================================
+//   A transaction reads the time when it begins, a writer takes a commit
+//   time once it holds its locks, and an orec is stamped with the commit
+//   time of its last writer.  A location whose orec is newer than the
+//   reader's start time may have changed since the reader began.
+//
+//   GV1 is the original scheme: one counter, incremented by every writer.
+//   Its line moves between cores on every writer commit, so it stops
+//   scaling long before the rest of the runtime does.  The alternatives,
+//   chosen with STM_TIME_* in config.h:
+//
+//     STM_TIME_GV4    TL2's GV4: a writer tries once to CAS the counter
+//                     forward, and if that fails it commits with the value
+//                     the winner wrote.  Writers that collide share one
+//                     commit time and one cache miss.
+//
+//     STM_TIME_GV5    TL2's GV5: a writer commits at counter + 1 without
+//                     writing the counter.  The counter moves only when a
+//                     transaction finds an orec newer than its start time
+//                     (and so aborts, or extends, anyway).  Writers never
+//                     write shared metadata; readers abort more often,
+//                     even a thread re-reading its own last write.
+//
+//     STM_TIME_TSC    the processor's cycle counter.  Needs an x86_64
+//                     machine whose TSCs are invariant and synchronized
+//                     across sockets (Linux reports "tsc: Marking TSC
+//                     unstable" when they are not).  STM_TIME_TSC_SKEW adds
+//                     a margin, in cycles, to every commit time for
+//                     machines whose TSCs are known to drift by that much.
+//
+//     STM_TIME_VECTOR a clock per thread, bumped only by that thread's
+//                     writer commits.  An orec holds (clock, thread), and a
+//                     transaction snapshots every thread's clock when it
+//                     begins.  Writers touch only their own line; begin
+//                     costs a read of each registered thread's clock.  LLT
+//                     only: ET's extension needs a scalar time.
+//
+//   Every policy has the same per-descriptor interface:
+//
+//     begin()            read the start time
+//     newer(ver)         was version ver committed after begin()?  Callers
+//                        abort or extend when it says yes, so GV5 moves the
+//                        counter up to ver here
+//     commit(quiet)      the commit time, for a writer holding its locks;
+//                        quiet is set only if no other writer can have
+//                        committed since begin(), so validation can be
+//                        skipped
+//
+//   and the scalar ones add now(), extend(t) and advance(ver) for ET.
+//=============================================================================
+
+#ifndef __TIMEBASE_HPP__
+#define __TIMEBASE_HPP__
+
+#include <cassert>
+#include "atomic_ops.h"
+#include "hrtime.h"
+#include "defs.hpp"
+#include "word_based_metadata.hpp"
+
+#if !defined(STM_TIME_GV1) && !defined(STM_TIME_GV4) &&                 \
+    !defined(STM_TIME_GV5) && !defined(STM_TIME_TSC) &&                 \
+    !defined(STM_TIME_VECTOR)
+#define STM_TIME_GV1
+#endif
+
+#if defined(STM_TIME_TSC) && !defined(__x86_64__)
+#error "STM_TIME_TSC needs 64-bit orec versions and rdtscp (x86_64)"
+#endif
+
+#if defined(STM_TIME_VECTOR) && !defined(__LP64__) && !defined(_WIN64)
+#error "STM_TIME_VECTOR needs 64-bit orec versions"
+#endif
+
+#ifndef STM_TIME_TSC_SKEW
+#define STM_TIME_TSC_SKEW 0
+#endif
+
+namespace stm
+{
+  /**
+   *  STM_TIME_GV1, GV4 and GV5: a global counter.  They differ only in
+   *  how a writer gets its commit time, and in GV5's readers moving the
+   *  counter.
+   */
+  class TimeCounter
+  {
+    public:
+      struct Global
+      {
+          padded_unsigned_t timestamp;
+          Global() { timestamp.val = 0; }
+      };
+
+      static Global globals;
+
+    private:
+      unsigned long start;
+
+    public:
+      TimeCounter() : start(0) { }
+
+      void begin() { start = globals.timestamp.val; }
+
+      bool newer(unsigned long ver) const
+      {
+          if (ver <= start)
+              return false;
+#if defined(STM_TIME_GV5)
+          // the caller will retry or extend, and must see a time >= ver
+          advance(ver);
+#endif
+          return true;
+      }
+
+      unsigned long commit(bool& quiet)
+      {
+#if defined(STM_TIME_GV4)
+          // one attempt to move the counter
+          unsigned long ts = globals.timestamp.val;
+          if (bool_cas(&globals.timestamp.val, ts, ts + 1)) {
+              quiet = (ts == start);
+              return ts + 1;
+          }
+          // somebody moved it past ts while we held our locks; committing
+          // at its current value orders us after them
+          quiet = false;
+          return globals.timestamp.val;
+#elif defined(STM_TIME_GV5)
+          // writers at the same time are not told apart, so always validate
+          quiet = false;
+          return globals.timestamp.val + 1;
+#else
+          unsigned long end = 1 + fai(&globals.timestamp.val);
+          // nobody else incremented the counter since we began
+          quiet = (end == start + 1);
+          return end;
+#endif
+      }
+
+      /*** ET's extension: read the time, validate, then adopt it */
+      unsigned long now() const { return globals.timestamp.val; }
+      void extend(unsigned long t) { start = t; }
+
+      /*** make now() at least ver (ET aborts bump versions past it) */
+      static void advance(unsigned long ver)
+      {
+          unsigned long ts;
+          while ((ts = globals.timestamp.val) < ver)
+              if (bool_cas(&globals.timestamp.val, ts, ver))
+                  break;
+      }
+  };
+
+#if defined(__x86_64__)
+  /*** STM_TIME_TSC: the cycle counter is the clock */
+  class TimeTSC
+  {
+    public:
+      struct Global { };
+
+      static Global globals;
+
+    private:
+      unsigned long start;
+
+      /**
+       *  rdtscp waits for earlier loads and stores (and so for the lock
+       *  CASes before a commit); the lfence keeps later orec reads from
+       *  being issued before it.
+       */
+      static unsigned long read()
+      {
+          unsigned long t = gethrcycle_ordered_x86();
+          asm volatile("lfence":::"memory");
+          return t;
+      }
+
+    public:
+      TimeTSC() : start(0) { }
+
+      void begin() { start = read(); }
+
+      bool newer(unsigned long ver) const { return ver > start; }
+
+      unsigned long commit(bool& quiet)
+      {
+          quiet = false;
+          // + 1: a reader whose counter shows the same cycle may have
+          // begun before our locks were visible
+          return read() + STM_TIME_TSC_SKEW + 1;
+      }
+
+      unsigned long now() const { return read(); }
+      void extend(unsigned long t) { start = t; }
+
+      static void advance(unsigned long ver)
+      {
+          while (read() < ver)
+              spin64();
+      }
+  };
+#endif
+
+  /**
+   *  STM_TIME_VECTOR: per-thread clocks.  A version is clock << TID_BITS
+   *  | thread, and is newer than a transaction's start if that thread's
+   *  clock has moved past the transaction's snapshot of it.  Version 0
+   *  (every orec's initial value) reads as clock 0 of thread 0, which no
+   *  snapshot is behind.
+   *
+   *  A slot the snapshot did not cover (a thread registered after begin)
+   *  keeps an older value of that thread's clock, so it only errs toward
+   *  newer().
+   */
+  class TimeVector
+  {
+    public:
+      enum { TID_BITS = 8, TID_MASK = (1 << TID_BITS) - 1 };
+
+      struct Global
+      {
+          padded_unsigned_t threads;
+          padded_unsigned_t clocks[MAX_THREADS];
+          Global()
+          {
+              threads.val = 0;
+              for (int i = 0; i < MAX_THREADS; i++)
+                  clocks[i].val = 0;
+          }
+      };
+
+      static Global globals;
+
+    private:
+      unsigned long id;
+      unsigned long count;            // threads covered by snap
+      unsigned long snap[MAX_THREADS];
+
+    public:
+      TimeVector() : count(0)
+      {
+          id = fai(&globals.threads.val);
+          assert(id < (unsigned long)MAX_THREADS && MAX_THREADS <= TID_MASK + 1);
+          for (int i = 0; i < MAX_THREADS; i++)
+              snap[i] = 0;
+      }
+
+      void begin()
+      {
+          count = globals.threads.val;
+          for (unsigned long i = 0; i < count; i++)
+              snap[i] = globals.clocks[i].val;
+      }
+
+      bool newer(unsigned long ver) const
+      {
+          return (ver >> TID_BITS) > snap[ver & TID_MASK];
+      }
+
+      unsigned long commit(bool& quiet)
+      {
+          // fai rather than a store: the reads of the other clocks below
+          // must not pass it, or two writers that each read a location the
+          // other wrote could both skip validation
+          unsigned long c = 1 + fai(&globals.clocks[id].val);
+          quiet = (c == snap[id] + 1);
+          for (unsigned long i = 0; quiet && (i < count); i++)
+              if ((i != id) && (globals.clocks[i].val != snap[i]))
+                  quiet = false;
+          // a thread that registered after begin may have committed too
+          if (globals.threads.val != count)
+              quiet = false;
+          return (c << TID_BITS) | id;
+      }
+  };
+
+#if defined(STM_TIME_GV1)
+  typedef TimeCounter TimeBase;
+#define STM_TIME_BASE_NAME "GV1"
+#elif defined(STM_TIME_GV4)
+  typedef TimeCounter TimeBase;
+#define STM_TIME_BASE_NAME "GV4"
+#elif defined(STM_TIME_GV5)
+  typedef TimeCounter TimeBase;
+#define STM_TIME_BASE_NAME "GV5"
+#elif defined(STM_TIME_TSC)
+  typedef TimeTSC TimeBase;
+#define STM_TIME_BASE_NAME "TSC"
+#elif defined(STM_TIME_VECTOR)
+  typedef TimeVector TimeBase;
+#define STM_TIME_BASE_NAME "vector"
+#endif
+} // namespace stm
+
+#endif // __TIMEBASE_HPP__
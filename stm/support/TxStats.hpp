@@ -0,0 +1,217 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005, 2006, 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __TXSTATS_HPP__
+#define __TXSTATS_HPP__
+
+#include <ostream>
+#include "atomic_ops.h"
+#include "defs.hpp"
+
+namespace stm
+{
+  /**
+   *  Per-thread transaction statistics.  Each Descriptor owns one of these
+   *  and is the only writer of it, so counting is a plain add to a line the
+   *  thread already owns: cheap enough to leave on all the time.
+   *
+   *  Every TxStats registers itself in a global table the first time it is
+   *  used, and aggregate() sums the table without taking any locks.  A sum
+   *  taken while other threads are still running is only approximate (and
+   *  on 32-bit targets a 64-bit counter can be read half-updated), so dump
+   *  after the threads are done.  Descriptors are never freed, so the table
+   *  never points at dead memory.
+   */
+  class TxStats
+  {
+    public:
+      enum Counter {
+          COMMITS,              // transactions committed
+          ABORTS,               // transactions restarted from the top
+          RETRYS,               // calls to retry() that went to sleep
+          PARTIAL_ABORTS,       // rollbacks to a CHECKPOINT()
+          SNAPSHOT_COMMITS,     // read-only commits made without a read set
+
+          // why each abort happened: a conflict we lost against a writer
+          // while reading (RAW), against a reader (WAR) or a writer (WAW)
+          // while writing, a stale read found by validation, or a writer
+          // that killed us as a visible reader.  Anything else (e.g. an
+          // exception escaping the transaction) is OTHER.
+          ABORT_RAW,
+          ABORT_WAR,
+          ABORT_WAW,
+          ABORT_VALIDATION,
+          ABORT_VISREADER,
+          ABORT_OTHER,
+
+          // what the contention manager told us to do about a conflict
+          CM_ABORT_SELF,
+          CM_ABORT_OTHER,
+          CM_WAIT,
+
+          VALIDATIONS,          // read set validations
+          VALIDATED_ENTRIES,    // total read / lazy write entries validated
+          CLONE_BYTES,          // bytes copied to make clones
+          BACKOFF_NS,           // time spent in contention backoff
+
+          NUM_COUNTERS
+      };
+
+      /*** the name of a counter, as it appears in dumps */
+      static const char* name(int c)
+      {
+          static const char* const names[NUM_COUNTERS] = {
+              "commits", "aborts", "retrys", "partial_aborts", "snapshot_commits",
+              "abort_raw", "abort_war", "abort_waw", "abort_validation",
+              "abort_visreader", "abort_other",
+              "cm_abort_self", "cm_abort_other", "cm_wait",
+              "validations", "validated_entries", "clone_bytes", "backoff_ns"
+          };
+          return names[c];
+      }
+
+    private:
+      unsigned long long counts[NUM_COUNTERS];
+
+      /*** global table of every thread's stats */
+      static TxStats* volatile registry[MAX_THREADS];
+      static volatile unsigned long registered;
+
+    public:
+      TxStats() { reset(); }
+
+      void reset()
+      {
+          for (int i = 0; i < NUM_COUNTERS; i++)
+              counts[i] = 0;
+      }
+
+      /**
+       *  Make this thread's stats visible to aggregate().  Threads past
+       *  MAX_THREADS still count, they just aren't in the total.
+       */
+      void registerThread()
+      {
+          unsigned long slot = fai(&registered);
+          if (slot < MAX_THREADS)
+              registry[slot] = this;
+      }
+
+      void inc(Counter c) { counts[c]++; }
+      void add(Counter c, unsigned long long v) { counts[c] += v; }
+      unsigned long long get(Counter c) const { return counts[c]; }
+
+      void merge(const TxStats& other)
+      {
+          for (int i = 0; i < NUM_COUNTERS; i++)
+              counts[i] += other.counts[i];
+      }
+
+      /*** Sum the stats of every registered thread */
+      static TxStats aggregate()
+      {
+          TxStats total;
+          unsigned long n = registered;
+          for (unsigned long i = 0; i < n && i < MAX_THREADS; i++)
+              if (registry[i])
+                  total.merge(*registry[i]);
+          return total;
+      }
+
+      /**
+       *  Write one row (CSV) or object (JSON) per registered thread plus a
+       *  total.  Both formats add the average number of entries checked per
+       *  validation, which is the figure we usually want.
+       */
+      static void dumpCSV(std::ostream& os)
+      {
+          os << "thread";
+          for (int c = 0; c < NUM_COUNTERS; c++)
+              os << "," << name(c);
+          os << ",avg_validated_entries" << std::endl;
+
+          unsigned long n = registered;
+          for (unsigned long i = 0; i < n && i < MAX_THREADS; i++) {
+              if (!registry[i])
+                  continue;
+              os << i;
+              registry[i]->printCSV(os);
+          }
+          os << "total";
+          aggregate().printCSV(os);
+      }
+
+      static void dumpJSON(std::ostream& os)
+      {
+          os << "{\"threads\": [";
+          unsigned long n = registered;
+          bool first = true;
+          for (unsigned long i = 0; i < n && i < MAX_THREADS; i++) {
+              if (!registry[i])
+                  continue;
+              os << (first ? "\n  " : ",\n  ");
+              first = false;
+              registry[i]->printJSON(os);
+          }
+          os << "\n ],\n \"total\": ";
+          aggregate().printJSON(os);
+          os << "\n}" << std::endl;
+      }
+
+    private:
+      double avgValidated() const
+      {
+          if (counts[VALIDATIONS] == 0)
+              return 0;
+          return (double)counts[VALIDATED_ENTRIES] / counts[VALIDATIONS];
+      }
+
+      void printCSV(std::ostream& os) const
+      {
+          for (int c = 0; c < NUM_COUNTERS; c++)
+              os << "," << counts[c];
+          os << "," << avgValidated() << std::endl;
+      }
+
+      void printJSON(std::ostream& os) const
+      {
+          os << "{";
+          for (int c = 0; c < NUM_COUNTERS; c++)
+              os << "\"" << name(c) << "\": " << counts[c] << ", ";
+          os << "\"avg_validated_entries\": " << avgValidated() << "}";
+      }
+  };
+} // namespace stm
+
+#endif // __TXSTATS_HPP__
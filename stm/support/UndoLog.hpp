@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005, 2006, 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef UNDOLOG_HPP__
+#define UNDOLOG_HPP__
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "MiniVector.hpp"
+
+namespace stm
+{
+  /**
+   *  Byte-granularity undo log for objects that are written in place.  Each
+   *  entry remembers an address, a length, and the bytes that were there
+   *  before the write.  Entries are undone newest-first, so logging the same
+   *  field twice is harmless: the oldest value is the one that survives.
+   *
+   *  Like MiniVector, reset() is O(1) and nothing is ever freed.  The saved
+   *  bytes live in one growable buffer, so logging a field costs one memcpy
+   *  and no allocation in the common case.
+   */
+  class UndoLog
+  {
+      struct entry_t
+      {
+          void*         addr;   /// where the bytes go back to
+          unsigned long len;    /// how many bytes
+          unsigned long offset; /// where the old bytes are in m_bytes
+
+          entry_t(void* _a = NULL, unsigned long _l = 0, unsigned long _o = 0)
+              : addr(_a), len(_l), offset(_o)
+          { }
+      };
+
+      MiniVector<entry_t> m_entries;
+      unsigned char*      m_bytes;
+      unsigned long       m_used;
+      unsigned long       m_cap;
+
+    public:
+      UndoLog(unsigned long capacity = 4096)
+          : m_entries(64), m_bytes(static_cast<unsigned char*>(malloc(capacity))),
+            m_used(0), m_cap(capacity)
+      {
+          assert(m_bytes);
+      }
+
+      /*** Save the current contents of [addr, addr + len) */
+      void log(void* addr, unsigned long len)
+      {
+          if (m_used + len > m_cap) {
+              while (m_used + len > m_cap)
+                  m_cap *= 2;
+              m_bytes = static_cast<unsigned char*>(realloc(m_bytes, m_cap));
+              assert(m_bytes);
+          }
+          memcpy(m_bytes + m_used, addr, len);
+          m_entries.insert(entry_t(addr, len, m_used));
+          m_used += len;
+      }
+
+      /*** Number of entries; pass this to undo() to roll back to here */
+      unsigned long mark() const { return m_entries.size(); }
+
+      /*** Total bytes saved since the last reset */
+      unsigned long bytes() const { return m_used; }
+
+      /**
+       *  Restore every location logged after /to/ (a value previously
+       *  returned by mark()), newest first, and drop those entries.
+       */
+      void undo(unsigned long to = 0)
+      {
+          unsigned long n = m_entries.size();
+          if (n <= to)
+              return;
+          for (unsigned long k = n; k > to; --k) {
+              entry_t* i = m_entries.begin() + (k - 1);
+              memcpy(i->addr, m_bytes + i->offset, i->len);
+          }
+          m_used = (m_entries.begin() + to)->offset;
+          m_entries.resize(to);
+      }
+
+      /*** Forget everything without restoring it (i.e., on commit) */
+      void reset()
+      {
+          m_entries.reset();
+          m_used = 0;
+      }
+  };
+} // stm
+
+#endif // UNDOLOG_HPP__
@@ -0,0 +1,161 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2005, 2006, 2007, 2008, 2009
+// University of Rochester
+// Department of Computer Science
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the University of Rochester nor the names of its
+//      contributors may be used to endorse or promote products derived from
+//      this software without specific prior written permission.
+//
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __VISREADERSET_HPP__
+#define __VISREADERSET_HPP__
+
+#include "atomic_ops.h"
+#include "defs.hpp"
+
+namespace stm
+{
+  /**
+   *  Visible reader set for an RSTM object header.  A single word bitmap caps
+   *  visible reading at 32 (or 64) threads, so instead we keep one bit per
+   *  possible reader token, spread across WORDS words, plus a summary word
+   *  that has bit w set if word w may have readers in it.  Writers only look
+   *  at the words named by the summary, so with few readers the cost is about
+   *  the same as the old single bitmap.
+   *
+   *  Summary bits are sticky: a reader sets its word bit and then its summary
+   *  bit, but nobody ever clears a summary bit.  Clearing it when a word goes
+   *  to zero would race with a reader that has just set a bit in that word
+   *  and seen the summary bit already set.  A stale summary bit only costs a
+   *  writer one extra load.
+   *
+   *  Ordering: install() CASes both words before the caller re-reads the
+   *  object header, and writers CAS the header before scanning the readers,
+   *  so a writer either sees a new reader or the reader sees the writer.
+   */
+  class VisReaderSet
+  {
+    public:
+      /*** bits per word in the bitmap */
+      static const int BITS = 8 * sizeof(unsigned long);
+
+      /*** one bit per possible reader, all of which must fit the summary */
+      static const int WORDS = (MAX_THREADS + BITS - 1) / BITS;
+
+      /*** the number of distinct reader tokens we can hold */
+      static const int MAX_READERS = WORDS * BITS;
+
+    private:
+      /*** bit w is set if m_bits[w] has (or once had) a reader */
+      volatile unsigned long m_summary;
+
+      /*** the reader bitmap proper */
+      volatile unsigned long m_bits[WORDS];
+
+    public:
+      VisReaderSet() : m_summary(0)
+      {
+          for (int w = 0; w < WORDS; w++)
+              m_bits[w] = 0;
+      }
+
+      /*** true if the reader holding /token/ is in the set */
+      bool contains(int token) const
+      {
+          return (m_bits[token / BITS] & (1UL << (token % BITS))) != 0;
+      }
+
+      /**
+       *  Add the reader holding /token/.  Returns false if it was already
+       *  present.
+       */
+      bool install(int token)
+      {
+          volatile unsigned long* word = &m_bits[token / BITS];
+          unsigned long mask = 1UL << (token % BITS);
+          if (*word & mask)
+              return false;
+
+          unsigned long old;
+          do {
+              old = *word;
+          } while (!bool_cas(word, old, old | mask));
+
+          unsigned long wmask = 1UL << (token / BITS);
+          while (!(m_summary & wmask)) {
+              old = m_summary;
+              bool_cas(&m_summary, old, old | wmask);
+          }
+          return true;
+      }
+
+      /*** Remove the reader holding /token/, if it is present */
+      void remove(int token)
+      {
+          volatile unsigned long* word = &m_bits[token / BITS];
+          unsigned long mask = 1UL << (token % BITS);
+          if (!(*word & mask))
+              return;
+
+          unsigned long old;
+          do {
+              old = *word;
+          } while (!bool_cas(word, old, old & ~mask));
+      }
+
+      /**
+       *  Return the smallest reader token >= /from/, or -1 if there are none.
+       *  Iterate with:
+       *      for (int i = r.next(0); i != -1; i = r.next(i + 1))
+       */
+      int next(int from) const
+      {
+          unsigned long summary = m_summary;
+          for (int w = from / BITS; w < WORDS; w++) {
+              if (!(summary & (1UL << w)))
+                  continue;
+              unsigned long bits = m_bits[w];
+              int b = 0;
+              // only the first word we look at can start mid-word
+              if (w == from / BITS) {
+                  b = from % BITS;
+                  bits >>= b;
+              }
+              while (bits) {
+                  if (bits & 1)
+                      return w * BITS + b;
+                  bits >>= 1;
+                  b++;
+              }
+          }
+          return -1;
+      }
+  };
+} // stm
+
+#endif // __VISREADERSET_HPP__
@@ -47,7 +47,116 @@ using namespace std;
 #ifndef ATOMIC_OPS_H__
 #define ATOMIC_OPS_H__
 
-#if defined(_MSC_VER)
+/**
+ *  The __atomic builtin backend (gcc 4.7 and later, and clang) is used for
+ *  any CPU without an asm path below, and on any CPU when STM_ATOMIC_BUILTINS
+ *  is defined.  The fence macros become fences with explicit orders: ISYNC
+ *  (after taking a lock) an acquire fence, and WBR and SYNC full fences.
+ *  LWSYNC is an acq_rel fence, like POWER's lwsync: besides releasing a
+ *  lock it orders reads before later reads (e.g. a timestamp before the
+ *  orecs it is checked against), which a release fence alone does not.
+ *  The compiler emits whatever the target needs for each, and nothing
+ *  where it needs nothing.
+ */
+#if defined(__GNUC__) &&                                                \
+    (defined(STM_ATOMIC_BUILTINS) ||                                    \
+     !(defined(__i386__) || defined(__x86_64__) || defined(__ia64__) || \
+       defined(__sparc__) || defined(_POWER)))
+
+#define STM_ATOMIC_BACKEND "builtins"
+
+#define CFENCE          __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define WBR             __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define ISYNC           __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define LWSYNC          __atomic_thread_fence(__ATOMIC_ACQ_REL)
+#define SYNC            __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+static inline unsigned long
+cas(volatile unsigned long* ptr, unsigned long old, unsigned long _new)
+{
+    __atomic_compare_exchange_n(ptr, &old, _new, false,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return old;
+}
+
+static inline unsigned long tas(volatile unsigned long* ptr)
+{
+    return __atomic_exchange_n(ptr, 1UL, __ATOMIC_SEQ_CST);
+}
+
+static inline unsigned long
+swap(volatile unsigned long* ptr, unsigned long val)
+{
+    return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline void nop()
+{
+    __asm__ __volatile__("nop");
+}
+
+static inline bool casX(volatile unsigned long long* addr,
+                        const unsigned long long* oldVal,
+                        const unsigned long long* newVal)
+{
+    unsigned long long expected = *oldVal;
+    return __atomic_compare_exchange_n(addr, &expected, *newVal, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool
+casX(volatile unsigned long long* addr,
+     unsigned long expected_high, unsigned long expected_low,
+     unsigned long new_high, unsigned long new_low)
+{
+    unsigned long long expected =
+        ((unsigned long long)expected_high << 32) | (unsigned)expected_low;
+    unsigned long long replacement =
+        ((unsigned long long)new_high << 32) | (unsigned)new_low;
+    return casX(addr, &expected, &replacement);
+}
+
+// atomic load and store of *src into *dest
+static inline void
+mvx(const volatile unsigned long long* src, volatile unsigned long long* dest)
+{
+    __atomic_store_n(dest, __atomic_load_n(src, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+}
+
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16) && defined(__SIZEOF_INT128__)
+#define STM_HAVE_DWCAS
+
+// double-width CAS: addr[0] and addr[1], aligned on 2 * sizeof(long)
+static inline bool
+dwcas(volatile unsigned long* addr,
+      unsigned long old_low, unsigned long old_high,
+      unsigned long new_low, unsigned long new_high)
+{
+    unsigned __int128 expected =
+        ((unsigned __int128)old_high << 64) | old_low;
+    unsigned __int128 replacement =
+        ((unsigned __int128)new_high << 64) | new_low;
+    return __sync_bool_compare_and_swap((volatile unsigned __int128*)addr,
+                                        expected, replacement);
+}
+#elif defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8) && (__SIZEOF_LONG__ == 4)
+#define STM_HAVE_DWCAS
+
+static inline bool
+dwcas(volatile unsigned long* addr,
+      unsigned long old_low, unsigned long old_high,
+      unsigned long new_low, unsigned long new_high)
+{
+    return casX((volatile unsigned long long*)addr,
+                old_high, old_low, new_high, new_low);
+}
+#endif
+
+#elif defined(_MSC_VER)
+
+#define STM_ATOMIC_BACKEND "msvc"
+
 #define CFENCE /* we don't appear to need compiler fences in Visual C++ */
 #define WBR {__asm {mfence} }
 #define ISYNC
@@ -139,6 +248,8 @@ mvx(const volatile unsigned long long *src, volatile unsigned long long *dest)
 
 #elif defined(__i386__) && defined(__GNUC__)
 
+#define STM_ATOMIC_BACKEND "i386"
+
 /* "compiler fence" for preventing reordering of loads/stores to
    non-volatiles */
 #define CFENCE          asm volatile ("":::"memory")
@@ -291,7 +402,119 @@ mvx(const volatile unsigned long long *src, volatile unsigned long long *dest)
     *destd = *srcd;
 }
 
+// double-width CAS: addr[0] and addr[1], aligned on 2 * sizeof(long)
+#define STM_HAVE_DWCAS
+static inline bool
+dwcas(volatile unsigned long* addr,
+      unsigned long old_low, unsigned long old_high,
+      unsigned long new_low, unsigned long new_high)
+{
+    return casX((volatile unsigned long long*)addr,
+                old_high, old_low, new_high, new_low);
+}
+
+#elif defined(__x86_64__) && defined(__GNUC__)
+
+#define STM_ATOMIC_BACKEND "x86_64"
+
+/* "compiler fence" for preventing reordering of loads/stores to
+   non-volatiles */
+#define CFENCE          asm volatile ("":::"memory")
+
+// x86 is TSO, so only store-load ordering needs an instruction.  A locked
+// add to the stack orders the same as mfence for ordinary (write-back)
+// memory, and costs less on most cores
+#define WBR             asm volatile("lock; addl $0, -4(%%rsp)":::"memory", "cc")
+#define ISYNC           CFENCE
+#define LWSYNC          CFENCE
+#define SYNC
+
+// gcc x86_64 CAS and TAS
+
+static inline unsigned long
+cas(volatile unsigned long* ptr, unsigned long old, unsigned long _new)
+{
+    unsigned long prev;
+    asm volatile("lock;"
+                 "cmpxchgq %1, %2;"
+                 : "=a"(prev)
+                 : "r"(_new), "m"(*ptr), "a"(old)
+                 : "memory", "cc");
+    return prev;
+}
+
+static inline unsigned long tas(volatile unsigned long* ptr)
+{
+    unsigned long result;
+    asm volatile("xchgq %0, %1;"
+                 : "=r"(result), "=m"(*ptr)
+                 : "0"(1UL), "m"(*ptr)
+                 : "memory");
+    return result;
+}
+
+static inline unsigned long
+swap(volatile unsigned long* ptr, unsigned long val)
+{
+    asm volatile("xchgq %0, %1"
+                 : "=r"(val), "=m"(*ptr)
+                 : "0"(val), "m"(*ptr)
+                 : "memory");
+    return val;
+}
+
+static inline void nop()
+{
+    asm volatile("nop");
+}
+
+// a long long is one word here, so casX is an ordinary CAS; the
+// high/low form keeps the 32-bit packing of its callers
+static inline bool casX(volatile unsigned long long* addr,
+                        const unsigned long long* oldVal,
+                        const unsigned long long* newVal)
+{
+    return cas((volatile unsigned long*)addr, *oldVal, *newVal) == *oldVal;
+}
+
+static inline bool
+casX(volatile unsigned long long* addr,
+     unsigned long expected_high, unsigned long expected_low,
+     unsigned long new_high, unsigned long new_low)
+{
+    unsigned long long expected = (expected_high << 32) | (unsigned)expected_low;
+    unsigned long long replacement = (new_high << 32) | (unsigned)new_low;
+    return casX(addr, &expected, &replacement);
+}
+
+// atomic load and store of *src into *dest
+static inline void
+mvx(const volatile unsigned long long* src, volatile unsigned long long* dest)
+{
+    *dest = *src;
+}
+
+// double-width CAS: addr[0] and addr[1], aligned on 16 bytes
+#define STM_HAVE_DWCAS
+static inline bool
+dwcas(volatile unsigned long* addr,
+      unsigned long old_low, unsigned long old_high,
+      unsigned long new_low, unsigned long new_high)
+{
+    struct pair_t { unsigned long w[2]; };
+    bool success;
+    asm volatile("lock; cmpxchg16b %1;"
+                 "setz %0;"
+                 : "=q"(success), "+m"(*(volatile pair_t*)addr),
+                   "+a"(old_low), "+d"(old_high)
+                 : "b"(new_low), "c"(new_high)
+                 : "memory", "cc");
+    return success;
+}
+
 #elif defined(__ia64__) && defined(__GNUC__)
+
+#define STM_ATOMIC_BACKEND "ia64"
 /* "compiler fence" for preventing reordering of loads/stores to
    non-volatiles */
 #define CFENCE          asm volatile ("":::"memory")
@@ -344,6 +567,8 @@ static inline void nop()
 
 #elif defined(__sparc__) && defined(__GNUC__)
 
+#define STM_ATOMIC_BACKEND "sparc"
+
 /* "compiler fence" for preventing reordering of loads/stores to
    non-volatiles */
 #define CFENCE          asm volatile ("":::"memory")
@@ -451,6 +676,8 @@ static inline void nop()
 
 #elif defined(_POWER) && defined(__GNUC__)
 
+#define STM_ATOMIC_BACKEND "power"
+
 #define ISYNC       asm volatile ("isync":::"memory")
 #define LWSYNC      asm volatile ("lwsync":::"memory")
 #define SYNC        asm volatile ("sync":::"memory")
@@ -35,11 +35,38 @@
 #ifndef WBDESCRIPTOR_H__
 #define WBDESCRIPTOR_H__
 #include <setjmp.h>
+#include <stdlib.h>
+#include <iostream>
 #include "defs.hpp"
+#include "atomic_ops.h"
 #include "word_based_metadata.hpp"
 #include "word_based_writeset.hpp"
 #include "MiniVector.hpp"
 
+/**
+ *  Default orec table: 2^STM_OREC_BITS orecs, each covering a stripe of
+ *  2^STM_OREC_SHIFT bytes (3 is a word, 6 a cache line).  Define
+ *  STM_OREC_MASK to index the table with the low stripe bits rather than
+ *  a hash.  OrecWBTxThread::configure_orecs() changes all three at run
+ *  time.
+ */
+#ifndef STM_OREC_BITS
+#define STM_OREC_BITS 20
+#endif
+#ifndef STM_OREC_SHIFT
+#define STM_OREC_SHIFT 3
+#endif
+#ifdef STM_OREC_MASK
+#define STM_OREC_HASHED false
+#else
+#define STM_OREC_HASHED true
+#endif
+
+/*** the default OrecWBTxThread::table, for each STM's .cpp to define */
+#define STM_OREC_TABLE_DEFAULT                                  \
+    { NULL, (1UL << STM_OREC_BITS) - 1, STM_OREC_SHIFT,         \
+      8 * sizeof(unsigned long) - STM_OREC_BITS, STM_OREC_HASHED }
+
 namespace stm
 {
   class WBTxThread
@@ -72,7 +99,7 @@ namespace stm
       /*** hash function for a 32-bit write filter */
       static unsigned simplehash(void* val)
       {
-          return (((unsigned)val)>>5) & 0x1f;
+          return (((unsigned long)val)>>5) & 0x1f;
       }
 
     public: // fields
@@ -90,19 +117,107 @@ namespace stm
       typedef stm::orec_t<OrecWBTxThread> orec_t;
       typedef MiniVector<orec_t*> OrecList;
 
+    public: // orec table configuration
+
+      /**
+       *  How a stripe number becomes a table index.  OREC_MAP_MASK takes
+       *  its low bits, which keeps neighbouring stripes in neighbouring
+       *  orecs but makes any two stripes a multiple of the table size
+       *  apart share an orec.  OREC_MAP_HASH multiplies by 2^64/phi (or
+       *  2^32/phi) and takes the high bits, so all the address bits pick
+       *  the orec and regular strides spread over the table.
+       */
+      enum OrecMap { OREC_MAP_MASK, OREC_MAP_HASH };
+
+      /**
+       *  Replace the orec table with one of 2^bits orecs over 2^shift-byte
+       *  stripes.  Like pnf_set_configure(), call this before any thread
+       *  starts transactions; the old table is freed.  Returns false, and
+       *  keeps the old table, if the new one can't be allocated.
+       */
+      static bool configure_orecs(unsigned bits, unsigned shift, OrecMap map)
+      {
+          if (bits < 1)
+              bits = 1;
+          if (bits > 30)
+              bits = 30;
+          volatile orec_t* fresh = alloc_orecs(1UL << bits);
+          if (!fresh)
+              return false;
+          volatile orec_t* old = table.orecs;
+          table.orecs = fresh;
+          table.mask = (1UL << bits) - 1;
+          table.shift = shift;
+          table.hash_shift = 8 * sizeof(unsigned long) - bits;
+          table.hashed = (map == OREC_MAP_HASH);
+          free((void*)old);
+          return true;
+      }
+
+      static unsigned long orec_count() { return table.mask + 1; }
+      static unsigned orec_shift() { return table.shift; }
+      static bool orec_hashed() { return table.hashed; }
+
+      /*** the table index of the orec covering /addr/ */
+      static unsigned long orec_index(const void* addr)
+      {
+          unsigned long stripe =
+              reinterpret_cast<unsigned long>(addr) >> table.shift;
+          if (table.hashed)
+              return (stripe * HASH_MULT) >> table.hash_shift;
+          return stripe & table.mask;
+      }
+
     protected: // orec support
 
-      /*** Specify the number of orecs in the global array. */
-      static const unsigned NUM_STRIPES = 1048576;
+      /*** Fibonacci hashing multiplier for the word size */
+      static const unsigned long HASH_MULT =
+          (sizeof(unsigned long) == 8) ? (unsigned long)0x9E3779B97F4A7C15ULL
+                                       : (unsigned long)0x9E3779B9UL;
+
+      /**
+       *  The table and how to index it, on one line: get_orec reads all of
+       *  it on every access.
+       */
+      struct OrecTable
+      {
+          volatile orec_t* orecs;
+          unsigned long    mask;
+          unsigned         shift;
+          unsigned         hash_shift;
+          bool             hashed;
+      } __attribute__((aligned(64)));
+
+      static OrecTable table;
 
-      /*** declare the table of orecs */
-      static volatile orec_t orecs[NUM_STRIPES];
+      static volatile orec_t* alloc_orecs(unsigned long count)
+      {
+          // calloc leaves big tables to the OS's zero pages, so only the
+          // part of the table a program touches costs memory
+          return (volatile orec_t*)calloc(count, sizeof(orec_t));
+      }
+
+      /**
+       *  The first Descriptor built sets up the default table, unless
+       *  configure_orecs() already made one.
+       */
+      OrecWBTxThread()
+      {
+          if (table.orecs)
+              return;
+          volatile orec_t* fresh = alloc_orecs(table.mask + 1);
+          if (!fresh)
+              UNRECOVERABLE_ERROR("cannot allocate " << table.mask + 1
+                                  << " orecs");
+          if (!bool_cas((volatile unsigned long*)&table.orecs, 0,
+                        (unsigned long)fresh))
+              free((void*)fresh);
+      }
 
       /*** map addresses to orec table entries */
       static volatile orec_t* get_orec(void* addr)
       {
-          unsigned index = reinterpret_cast<unsigned>(addr);
-          return &orecs[(index>>3) % NUM_STRIPES];
+          return &table.orecs[orec_index(addr)];
       }
 
   }; // class OrecWBTxThread
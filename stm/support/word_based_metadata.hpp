@@ -50,25 +50,26 @@ namespace stm
       T* owner;
       struct
       {
-          // ensure lsb is lock bit regardless of platform
+          // ensure lsb is lock bit regardless of platform.  The fields are
+          // unsigned long so that num gets every bit of a 64-bit word
 #ifdef STM_INEV_IRL
           // IRL needs a read bit in the 2lsb position
-#    if defined(__i386__) || defined(_MSC_VER) /* little endian */
-          unsigned lock:1;
-          unsigned reads:1;
-          unsigned num:(8*sizeof(void*))-2;
+#    if defined(__i386__) || defined(__x86_64__) || defined(_MSC_VER) /* little endian */
+          unsigned long lock:1;
+          unsigned long reads:1;
+          unsigned long num:(8*sizeof(void*))-2;
 #    else /* big endian */
-          unsigned num:(8*sizeof(void*))-2;
-          unsigned reads:1;
-          unsigned lock:1;
+          unsigned long num:(8*sizeof(void*))-2;
+          unsigned long reads:1;
+          unsigned long lock:1;
 #    endif
 #else
-#    if defined(__i386__) || defined(_MSC_VER) /* little endian */
-          unsigned lock:1;
-          unsigned num:(8*sizeof(void*))-1;
+#    if defined(__i386__) || defined(__x86_64__) || defined(_MSC_VER) /* little endian */
+          unsigned long lock:1;
+          unsigned long num:(8*sizeof(void*))-1;
 #    else /* big endian */
-          unsigned num:(8*sizeof(void*))-1;
-          unsigned lock:1;
+          unsigned long num:(8*sizeof(void*))-1;
+          unsigned long lock:1;
 #    endif
 #endif
       } version;
@@ -83,41 +84,27 @@ namespace stm
   };
 
   /**
-   * C++ Template Voodoo: the addr_dispatch class takes an address and a type,
-   * and determines which words (represented as void*s) ought to be read and
-   * written to effect a read or write of the given type, from the given
-   * address.
+   *  A word is what stm_read_word and stm_write_word move: sizeof(void*)
+   *  bytes, aligned on a sizeof(void*) boundary.  Orecs, read sets and
+   *  redo logs all work on whole words, so every access to a location
+   *  must map to the same word: on x86_64 a word is 8 bytes, and 1-, 2-
+   *  and 4-byte types live inside one.
    */
-  template <class D, typename T, int S>
-  struct addr_dispatch
-  {
-      // use this to ensure compile-time errors
-      struct InvalidTypeAsSecondTemplateParameter { };
+  const unsigned long WORD_BYTES = sizeof(void*);
 
-      // the read method will transform a read to a sizeof(T) byte range
-      // starting at addr into a set of stm_read_word calls.  For now, the
-      // range must be aligned on a sizeof(T) boundary, and T must be 1, 4, or
-      // 8 bytes.
-      __attribute__((always_inline))
-      static T read(T* addr, D* thread)
-      {
-          InvalidTypeAsSecondTemplateParameter itastp;
-          T invalid = (T)itastp;
-          return invalid;
-      }
+  /*** the word holding the byte at /addr/ */
+  inline void** word_of(const void* addr)
+  {
+      return (void**)(((unsigned long)addr) & ~(WORD_BYTES - 1));
+  }
 
-      // same as read, but for writes
-      __attribute__((always_inline))
-      static void write(T* addr, T val, D* thread)
-      {
-          InvalidTypeAsSecondTemplateParameter itaftp;
-          T invalid = (T)itaftp;
-      }
-  };
+  /*** T without const, so a byte range can be assigned through a T* */
+  template <typename T> struct unconst          { typedef T type; };
+  template <typename T> struct unconst<const T> { typedef T type; };
 
-  /*** standard dispatch for 4-byte types (to include sh_ptr<T>) */
+  /*** a type exactly one word wide: one stm_read_word or stm_write_word */
   template <class D, typename T>
-  struct addr_dispatch<D, T, 4>
+  struct word_access
   {
       __attribute__((always_inline))
       static T read(T* addr, D* thread)
@@ -139,144 +126,153 @@ namespace stm
       }
   };
 
-  template <class D>
-  struct addr_dispatch<D, float, 4>
+  /**
+   *  A type narrower than a word: read the enclosing word and pick out
+   *  the bytes at addr's offset within it.  A write must read the word
+   *  first, so the rest of it is written back unchanged.
+   */
+  template <class D, typename T>
+  struct subword_access
   {
       __attribute__((always_inline))
-      static float read(float* addr, D* thread)
+      static T read(T* addr, D* thread)
       {
-          union { float* f; void** v; } a;
-          union { float f;  void* v;  } v;
-          a.f = addr;
-          v.v = thread->stm_read_word(a.v);
-          return v.f;
+          union { char b[sizeof(void*)]; void* v; } w;
+          unsigned long offset = ((unsigned long)addr) & (WORD_BYTES - 1);
+          w.v = thread->stm_read_word(word_of(addr));
+          union { T* t; char* b; } q;
+          q.b = &w.b[offset];
+          return *q.t;
       }
 
       __attribute__((always_inline))
-      static void write(float* addr, float val, D* thread)
+      static void write(T* addr, T val, D* thread)
       {
-          union { float* f; void** v; } a;
-          union { float f;  void* v;  } v;
-          a.f = addr;
-          v.f = val;
-          thread->stm_write_word(a.v, v.v);
+          union { char b[sizeof(void*)]; void* v; } w;
+          void** a = word_of(addr);
+          unsigned long offset = ((unsigned long)addr) & (WORD_BYTES - 1);
+          w.v = thread->stm_read_word(a);
+          union { typename unconst<T>::type* t; char* b; } q;
+          q.b = &w.b[offset];
+          *q.t = val;
+          thread->stm_write_word(a, w.v);
       }
   };
 
-  template <class D>
-  struct addr_dispatch<D, const float, 4>
+  /*** a type two words wide (8 bytes on 32-bit platforms): two accesses */
+  template <class D, typename T>
+  struct split_access
   {
       __attribute__((always_inline))
-      static float read(const float* addr, D* thread)
+      static T read(T* addr, D* thread)
       {
-          union { const float* f; void** v; } a;
-          union { float f;  void* v;  } v;
-          a.f = addr;
-          v.v = thread->stm_read_word(a.v);
-          return v.f;
+          union { T* t; void** v; } a, r;
+          a.t = addr;
+          void* v[2];
+          v[0] = thread->stm_read_word(a.v);
+          v[1] = thread->stm_read_word(a.v + 1);
+          r.v = v;
+          return *r.t;
       }
 
       __attribute__((always_inline))
-      static void write(const float* addr, float val, D* thread)
+      static void write(T* addr, T val, D* thread)
       {
-          assert(false && "You should not be writing a const float!");
+          union { T* t; void** v; } a, v;
+          a.t = addr;
+          v.t = &val;
+          thread->stm_write_word(a.v, v.v[0]);
+          thread->stm_write_word(a.v + 1, v.v[1]);
       }
   };
 
+  /*** pick the access for a S-byte type on a platform with W-byte words */
+  template <class D, typename T, int S, int W>
+  struct word_dispatch { };
+
+  template <class D, typename T, int W>
+  struct word_dispatch<D, T, 1, W> : public subword_access<D, T> { };
+
+  template <class D, typename T, int W>
+  struct word_dispatch<D, T, 2, W> : public subword_access<D, T> { };
+
+  template <class D, typename T>
+  struct word_dispatch<D, T, 4, 4> : public word_access<D, T> { };
+
   template <class D, typename T>
-  struct addr_dispatch<D, T, 8>
+  struct word_dispatch<D, T, 4, 8> : public subword_access<D, T> { };
+
+  template <class D, typename T>
+  struct word_dispatch<D, T, 8, 4> : public split_access<D, T> { };
+
+  template <class D, typename T>
+  struct word_dispatch<D, T, 8, 8> : public word_access<D, T> { };
+
+  /**
+   * C++ Template Voodoo: the addr_dispatch class takes an address and a type,
+   * and determines which words (represented as void*s) ought to be read and
+   * written to effect a read or write of the given type, from the given
+   * address.
+   */
+  template <class D, typename T, int S>
+  struct addr_dispatch
   {
+      // use this to ensure compile-time errors
+      struct InvalidTypeAsSecondTemplateParameter { };
+
+      // the read method will transform a read to a sizeof(T) byte range
+      // starting at addr into a set of stm_read_word calls.  For now, the
+      // range must be aligned on a sizeof(T) boundary, and T must be 1, 2,
+      // 4, or 8 bytes.
       __attribute__((always_inline))
       static T read(T* addr, D* thread)
       {
-          // get second word's address
-          void** addr2 = (void**)((long)addr + 4);
-          union {
-              long long l;
-              struct { void* v1; void* v2; } v;
-          } v;
-          // read the two words
-          v.v.v1 = thread->stm_read_word((void**)addr);
-          v.v.v2 = thread->stm_read_word(addr2);
-          // return the two words as a T
-          union { long long* l; T* t; } ret;
-          ret.l = &v.l;
-          return *ret.l;
+          InvalidTypeAsSecondTemplateParameter itastp;
+          T invalid = (T)itastp;
+          return invalid;
       }
 
+      // same as read, but for writes
       __attribute__((always_inline))
-       static void write(T* addr, T val, D* thread)
+      static void write(T* addr, T val, D* thread)
       {
-          // compute the two addresses
-          void** addr1 = (void**)addr;
-          void** addr2 = (void**)((long)addr + 4);
-          // turn the value into two words
-          union {
-              T t;
-              struct { void* v1; void* v2; } v;
-          } v;
-          v.t = val;
-          // write the two words
-          thread->stm_write_word(addr1, v.v.v1);
-          thread->stm_write_word(addr2, v.v.v2);
+          InvalidTypeAsSecondTemplateParameter itaftp;
+          T invalid = (T)itaftp;
       }
-
   };
 
+  template <class D, typename T>
+  struct addr_dispatch<D, T, 1> : public word_dispatch<D, T, 1, sizeof(void*)>
+  { };
+
+  template <class D, typename T>
+  struct addr_dispatch<D, T, 2> : public word_dispatch<D, T, 2, sizeof(void*)>
+  { };
+
+  /*** 4-byte types (to include sh_ptr<T> on 32-bit platforms) */
+  template <class D, typename T>
+  struct addr_dispatch<D, T, 4> : public word_dispatch<D, T, 4, sizeof(void*)>
+  { };
+
+  template <class D, typename T>
+  struct addr_dispatch<D, T, 8> : public word_dispatch<D, T, 8, sizeof(void*)>
+  { };
+
   template <class D>
-  struct addr_dispatch<D, double, 8>
+  struct addr_dispatch<D, const float, 4>
+      : public word_dispatch<D, const float, 4, sizeof(void*)>
   {
       __attribute__((always_inline))
-      static double read(double* addr, D* thread)
-      {
-          // get second word's address
-          void** addr2 = (void**)((long)addr + 4);
-          union {
-              double t;
-              struct { void* v1; void* v2; } v;
-          } v;
-          // read the two words
-          v.v.v1 = thread->stm_read_word((void**)addr);
-          v.v.v2 = thread->stm_read_word(addr2);
-          return v.t;
-      }
-
-      __attribute__((always_inline))
-       static void write(double* addr, double val, D* thread)
+      static void write(const float* addr, float val, D* thread)
       {
-          // compute the two addresses
-          void** addr1 = (void**) addr;
-          void** addr2 = (void**) ((long)addr + 4);
-          // turn the value into two words
-          union {
-              double t;
-              struct { void* v1; void* v2; } v;
-          } v;
-          v.t = val;
-          // write the two words
-          thread->stm_write_word(addr1, v.v.v1);
-          thread->stm_write_word(addr2, v.v.v2);
+          assert(false && "You should not be writing a const float!");
       }
   };
 
   template <class D>
   struct addr_dispatch<D, const double, 8>
+      : public word_dispatch<D, const double, 8, sizeof(void*)>
   {
-      __attribute__((always_inline))
-      static double read(const double* addr, D* thread)
-      {
-          // get the second word's address
-          void** addr2 = (void**)((long)addr + 4);
-          union {
-              double t;
-              struct { void* v1; void* v2; } v;
-          } v;
-          // read the two words
-          v.v.v1 = thread->stm_read_word((void**)addr);
-          v.v.v2 = thread->stm_read_word(addr2);
-          return v.t;
-      }
-
       __attribute__((always_inline))
       static void write(const double* addr, double val, D* thread)
       {
@@ -284,39 +280,6 @@ namespace stm
       }
   };
 
-  template <class D, typename T>
-  struct addr_dispatch<D, T, 1>
-  {
-      __attribute__((always_inline))
-      static T read(T* addr, D* thread)
-      {
-          // we must read the word (as a void*) that contains the byte at
-          // address addr, then treat that as an array of T's from which we
-          // pull out a specific selement (based on masking the last two bits)
-          union { char v[4]; void* v2; } v;
-          void** a = (void**)(((long)addr) & ~3);
-          long offset = ((long)addr) & 3;
-          v.v2 = thread->stm_read_word(a);
-          union { T* a; char* addr2; } q;
-          q.addr2 = &v.v[offset];
-          return *q.a;
-      }
-
-       __attribute__((always_inline))
-       static void write(T* addr, T val, D* thread)
-       {
-           // to protect granularity, we need to read the whole word and then
-           // write a byte of it
-           union { T v[4]; void* v2; } v;
-           void** a = (void**)(((long)addr) & ~3);
-           long offset = ((long)addr) & 3;
-           // read the enclosing word
-           v.v2 = thread->stm_read_word(a);
-           v.v[offset] = val;
-           thread->stm_write_word(a,v.v2);
-       }
-  };
-
   /**
    * In RSTM, we can always find the last version of an acquired but not
    * committed transaction by looking at shared->payload->next.  We need
@@ -296,9 +296,9 @@ class OverrideableOptionSet : public SimpleOptionSet
 LibOptionSet libs;
 
 // most of the choices are SimpleOptionSet type
-SimpleOptionSet valheur, priv, lwpriv, inev, lwinev, locks, retrys,
+SimpleOptionSet valheur, rstmvalheur, priv, lwpriv, inev, lwinev, locks, retrys,
   cache_descriptor, extendedrollback, lwpub, ssspriv, owlpriv, faircm,
-  writeset, api_asserts;
+  writeset, inplace, timebase, lwtimebase, readset, api_asserts;
 
 CMOptionSet cm;
 
@@ -509,6 +509,14 @@ void init_strings()
   valheur.addoption("STM_COMMIT_COUNTER", "Yes");
   valheur.setdefault(1);
 
+  // RSTM can also keep a commit time in each object header, so that it only
+  // validates when it opens an object written since its last validation
+  rstmvalheur.setprompt("Would you like to use a global commit counter or commit timestamps to avoid some validation?");
+  rstmvalheur.addoption("STM_NO_COMMIT_COUNTER", "No");
+  rstmvalheur.addoption("STM_COMMIT_COUNTER", "Yes, validate whenever any writer has committed");
+  rstmvalheur.addoption("STM_COMMIT_TIMESTAMP", "Yes, validate only when opening an object newer than the last validation");
+  rstmvalheur.setdefault(1);
+
   // privatization
   priv.setprompt("When privatization is needed, how would you like to ensure correctness?");
   priv.addoption("STM_PRIV_TFENCE", "Transactional Fence - long delay, but no overhead on private code");
@@ -614,6 +622,43 @@ void init_strings()
   writeset.addoption("STM_USE_MINIVECTOR_WRITESET", "MiniVector - O(W) lookups");
   writeset.setdefault(1);
 
+  // RSTM: clone large objects, or write them in place with an undo log
+  inplace.setprompt("How should RSTM open large objects for writing?");
+  inplace.addoption("STM_CLONE_ALL_OBJECTS", "Clone every object, regardless of size");
+  inplace.addoption("STM_INPLACE_LARGE_OBJECTS", "Write objects of at least STM_INPLACE_THRESHOLD bytes in place, with an undo log");
+  inplace.setdefault(1);
+
+  // time base for LLT
+  timebase.setprompt("How should transactions get their start and commit times?");
+  timebase.addoption("STM_TIME_GV1", "Global counter, incremented by every writer commit");
+  timebase.addoption("STM_TIME_GV4", "Global counter, one CAS per writer; writers that collide share a time");
+  timebase.addoption("STM_TIME_GV5", "Global counter, moved only by readers that see newer data (more aborts)");
+  // offer only what support/TimeBase.hpp accepts for this build
+#if defined(__x86_64__)
+  timebase.addoption("STM_TIME_TSC", "Cycle counter (64-bit x86 builds with synchronized TSCs only)");
+#endif
+#if defined(__LP64__) || defined(_WIN64)
+  timebase.addoption("STM_TIME_VECTOR", "Per-thread clocks, snapshotted at begin (64-bit builds only)");
+#endif
+  timebase.setdefault(1);
+
+  // read-set filtering for LLT
+  readset.setprompt("How should LLT log and validate its reads?");
+  readset.addoption("STM_READSET_LIST", "Log every read, walk the log at commit");
+  readset.addoption("STM_READSET_FILTER", "Drop duplicate reads found with a Bloom filter");
+  readset.addoption("STM_READSET_SUMMARY", "Drop duplicates, and skip commit validation when nothing read has been locked since");
+  readset.setdefault(1);
+
+  // time base for ET, whose timestamp extension needs a scalar time
+  lwtimebase.setprompt("How should transactions get their start and commit times?");
+  lwtimebase.addoption("STM_TIME_GV1", "Global counter, incremented by every writer commit");
+  lwtimebase.addoption("STM_TIME_GV4", "Global counter, one CAS per writer; writers that collide share a time");
+  lwtimebase.addoption("STM_TIME_GV5", "Global counter, moved only by readers that see newer data (more aborts)");
+#if defined(__x86_64__)
+  lwtimebase.addoption("STM_TIME_TSC", "Cycle counter (64-bit x86 builds with synchronized TSCs only)");
+#endif
+  lwtimebase.setdefault(1);
+
   // do you want API asserts on or off?
   api_asserts.setprompt("Do you want the API to use asserts to ensure the correct use of smart pointers?");
   api_asserts.addoption("STM_API_ASSERTS_OFF", "No thanks.");
@@ -674,11 +719,11 @@ void addsets(OptionSet* a, ...)
 // them in either interactive or default config
 void pick_optionsets()
 {
-  if (LIB == "RSTM")      addsets(&cm, &valheur, &priv, &lwinev, &retrys, &cache_descriptor, &extendedrollback, &writeset, &api_asserts, NULL);
+  if (LIB == "RSTM")      addsets(&cm, &rstmvalheur, &priv, &lwinev, &retrys, &cache_descriptor, &extendedrollback, &writeset, &inplace, &api_asserts, NULL);
   if (LIB == "REDO_LOCK") addsets(&cm, &valheur, &priv, &lwinev, &cache_descriptor, &extendedrollback, &writeset, &api_asserts, NULL);
-  if (LIB == "LLT")       addsets(&lwpriv, &inev, &cache_descriptor, &extendedrollback, &writeset, &api_asserts, NULL);
+  if (LIB == "LLT")       addsets(&lwpriv, &inev, &timebase, &readset, &cache_descriptor, &extendedrollback, &writeset, &api_asserts, NULL);
   if (LIB == "CGL")       addsets(&locks, &cache_descriptor, &api_asserts, NULL);
-  if (LIB == "ET")        addsets(&lwpriv, &lwinev, &cache_descriptor, &rollback, &api_asserts, NULL);
+  if (LIB == "ET")        addsets(&lwpriv, &lwinev, &lwtimebase, &cache_descriptor, &rollback, &api_asserts, NULL);
   if (LIB == "TML")       addsets(&cache_descriptor, &rollback, &api_asserts, NULL);
   if (LIB == "PRECISE")   addsets(&cache_descriptor, &rollback, &api_asserts, NULL);
   if (LIB == "FLOW")      addsets(&lwinev, &owlpriv, &cache_descriptor, &rollback, &api_asserts, NULL);